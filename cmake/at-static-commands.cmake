@@ -0,0 +1,60 @@
+#
+# at-static-commands
+#
+# Pre-rendered AT commands for arguments from small fixed domains.
+# Every table is indexed by the argument, {} in format is replaced by argument value.
+#
+
+FUNCTION(AtStaticCommandTable OutVar Name Format)
+    SET(TABLE "static const struct at_static_cmd at_static_${Name}[] = {\n")
+    FOREACH(ARG IN LISTS ARGN)
+        STRING(REPLACE "{}" "${ARG}" CMD "${Format}")
+        STRING(REPLACE "\"" "\\\"" CMD "${CMD}")
+        STRING(APPEND TABLE "    AT_STATIC_CMD(\"AT${CMD}\\r\"),\n")
+    ENDFOREACH()
+    STRING(APPEND TABLE "};\n\n")
+    SET("${OutVar}" "${${OutVar}}${TABLE}" PARENT_SCOPE)
+ENDFUNCTION()
+
+FUNCTION(GenerateAtStaticCommands OutFile)
+    SET(CONTENT "/*\n    ${OutFile}\n\n    generated by cmake/at-static-commands.cmake, do not edit\n*/\n\n")
+    STRING(APPEND CONTENT "#ifndef CHAN_QUECTEL_AT_STATIC_CMDS_H_INCLUDED\n#define CHAN_QUECTEL_AT_STATIC_CMDS_H_INCLUDED\n\n")
+    STRING(APPEND CONTENT "struct at_static_cmd {\n    const char* data; /*!< command terminated by CR */\n    unsigned length;  /*!< command length without terminating null */\n};\n\n")
+    STRING(APPEND CONTENT "#define AT_STATIC_CMD(s) {(s), sizeof(s) - 1}\n\n")
+
+    SET(SMS_INDEXES)
+    FOREACH(IDX RANGE 255)
+        LIST(APPEND SMS_INDEXES ${IDX})
+    ENDFOREACH()
+
+    AtStaticCommandTable(CONTENT clir "+CLIR={}" 0 1 2)
+    AtStaticCommandTable(CONTENT ccwa "+CCWA={},{},1" 0 1)
+    AtStaticCommandTable(CONTENT chld1x "+CHLD=1{}" 0 1 2 3 4 5 6 7 8 9)
+    AtStaticCommandTable(CONTENT chld2x "+CHLD=2{}" 0 1 2 3 4 5 6 7 8 9)
+    AtStaticCommandTable(CONTENT cmgl "+CMGL={}" 0 1 2 3 4)
+    AtStaticCommandTable(CONTENT cmgr "+CMGR={}" ${SMS_INDEXES})
+    AtStaticCommandTable(CONTENT cmgd "+CMGD={}" ${SMS_INDEXES})
+    AtStaticCommandTable(CONTENT cnma "+CNMA={}" 0 1 2)
+    AtStaticCommandTable(CONTENT csms "+CSMS={}" 0 1)
+    AtStaticCommandTable(CONTENT cnmi_direct "+CNMI=2,2,2,0,{}" 0 1)
+    AtStaticCommandTable(CONTENT cnmi_indirect "+CNMI=2,1,0,2,{}" 0 1)
+    AtStaticCommandTable(CONTENT qlts "+QLTS={}" 0 1 2)
+    AtStaticCommandTable(CONTENT qaudloop "+QAUDLOOP={}" 0 1)
+    AtStaticCommandTable(CONTENT qaudmod "+QAUDMOD={}" 0 1 2 3 4 5)
+    AtStaticCommandTable(CONTENT cmicgain "+CMICGAIN={}" 0 1 2 3 4 5 6 7 8)
+    AtStaticCommandTable(CONTENT coutgain "+COUTGAIN={}" 0 1 2 3 4 5 6 7 8)
+
+    # DTMF digits, indexed by position in at_static_vts_digits
+    SET(VTS_DIGITS 0 1 2 3 4 5 6 7 8 9 "*" "#" A B C D)
+    LIST(JOIN VTS_DIGITS "" VTS_DIGITS_STR)
+    STRING(APPEND CONTENT "static const char at_static_vts_digits[] = \"${VTS_DIGITS_STR}\";\n\n")
+    AtStaticCommandTable(CONTENT vts "+VTS=\"{}\"" ${VTS_DIGITS})
+
+    STRING(APPEND CONTENT "#endif /* CHAN_QUECTEL_AT_STATIC_CMDS_H_INCLUDED */\n")
+
+    # touch output only when content changed
+    FILE(WRITE "${CMAKE_CURRENT_BINARY_DIR}/${OutFile}.tmp" "${CONTENT}")
+    CONFIGURE_FILE("${CMAKE_CURRENT_BINARY_DIR}/${OutFile}.tmp" "${OutFile}" COPYONLY)
+    FILE(REMOVE "${CMAKE_CURRENT_BINARY_DIR}/${OutFile}.tmp")
+    MESSAGE(VERBOSE "Generated ${OutFile}")
+ENDFUNCTION()
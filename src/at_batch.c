@@ -0,0 +1,182 @@
+/*
+    at_batch.c
+*/
+
+#include <errno.h>
+
+#include "ast_config.h"
+
+#include <asterisk/astobj2.h>
+#include <asterisk/lock.h>
+#include <asterisk/logger.h>
+#include <asterisk/time.h>
+
+#include "at_batch.h"
+
+#include "at_command.h" /* at_enqueue_user_batch() */
+#include "chan_quectel.h"
+#include "error.h"
+
+struct at_batch {
+    ast_cond_t cond;          /*!< signalled when batch is complete */
+    int uid;                  /*!< uid of queue task */
+    unsigned count;           /*!< number of commands */
+    unsigned answered;        /*!< number of commands with final result */
+    unsigned complete:1;      /*!< all commands answered or batch aborted */
+    struct timeval started;   /*!< time when batch was queued */
+    int64_t elapsed;          /*!< milliseconds from queueing to completion */
+    struct ast_json* results; /*!< array of results by command */
+};
+
+static void at_batch_destroy(void* obj)
+{
+    struct at_batch* const batch = obj;
+
+    ast_json_unref(batch->results);
+    ast_cond_destroy(&batch->cond);
+}
+
+static struct at_batch* at_batch_current(struct pvt* pvt, const at_queue_task_t* task)
+{
+    struct at_batch* const batch = pvt->at_batch;
+
+    if (!batch || !task || task->uid != batch->uid || task->cindex >= batch->count) {
+        return NULL;
+    }
+    return batch;
+}
+
+static void at_batch_finish(struct pvt* pvt)
+{
+    struct at_batch* const batch = pvt->at_batch;
+    pvt->at_batch                = NULL;
+
+    ao2_lock(batch);
+    batch->complete = 1;
+    batch->elapsed  = ast_tvdiff_ms(ast_tvnow(), batch->started);
+    ast_cond_broadcast(&batch->cond);
+    ao2_unlock(batch);
+
+    ast_verb(3, "[%s] Command batch completed, %u of %u commands answered in %lld ms\n", PVT_ID(pvt), batch->answered, batch->count,
+             (long long int)batch->elapsed);
+    ao2_ref(batch, -1);
+}
+
+#/* */
+
+struct at_batch* at_batch_alloc(const char* const* cmds, unsigned count)
+{
+    struct at_batch* const batch = ao2_alloc(sizeof(struct at_batch), at_batch_destroy);
+    if (!batch) {
+        return NULL;
+    }
+
+    ast_cond_init(&batch->cond, NULL);
+    batch->count   = count;
+    batch->results = ast_json_array_create();
+    if (!batch->results) {
+        ao2_ref(batch, -1);
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+        struct ast_json* const res = ast_json_pack("{s: s, s: n, s: []}", "command", cmds[i], "result", "response");
+        if (!res || ast_json_array_append(batch->results, res)) {
+            ao2_ref(batch, -1);
+            return NULL;
+        }
+    }
+
+    return batch;
+}
+
+int at_batch_start(struct pvt* pvt, struct at_batch* batch)
+{
+    static int last_uid;
+
+    const char* cmds[AT_BATCH_MAX];
+
+    if (pvt->at_batch) {
+        chan_quectel_err = E_BATCH_BUSY;
+        return -1;
+    }
+
+    if (!batch->count || batch->count > AT_BATCH_MAX) {
+        chan_quectel_err = E_BATCH_SIZE;
+        return -1;
+    }
+
+    for (unsigned i = 0; i < batch->count; ++i) {
+        cmds[i] = ast_json_string_get(ast_json_object_get(ast_json_array_get(batch->results, i), "command"));
+    }
+
+    batch->uid = ast_atomic_fetchadd_int(&last_uid, 1) + 1;
+    if (at_enqueue_user_batch(&pvt->sys_chan, cmds, batch->count, batch->uid)) {
+        return -1;
+    }
+
+    batch->started = ast_tvnow();
+    pvt->at_batch  = ao2_bump(batch);
+    return 0;
+}
+
+void at_batch_response(struct pvt* pvt, const at_queue_task_t* task, at_res_t res, const struct ast_str* response)
+{
+    struct at_batch* const batch = at_batch_current(pvt, task);
+
+    if (!batch || !at_batch_recorded(res, ast_str_buffer(response))) {
+        return;
+    }
+
+    SCOPED_AO2LOCK(batch_lock, batch);
+    struct ast_json* const lines = ast_json_object_get(ast_json_array_get(batch->results, task->cindex), "response");
+    ast_json_array_append(lines, ast_json_string_create(ast_str_buffer(response)));
+}
+
+void at_batch_result(struct pvt* pvt, const at_queue_task_t* task, at_res_t res)
+{
+    struct at_batch* const batch = at_batch_current(pvt, task);
+
+    if (!batch) {
+        return;
+    }
+
+    ao2_lock(batch);
+    ast_json_object_set(ast_json_array_get(batch->results, task->cindex), "result", ast_json_string_create(at_res2str(res)));
+    batch->answered = task->cindex + 1u;
+    ao2_unlock(batch);
+
+    /* queue drops rest of task on timeout */
+    if (res == RES_TIMEOUT || batch->answered >= batch->count) {
+        at_batch_finish(pvt);
+    }
+}
+
+void at_batch_abort(struct pvt* pvt)
+{
+    if (pvt->at_batch) {
+        at_batch_finish(pvt);
+    }
+}
+
+int at_batch_wait(struct at_batch* batch, int ms)
+{
+    const struct timeval tv  = ast_tvadd(ast_tvnow(), ast_samp2tv(ms, 1000));
+    const struct timespec ts = {.tv_sec = tv.tv_sec, .tv_nsec = tv.tv_usec * 1000};
+
+    SCOPED_AO2LOCK(batch_lock, batch);
+    while (!batch->complete) {
+        if (ast_cond_timedwait(&batch->cond, ao2_object_get_lockaddr(batch), &ts) == ETIMEDOUT) {
+            break;
+        }
+    }
+    return batch->complete;
+}
+
+struct ast_json* at_batch_json(struct at_batch* batch)
+{
+    SCOPED_AO2LOCK(batch_lock, batch);
+    return ast_json_pack("{s: b, s: i, s: i, s: I, s: o}", "complete", (int)batch->complete, "commands", (int)batch->count, "answered", (int)batch->answered, "elapsed",
+                         (ast_json_int_t)(batch->complete ? batch->elapsed : ast_tvdiff_ms(ast_tvnow(), batch->started)), "results",
+                         ast_json_deep_copy(batch->results));
+}
@@ -0,0 +1,127 @@
+/*
+    at_batch.h
+*/
+
+#ifndef CHAN_QUECTEL_AT_BATCH_H_INCLUDED
+#define CHAN_QUECTEL_AT_BATCH_H_INCLUDED
+
+#include <string.h> /* strncmp() */
+
+#include "ast_config.h"
+
+#include <asterisk/json.h>
+#include <asterisk/strings.h>
+
+#include "at_queue.h" /* at_queue_task_t */
+
+/*
+    Batch of user commands.
+
+    Commands are sent back-to-back in one queue task, device continues
+    with next command after an error. Responses are collected in JSON
+    array, one object per command:
+
+        {"command": "AT+CSQ", "result": "OK", "response": ["+CSQ: 20,99"]}
+
+    Batch is shared by waiting requester and device, the device releases
+    its reference when last command is answered or on disconnect.
+*/
+
+#define AT_BATCH_MAX 64            /*!< maximal number of commands in batch */
+#define AT_BATCH_WAIT_PER_CMD 5000 /*!< requester waits for a command this number of milliseconds */
+
+struct pvt;
+struct at_batch;
+
+/*! \brief Allocate batch object, ao2 reference counted */
+struct at_batch* at_batch_alloc(const char* const* cmds, unsigned count);
+
+/*!
+ * \brief Queue commands of batch on device
+ * \return 0 on success, -1 on error and chan_quectel_err is set
+ */
+int at_batch_start(struct pvt* pvt, struct at_batch* batch);
+
+/*!
+ * \brief Check whether response line is recorded in results of batch
+ *
+ * Only information responses are recorded, result codes and responses
+ * handled as unsolicited are not, even when received while command of
+ * batch is current.
+ */
+static inline int at_batch_recorded(at_res_t res, const char* line)
+{
+    switch (res) {
+        /* result codes */
+        case RES_PARSE_ERROR:
+        case RES_TIMEOUT:
+        case RES_OK:
+        case RES_ERROR:
+        case RES_CMS_ERROR:
+        case RES_BUSY:
+        case RES_NO_CARRIER:
+        case RES_NO_DIALTONE:
+        case RES_NO_ANSWER:
+        case RES_SMS_PROMPT:
+        /* unsolicited */
+        case RES_BOOT:
+        case RES_RING:
+        case RES_CRING:
+        case RES_CCWA:
+        case RES_DSCI:
+        case RES_VOICE_CALL:
+        case RES_MISSED_CALL:
+        case RES_RCEND:
+        case RES_CVOICE:
+        case RES_CSSI:
+        case RES_CSSU:
+        case RES_CUSD:
+        case RES_CMTI:
+        case RES_CMT:
+        case RES_CDSI:
+        case RES_CDS:
+        case RES_CBM:
+        case RES_CLASS0:
+        case RES_SMMEMFULL:
+        case RES_CREG:
+        case RES_CEREG:
+        case RES_CSQN:
+        case RES_SRVST:
+        case RES_QIND:
+        case RES_CIEV:
+        case RES_PSNWID:
+        case RES_PSUTTZ:
+        case RES_DST:
+        case RES_QTONEDET:
+        case RES_RXDTMF:
+        case RES_DTMF:
+            return 0;
+
+        case RES_UNKNOWN:
+            /* +CME ERROR is final result code not known to parser */
+            return line && *line && strncmp(line, "+CME ERROR:", 11);
+
+        default:
+            return 1;
+    }
+}
+
+/*! \brief Response line received while command of batch is current, only information responses are recorded */
+void at_batch_response(struct pvt* pvt, const at_queue_task_t* task, at_res_t res, const struct ast_str* response);
+
+/*! \brief Final result of current command of batch */
+void at_batch_result(struct pvt* pvt, const at_queue_task_t* task, at_res_t res);
+
+/*! \brief Complete running batch of device, used on disconnect */
+void at_batch_abort(struct pvt* pvt);
+
+/*!
+ * \brief Wait for batch to complete, device must not be locked
+ * \return 1 if batch is complete, 0 on timeout
+ */
+int at_batch_wait(struct at_batch* batch, int ms);
+
+/*! \brief Results of batch, partial while batch is running */
+struct ast_json* at_batch_json(struct at_batch* batch);
+
+#endif /* CHAN_QUECTEL_AT_BATCH_H_INCLUDED */
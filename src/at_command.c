@@ -23,12 +23,15 @@
 
 #include "at_command.h"
 
+#include "at_batch.h" /* AT_BATCH_MAX */
 #include "at_queue.h"
+#include "at_static_cmds.h" /* generated by cmake/at-static-commands.cmake */
 #include "chan_quectel.h" /* struct pvt */
 #include "channel.h"
 #include "char_conv.h" /* char_to_hexstr_7bit() */
 #include "error.h"
 #include "pdu.h" /* build_pdu() */
+#include "sms_submit.h"
 #include "smsdb.h"
 
 DECLARE_AT_CMD(at, "");
@@ -47,6 +50,52 @@ const char* at_cmd2str(at_cmd_t cmd)
     return enum2str_def(cmd, cmds, ARRAY_LEN(cmds), "UNDEFINED");
 }
 
+at_queue_class_t at_cmd2class(at_cmd_t cmd)
+{
+    switch (cmd) {
+        case CMD_AT_A:
+        case CMD_AT_D:
+        case CMD_AT_CHUP:
+        case CMD_AT_QHUP:
+        case CMD_AT_CHLD_1x:
+        case CMD_AT_CHLD_2x:
+        case CMD_AT_CHLD_2:
+        case CMD_AT_CHLD_3:
+        case CMD_AT_CLCC:
+        case CMD_AT_CLIR:
+        case CMD_AT_CMUT_0:
+        case CMD_AT_CMUT_1:
+        case CMD_AT_QPCMV_0:
+        case CMD_AT_QPCMV_TTY:
+        case CMD_AT_QPCMV_UAC:
+        case CMD_AT_CPCMREG0:
+        case CMD_AT_CPCMREG1:
+            return ATQ_CLASS_CALL;
+
+        case CMD_AT_DTMF:
+            return ATQ_CLASS_DTMF;
+
+        case CMD_AT_CMGS:
+        case CMD_AT_CMMS:
+        case CMD_AT_SMSTEXT:
+        case CMD_AT_CMGR:
+        case CMD_AT_CMGL:
+        case CMD_AT_CMGD:
+        case CMD_AT_CNMA:
+            return ATQ_CLASS_SMS;
+
+        default:
+            return ATQ_CLASS_HOUSEKEEPING;
+    }
+}
+
+const char* at_queue_class2str(at_queue_class_t qclass)
+{
+    static const char* const names[] = {"call", "dtmf", "sms", "housekeeping"};
+
+    return enum2str_def(qclass, names, ARRAY_LEN(names), "unknown");
+}
+
 /*!
  * \brief Format and fill generic command
  * \param cmd -- the command structure
@@ -57,20 +106,33 @@ const char* at_cmd2str(at_cmd_t cmd)
 
 static int __attribute__((format(printf, 2, 0))) at_fill_generic_cmd_va(at_queue_cmd_t* cmd, const char* format, va_list ap)
 {
-    static const ssize_t AT_CMD_DEF_LEN = 32;
+    va_list aq;
+
+    va_copy(aq, ap);
+    const int cmdlen = vsnprintf(cmd->buf, sizeof(cmd->buf), format, aq);
+    va_end(aq);
 
-    RAII_VAR(struct ast_str*, cmdstr, ast_str_create(AT_CMD_DEF_LEN), ast_free);
+    if (cmdlen <= 0) {
+        return -1;
+    }
 
-    ast_str_set_va(&cmdstr, 0, format, ap);
-    const size_t cmdlen = ast_str_strlen(cmdstr);
+    /* short command is stored inline, no allocation */
+    if ((size_t)cmdlen < sizeof(cmd->buf)) {
+        cmd->data    = NULL;
+        cmd->length  = (unsigned int)cmdlen;
+        cmd->flags  &= ~ATQ_CMD_FLAG_STATIC;
+        cmd->flags  |= ATQ_CMD_FLAG_INLINE;
+        return 0;
+    }
 
-    if (!cmdlen) {
+    char* data;
+    if (ast_vasprintf(&data, format, ap) < 0) {
         return -1;
     }
 
-    cmd->data    = ast_strndup(ast_str_buffer(cmdstr), cmdlen);
+    cmd->data    = data;
     cmd->length  = (unsigned int)cmdlen;
-    cmd->flags  &= ~ATQ_CMD_FLAG_STATIC;
+    cmd->flags  &= ~(ATQ_CMD_FLAG_STATIC | ATQ_CMD_FLAG_INLINE);
 
     return 0;
 }
@@ -93,6 +155,34 @@ static int __attribute__((format(printf, 2, 3))) at_fill_generic_cmd(at_queue_cm
     return rv;
 }
 
+/*!
+ * \brief Fill command pre-rendered at build time
+ * \param cmd -- the command structure
+ * \param table -- generated table of commands indexed by argument
+ * \param size -- number of commands in table
+ * \param arg -- argument of command
+ * \param naked -- without AT prefix and CR, for commands sent in one command line
+ * \return 0 on success, -1 if argument is out of table
+ */
+
+static int at_fill_static_cmd(at_queue_cmd_t* cmd, const struct at_static_cmd* table, size_t size, int arg, int naked)
+{
+    if (arg < 0 || (size_t)arg >= size) {
+        return -1;
+    }
+
+    const struct at_static_cmd* const st = &table[arg];
+
+    cmd->data    = (void*)(naked ? st->data + 2 : st->data);
+    cmd->length  = naked ? st->length - 3u : st->length;
+    cmd->flags  &= ~ATQ_CMD_FLAG_INLINE;
+    cmd->flags  |= ATQ_CMD_FLAG_STATIC;
+    return 0;
+}
+
+#define AT_FILL_STATIC(cmd, name, arg) at_fill_static_cmd((cmd), at_static_##name, ARRAY_LEN(at_static_##name), (arg), 0)
+#define AT_FILL_STATIC_NAKED(cmd, name, arg) at_fill_static_cmd((cmd), at_static_##name, ARRAY_LEN(at_static_##name), (arg), 1)
+
 /*!
  * \brief Enqueue generic command
  * \param pvt -- pvt structure
@@ -205,6 +295,11 @@ int at_enqueue_initialization(struct cpvt* cpvt)
             continue;
         }
 
+        /* identity is confirmed by AT+CGSN */
+        if ((st_cmds[in].cmd == CMD_AT_CGMI || st_cmds[in].cmd == CMD_AT_CGMM || st_cmds[in].cmd == CMD_AT_CGMR) && pvt->identity_cached) {
+            continue;
+        }
+
         if (!(st_cmds[in].flags & ATQ_CMD_FLAG_STATIC)) {
             dyn_cmd     = st_cmds[in];
             dyn_handled = 0;
@@ -229,9 +324,9 @@ int at_enqueue_initialization(struct cpvt* cpvt)
                 }
 
                 if (CONF_SHARED(pvt, msg_direct) > 0) {
-                    err = at_fill_generic_cmd(&dyn_cmd, "AT+CNMI=2,2,2,0,%d\r", CONF_SHARED(pvt, reset_modem) ? 1 : 0);
+                    err = AT_FILL_STATIC(&dyn_cmd, cnmi_direct, CONF_SHARED(pvt, reset_modem) ? 1 : 0);
                 } else {
-                    err = at_fill_generic_cmd(&dyn_cmd, "AT+CNMI=2,1,0,2,%d\r", CONF_SHARED(pvt, reset_modem) ? 1 : 0);
+                    err = AT_FILL_STATIC(&dyn_cmd, cnmi_indirect, CONF_SHARED(pvt, reset_modem) ? 1 : 0);
                 }
 
                 if (err) {
@@ -248,7 +343,7 @@ int at_enqueue_initialization(struct cpvt* cpvt)
                     continue;
                 }
 
-                if (at_fill_generic_cmd(&dyn_cmd, AT_CMD(csms), CONF_SHARED(pvt, msg_service))) {
+                if (AT_FILL_STATIC(&dyn_cmd, csms, CONF_SHARED(pvt, msg_service)) && at_fill_generic_cmd(&dyn_cmd, AT_CMD(csms), CONF_SHARED(pvt, msg_service))) {
                     ast_log(LOG_ERROR, "[%s] Device initialization - unable to create AT+CSMS command\n", PVT_ID(pvt));
                     continue;
                 }
@@ -291,6 +386,26 @@ int at_enqueue_initialization(struct cpvt* cpvt)
     return 0;
 }
 
+/*!
+ * \brief Enqueue identity queries skipped on connect with cached identity
+ * \param cpvt -- cpvt structure
+ * \return 0 on success
+ */
+int at_enqueue_identity(struct cpvt* cpvt)
+{
+    DECLARE_AT_CMD(cgmi, "+CGMI");
+    DECLARE_AT_CMD(cgmm, "+CGMM");
+    DECLARE_AT_CMD(cgmr, "+CGMR");
+
+    static const at_queue_cmd_t cmds[] = {
+        ATQ_CMD_DECLARE_ST(CMD_AT_CGMI, cgmi),
+        ATQ_CMD_DECLARE_ST(CMD_AT_CGMM, cgmm),
+        ATQ_CMD_DECLARE_ST(CMD_AT_CGMR, cgmr),
+    };
+
+    return at_queue_insert_const(cpvt, cmds, ARRAY_LEN(cmds), 0);
+}
+
 int at_enqueue_initialization_quectel(struct cpvt* cpvt, unsigned int dsci)
 {
     DECLARE_AT_CMD(qpcmv, "+QPCMV?");
@@ -473,7 +588,7 @@ static void pdus_clear(at_queue_cmd_t* cmds, ssize_t idx)
 
     const ssize_t u = idx * 2;
     for (ssize_t i = 0; i < u; ++i) {
-        ast_free(cmds[i].data);
+        at_queue_free_data(&cmds[i]);
     }
 }
 
@@ -503,31 +618,42 @@ static int pdus_build(pdu_part_t* const pdus, const char* sca, const char* msg,
     return res;
 }
 
-static int pdus_enqueue(struct cpvt* const cpvt, const pdu_part_t* const pdus, ssize_t len, const int uid)
+/*!
+ * \brief Enqueue parts of message not accepted by network yet
+ * \param cpvt -- cpvt structure
+ * \param sms -- message from submission queue
+ * \param cmms -- send AT+CMMS=1 before message to keep relay link open
+ */
+int at_enqueue_sms_submit(struct cpvt* cpvt, const struct sms_submit* sms, int cmms)
 {
+    DECLARE_AT_CMD(cmms, "+CMMS=1");
+    static const at_queue_cmd_t cmms_cmd = ATQ_CMD_DECLARE_STI(CMD_AT_CMMS, cmms);
+
+    const ssize_t len = sms->parts - sms->part;
     RAII_VAR(at_queue_cmd_t*, cmds, ast_calloc(sizeof(at_queue_cmd_t), len * 2), ast_free);
     if (!cmds) {
         chan_quectel_err = E_MALLOC;
         return -1;
     }
 
-    RAII_VAR(char*, hexbuf, ast_malloc(PDU_LENGTH * 2 + 1), ast_free);
-    if (!hexbuf) {
-        chan_quectel_err = E_MALLOC;
-        return -1;
-    }
-
     at_queue_cmd_t* pcmds = cmds;
 
     for (ssize_t i = 0; i < len; ++i, pcmds += 2) {
-        hexify(pdus[i].buffer, pdus[i].length, hexbuf);
-        if (at_enqueue_pdu(hexbuf, pdus[i].length * 2, pdus[i].tpdu_length, pcmds) < 0) {
+        const struct sms_submit_pdu* const pdu = &sms->pdus[sms->part + i];
+        if (at_enqueue_pdu(pdu->hex, pdu->length, pdu->tpdu_length, pcmds) < 0) {
             pdus_clear(cmds, i);
+            chan_quectel_err = E_MALLOC;
             return -1;
         }
     }
 
-    if (at_queue_insert_uid(cpvt, cmds, len * 2, 0, uid)) {
+    if (cmms && at_queue_insert_const(cpvt, &cmms_cmd, 1u, 0)) {
+        pdus_clear(cmds, len);
+        chan_quectel_err = E_QUEUE;
+        return -1;
+    }
+
+    if (at_queue_insert_uid(cpvt, cmds, len * 2, 0, sms->uid)) {
         chan_quectel_err = E_QUEUE;
         return -1;
     }
@@ -545,6 +671,12 @@ int at_enqueue_sms(struct cpvt* cpvt, const char* sca, const char* destination,
 {
     struct pvt* const pvt = cpvt->pvt;
 
+    if (sms_submit_full(pvt)) {
+        PVT_STAT(pvt, sms_rejected)++;
+        chan_quectel_err = E_SMS_QUEUE_FULL;
+        return -1;
+    }
+
     /* set default validity period */
     if (validity_minutes <= 0) {
         validity_minutes = 3 * 24 * 60;
@@ -562,13 +694,28 @@ int at_enqueue_sms(struct cpvt* cpvt, const char* sca, const char* destination,
         return pdus_len;
     }
 
+    struct sms_submit* const sms = sms_submit_alloc(pdus, pdus_len);
+    if (!sms) {
+        chan_quectel_err = E_MALLOC;
+        return -1;
+    }
+
     const int uid = smsdb_outgoing_add(pvt->imsi, destination, msg, pdus_len, validity_minutes * 60, report_req);
     if (uid <= 0) {
+        ast_free(sms);
         chan_quectel_err = E_SMSDB;
         return -1;
     }
 
-    if (pdus_enqueue(cpvt, pdus, pdus_len, uid)) {
+    sms->uid = uid;
+    if (sms_submit_add(pvt, sms)) {
+        /* chan_quectel_err is set by at_enqueue_sms_submit() */
+        static const size_t DST_DEF_LEN = 32;
+
+        RAII_VAR(struct ast_str*, dst, ast_str_create(DST_DEF_LEN), ast_free);
+        RAII_VAR(struct ast_str*, text, ast_str_create(DST_DEF_LEN), ast_free);
+        smsdb_outgoing_clear(uid, &dst, &text);
+        ast_free(sms);
         return -1;
     }
 
@@ -688,36 +835,14 @@ int at_enqueue_ussd(struct cpvt* cpvt, const char* code, int gsm7)
 
 int at_enqueue_dtmf(struct cpvt* cpvt, char digit)
 {
-    DECLARE_AT_CMDNT(vts, "+VTS=\"%c\"");
-
-    switch (digit) {
-        case 'a':
-        case 'b':
-        case 'c':
-        case 'd':
-            return at_enqueue_generic(cpvt, CMD_AT_DTMF, 1, AT_CMD(vts), toupper(digit));
-
-        case 'A':
-        case 'B':
-        case 'C':
-        case 'D':
-
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-
-        case '*':
-        case '#':
-            return at_enqueue_generic(cpvt, CMD_AT_DTMF, 1, AT_CMD(vts), digit);
+    const char* const pos = digit ? strchr(at_static_vts_digits, toupper(digit)) : NULL;
+    if (!pos) {
+        return -1;
     }
-    return -1;
+
+    at_queue_cmd_t cmd = ATQ_CMD_DECLARE_DYN(CMD_AT_DTMF);
+    AT_FILL_STATIC(&cmd, vts, (int)(pos - at_static_vts_digits));
+    return at_queue_insert_const(cpvt, &cmd, 1u, 1);
 }
 
 /*!
@@ -745,7 +870,7 @@ int at_enqueue_set_ccwa(struct cpvt* cpvt, unsigned call_waiting)
         cw            = call_waiting;
         const int err = call_waiting == CALL_WAITING_ALLOWED ? 1 : 0;
 
-        if (at_fill_generic_cmd(&cmds[0], AT_CMD(ccwa_set), err, err, CCWA_CLASS_VOICE)) {
+        if (AT_FILL_STATIC(&cmds[0], ccwa, err) && at_fill_generic_cmd(&cmds[0], AT_CMD(ccwa_set), err, err, CCWA_CLASS_VOICE)) {
             chan_quectel_err = E_CMD_FORMAT;
             return -1;
         }
@@ -797,7 +922,6 @@ int at_enqueue_dial(struct cpvt* cpvt, const char* number, int clir)
 
     struct pvt* const pvt = cpvt->pvt;
     unsigned int cnt      = 0;
-    char* tmp             = NULL;
 
     at_queue_cmd_t cmds[6];
 
@@ -810,22 +934,22 @@ int at_enqueue_dial(struct cpvt* cpvt, const char* number, int clir)
     }
 
     if (clir != -1) {
-        if (at_fill_generic_cmd(&cmds[cnt], AT_CMD(clir), clir)) {
+        ATQ_CMD_INIT_DYNI(cmds[cnt], CMD_AT_CLIR);
+        if (AT_FILL_STATIC(&cmds[cnt], clir, clir) && at_fill_generic_cmd(&cmds[cnt], AT_CMD(clir), clir)) {
             chan_quectel_err = E_CMD_FORMAT;
             return -1;
         }
-        tmp = cmds[cnt].data;
-        ATQ_CMD_INIT_DYNI(cmds[cnt], CMD_AT_CLIR);
         cnt++;
     }
 
+    ATQ_CMD_INIT_DYNI(cmds[cnt], CMD_AT_D);
     if (at_fill_generic_cmd(&cmds[cnt], AT_CMD(atd), number)) {
-        ast_free(tmp);
+        for (unsigned int i = 0; i < cnt; ++i) {
+            at_queue_free_data(&cmds[i]);
+        }
         chan_quectel_err = E_CMD_FORMAT;
         return -1;
     }
-
-    ATQ_CMD_INIT_DYNI(cmds[cnt], CMD_AT_D);
     cnt++;
 
     if (at_queue_insert(cpvt, cmds, cnt, 1u)) {
@@ -845,20 +969,21 @@ int at_enqueue_dial(struct cpvt* cpvt, const char* number, int clir)
  */
 int at_enqueue_answer(struct cpvt* cpvt)
 {
-    DECLARE_AT_CMDNT(a, "A");
+    DECLARE_AT_CMD(a, "A");
     DECLARE_AT_CMDNT(chld, "+CHLD=2%d");
 
     at_queue_cmd_t cmd = ATQ_CMD_DECLARE_DYN(CMD_AT_A);
-    const char* fmt;
+    int err;
 
     switch (cpvt->state) {
         case CALL_STATE_INCOMING:
-            fmt = AT_CMD(a);
+            ATQ_CMD_INIT_ST(cmd, CMD_AT_A, AT_CMD(a));
+            err = 0;
             break;
 
         case CALL_STATE_WAITING:
             cmd.cmd = CMD_AT_CHLD_2x;
-            fmt     = AT_CMD(chld);
+            err     = AT_FILL_STATIC(&cmd, chld2x, cpvt->call_idx) && at_fill_generic_cmd(&cmd, AT_CMD(chld), cpvt->call_idx);
             /* no need CMD_AT_DDSETEX in this case? */
             break;
 
@@ -868,7 +993,7 @@ int at_enqueue_answer(struct cpvt* cpvt)
             return -1;
     }
 
-    if (at_fill_generic_cmd(&cmd, fmt, cpvt->call_idx)) {
+    if (err) {
         chan_quectel_err = E_CMD_FORMAT;
         return -1;
     }
@@ -901,7 +1026,7 @@ int at_enqueue_activate(struct cpvt* cpvt)
         return -1;
     }
 
-    if (at_fill_generic_cmd(&cmd, AT_CMD(chld), cpvt->call_idx)) {
+    if (AT_FILL_STATIC(&cmd, chld2x, cpvt->call_idx) && at_fill_generic_cmd(&cmd, AT_CMD(chld), cpvt->call_idx)) {
         chan_quectel_err = E_CMD_FORMAT;
         return -1;
     }
@@ -980,6 +1105,43 @@ int at_enqueue_user_cmd(struct cpvt* cpvt, const char* input)
     return 0;
 }
 
+/*!
+ * \brief Enqueue batch of user-specified commands in one task
+ * \param cpvt -- cpvt structure
+ * \param input -- user's commands
+ * \param count -- number of commands
+ * \param uid -- uid of task
+ * \return 0 on success
+ */
+int at_enqueue_user_batch(struct cpvt* cpvt, const char* const* input, unsigned count, int uid)
+{
+    at_queue_cmd_t cmds[AT_BATCH_MAX];
+
+    if (!count || count > AT_BATCH_MAX) {
+        chan_quectel_err = E_BATCH_SIZE;
+        return -1;
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+        /* continue with next command after an error */
+        ATQ_CMD_INIT_DYNI(cmds[i], CMD_USER);
+        if (at_fill_generic_cmd(&cmds[i], "%s\r", input[i])) {
+            for (unsigned j = 0; j < i; ++j) {
+                at_queue_free_data(&cmds[j]);
+            }
+            chan_quectel_err = E_CMD_FORMAT;
+            return -1;
+        }
+    }
+
+    if (at_queue_insert_uid(cpvt, cmds, count, 1, uid)) {
+        chan_quectel_err = E_QUEUE;
+        return -1;
+    }
+
+    return 0;
+}
+
 /*!
  * \brief Start reading next SMS, if any
  * \param cpvt -- cpvt structure
@@ -1014,7 +1176,7 @@ int at_enqueue_list_messages(struct cpvt* cpvt, enum msg_status_t stat)
 
     at_queue_cmd_t cmd = ATQ_CMD_DECLARE_DYN(CMD_AT_CMGL);
 
-    if (at_fill_generic_cmd(&cmd, AT_CMD(cmgl), (int)stat)) {
+    if (AT_FILL_STATIC(&cmd, cmgl, (int)stat) && at_fill_generic_cmd(&cmd, AT_CMD(cmgl), (int)stat)) {
         chan_quectel_err = E_CMD_FORMAT;
         return -1;
     }
@@ -1049,7 +1211,7 @@ int at_enqueue_retrieve_sms(struct cpvt* cpvt, int idx, int sms_type)
     pvt->incoming_sms_index = idx;
     pvt->incoming_sms_type  = sms_type;
 
-    if (at_fill_generic_cmd(&cmd, AT_CMD(cmgr), idx)) {
+    if (AT_FILL_STATIC(&cmd, cmgr, idx) && at_fill_generic_cmd(&cmd, AT_CMD(cmgr), idx)) {
         chan_quectel_err = E_CMD_FORMAT;
         goto error;
     }
@@ -1106,7 +1268,7 @@ int at_enqueue_delete_sms(struct cpvt* cpvt, int idx, tristate_bool_t ack)
         return 0;
     }
 
-    if (at_fill_generic_cmd(&cmds[1], AT_CMD(cmgd), idx)) {
+    if (AT_FILL_STATIC(&cmds[1], cmgd, idx) && at_fill_generic_cmd(&cmds[1], AT_CMD(cmgd), idx)) {
         chan_quectel_err = E_CMD_FORMAT;
         return -1;
     }
@@ -1119,6 +1281,56 @@ int at_enqueue_delete_sms(struct cpvt* cpvt, int idx, tristate_bool_t ack)
     return 0;
 }
 
+/*!
+ * \brief Enqueue pipelined commands for deleting several SMS
+ * \param cpvt -- cpvt structure
+ * \param idx -- indexes of messages in store
+ * \param count -- number of indexes
+ * \param batch -- maximal number of +CMGD commands sent in one command line
+ * \return 0 on success
+ */
+int at_enqueue_delete_sms_batch(struct cpvt* cpvt, const int* idx, unsigned int count, unsigned int batch)
+{
+    DECLARE_NAKED_AT_CMDNT(cmgd, "+CMGD=%d");
+
+    at_queue_cmd_t cmds[MSG_DELETE_BATCH_MAX];
+
+    batch = MAX(1u, MIN(batch, ITEMS_OF(cmds)));
+
+    while (count) {
+        const unsigned int cnt = MIN(count, batch);
+
+        for (unsigned int i = 0; i < cnt; ++i) {
+            ATQ_CMD_INIT_DYNI(cmds[i], CMD_AT_CMGD);
+            if (AT_FILL_STATIC_NAKED(&cmds[i], cmgd, idx[i]) && at_fill_generic_cmd(&cmds[i], AT_CMD(cmgd), idx[i])) {
+                for (unsigned int j = 0; j < i; ++j) {
+                    at_queue_free_data(&cmds[j]);
+                }
+                chan_quectel_err = E_CMD_FORMAT;
+                return -1;
+            }
+        }
+
+        if (at_queue_add(cpvt, cmds, cnt, 0, 1u) == NULL) {
+            for (unsigned int i = 0; i < cnt; ++i) {
+                at_queue_free_data(&cmds[i]);
+            }
+            chan_quectel_err = E_QUEUE;
+            return -1;
+        }
+
+        idx   += cnt;
+        count -= cnt;
+    }
+
+    if (at_queue_run(cpvt->pvt)) {
+        chan_quectel_err = E_QUEUE;
+        return -1;
+    }
+
+    return 0;
+}
+
 int at_enqueue_delete_sms_n(struct cpvt* cpvt, int idx, tristate_bool_t ack)
 {
     DECLARE_AT_CMDNT(cnma, "+CNMA=%d");
@@ -1134,13 +1346,13 @@ int at_enqueue_delete_sms_n(struct cpvt* cpvt, int idx, tristate_bool_t ack)
     }
 
     if (ack) {
-        if (at_fill_generic_cmd(&cmds[0], AT_CMD(cnma), (ack < 0) ? 2 : 1)) {
+        if (AT_FILL_STATIC(&cmds[0], cnma, (ack < 0) ? 2 : 1)) {
             chan_quectel_err = E_CMD_FORMAT;
             return -1;
         }
     }
 
-    if (at_fill_generic_cmd(&cmds[1], AT_CMD(cmgd), idx)) {
+    if (AT_FILL_STATIC(&cmds[1], cmgd, idx) && at_fill_generic_cmd(&cmds[1], AT_CMD(cmgd), idx)) {
         at_queue_free_data(cmds);
         chan_quectel_err = E_CMD_FORMAT;
         return -1;
@@ -1188,7 +1400,7 @@ int at_enqueue_msg_ack_n(struct cpvt* cpvt, int n, int uid)
 
     at_queue_cmd_t cmd = ATQ_CMD_DECLARE_DYNI(CMD_AT_CNMA);
 
-    if (at_fill_generic_cmd(&cmd, AT_CMD(cnma), n)) {
+    if (AT_FILL_STATIC(&cmd, cnma, n) && at_fill_generic_cmd(&cmd, AT_CMD(cnma), n)) {
         chan_quectel_err = E_CMD_FORMAT;
         return -1;
     }
@@ -1297,10 +1509,15 @@ int at_enqueue_hangup(struct cpvt* cpvt, int call_idx, int release_cause)
     if (cpvt == &pvt->sys_chan || CPVT_DIR_INCOMING(cpvt) || (cpvt->state != CALL_STATE_INIT && cpvt->state != CALL_STATE_DIALING)) {
         /* FIXME: other channels may be in RELEASED or INIT state */
         if (PVT_STATE(pvt, chansno) > 1) {
-            DECLARE_AT_CMD(chld1x, "+CHLD=1%d");
-            static const at_queue_cmd_t cmd = ATQ_CMD_DECLARE_STFT(CMD_AT_CHLD_1x, RES_OK, AT_CMD(chld1x), ATQ_CMD_FLAG_DEFAULT, ATQ_CMD_TIMEOUT_LONG, 0);
+            DECLARE_AT_CMDNT(chld1x, "+CHLD=1%d");
+            at_queue_cmd_t cmd = ATQ_CMD_DECLARE_DYNFT(CMD_AT_CHLD_1x, RES_OK, ATQ_CMD_FLAG_DEFAULT, ATQ_CMD_TIMEOUT_LONG, 0);
+
+            if (AT_FILL_STATIC(&cmd, chld1x, call_idx) && at_fill_generic_cmd(&cmd, AT_CMD(chld1x), call_idx)) {
+                chan_quectel_err = E_CMD_FORMAT;
+                return -1;
+            }
 
-            if (at_queue_insert_const(cpvt, &cmd, 1u, 1)) {
+            if (at_queue_insert(cpvt, &cmd, 1u, 1)) {
                 chan_quectel_err = E_QUEUE;
                 return -1;
             }
@@ -1492,7 +1709,7 @@ int at_enqueue_qlts(struct cpvt* cpvt, int mode)
 
     at_queue_cmd_t cmd = ATQ_CMD_DECLARE_DYN(CMD_AT_QLTS);
 
-    if (at_fill_generic_cmd(&cmd, AT_CMD(qlts), mode)) {
+    if (AT_FILL_STATIC(&cmd, qlts, mode) && at_fill_generic_cmd(&cmd, AT_CMD(qlts), mode)) {
         chan_quectel_err = E_CMD_FORMAT;
         return -1;
     }
@@ -1666,7 +1883,7 @@ int at_enqueue_qaudloop(struct cpvt* cpvt, int aloop)
 
     at_queue_cmd_t cmd = ATQ_CMD_DECLARE_DYN(CMD_AT_QAUDLOOP);
 
-    if (at_fill_generic_cmd(&cmd, AT_CMD(qaudloop), aloop)) {
+    if (AT_FILL_STATIC(&cmd, qaudloop, aloop) && at_fill_generic_cmd(&cmd, AT_CMD(qaudloop), aloop)) {
         chan_quectel_err = E_CMD_FORMAT;
         return -1;
     }
@@ -1698,7 +1915,7 @@ int at_enqueue_qaudmod(struct cpvt* cpvt, int amode)
 
     at_queue_cmd_t cmd = ATQ_CMD_DECLARE_DYN(CMD_AT_QAUDMOD);
 
-    if (at_fill_generic_cmd(&cmd, AT_CMD(qaudmod), amode)) {
+    if (AT_FILL_STATIC(&cmd, qaudmod, amode) && at_fill_generic_cmd(&cmd, AT_CMD(qaudmod), amode)) {
         chan_quectel_err = E_CMD_FORMAT;
         return -1;
     }
@@ -1762,7 +1979,7 @@ int at_enqueue_cmicgain(struct cpvt* cpvt, int gain)
 
     at_queue_cmd_t cmd = ATQ_CMD_DECLARE_DYN(CMD_AT_CMICGAIN);
 
-    if (at_fill_generic_cmd(&cmd, AT_CMD(cmicgain), gain)) {
+    if (AT_FILL_STATIC(&cmd, cmicgain, gain) && at_fill_generic_cmd(&cmd, AT_CMD(cmicgain), gain)) {
         chan_quectel_err = E_CMD_FORMAT;
         return -1;
     }
@@ -1826,7 +2043,7 @@ int at_enqueue_coutgain(struct cpvt* cpvt, int gain)
 
     at_queue_cmd_t cmd = ATQ_CMD_DECLARE_DYN(CMD_AT_COUTGAIN);
 
-    if (at_fill_generic_cmd(&cmd, AT_CMD(coutgain), gain)) {
+    if (AT_FILL_STATIC(&cmd, coutgain, gain) && at_fill_generic_cmd(&cmd, AT_CMD(coutgain), gain)) {
         chan_quectel_err = E_CMD_FORMAT;
         return -1;
     }
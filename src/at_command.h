@@ -15,6 +15,7 @@
 /* AT_COMMANDS_TABLE */
 #define AT_CMD_AS_ENUM(cmd, str) CMD_##cmd,
 #define AT_CMD_AS_STRING(cmd, str) str,
+#define AT_CMD_AS_COUNT(cmd, str) +1
 
 #define AT_COMMANDS_TABLE(_)                        \
     _(USER, "USER")                                 \
@@ -43,6 +44,7 @@
     _(AT_CMGL, "AT+CMGL")                           \
                                                     \
     _(AT_CMGS, "AT+CMGS")                           \
+    _(AT_CMMS, "AT+CMMS")                           \
     _(AT_SMSTEXT, "SMSTEXT")                        \
     _(AT_CNMI, "AT+CNMI")                           \
     _(AT_CNUM, "AT+CNUM")                           \
@@ -126,14 +128,29 @@
 
 typedef enum { AT_COMMANDS_TABLE(AT_CMD_AS_ENUM) } at_cmd_t;
 
+#define AT_CMDS_NUMBER (0 AT_COMMANDS_TABLE(AT_CMD_AS_COUNT))
+
+/* priority classes of AT command queue, most urgent first */
+typedef enum {
+    ATQ_CLASS_CALL = 0,     /*!< call control */
+    ATQ_CLASS_DTMF,         /*!< DTMF generation */
+    ATQ_CLASS_SMS,          /*!< sending, reading and deleting messages */
+    ATQ_CLASS_HOUSEKEEPING, /*!< initialization, polling and everything else */
+    ATQ_CLASSES
+} at_queue_class_t;
+
 enum msg_status_t { MSG_STAT_REC_UNREAD, MSG_STAT_REC_READ, MSG_STAT_STO_UNSENT, MSG_STAT_STO_SENT, MSG_STAT_ALL };
 
 struct pvt;
 struct cpvt;
+struct sms_submit;
 
 const char* at_cmd2str(at_cmd_t cmd);
+at_queue_class_t at_cmd2class(at_cmd_t cmd);
+const char* at_queue_class2str(at_queue_class_t qclass);
 int at_enqueue_at(struct cpvt* cpvt);
 int at_enqueue_initialization(struct cpvt* cpvt);
+int at_enqueue_identity(struct cpvt* cpvt);
 int at_enqueue_initialization_quectel(struct cpvt*, unsigned int);
 int at_enqueue_initialization_simcom(struct cpvt*);
 int at_enqueue_initialization_other(struct cpvt*);
@@ -142,6 +159,7 @@ int at_enqueue_ping_taskproc(void*);
 int at_enqueue_cspn_cops(struct cpvt* cpvt);
 int at_enqueue_qspn_qnwinfo(struct cpvt* cpvt);
 int at_enqueue_sms(struct cpvt* cpvt, const char* sca, const char* destination, const char* msg, unsigned validity_min, int report_req);
+int at_enqueue_sms_submit(struct cpvt* cpvt, const struct sms_submit* sms, int cmms);
 int at_enqueue_ussd(struct cpvt* cpvt, const char* code, int gsm7);
 int at_enqueue_dtmf(struct cpvt* cpvt, char digit);
 int at_enqueue_set_ccwa(struct cpvt* cpvt, unsigned call_waiting);
@@ -149,12 +167,14 @@ int at_enqueue_reset(struct cpvt* cpvt);
 int at_enqueue_dial(struct cpvt* cpvt, const char* number, int clir);
 int at_enqueue_answer(struct cpvt* cpvt);
 int at_enqueue_user_cmd(struct cpvt* cpvt, const char* input);
+int at_enqueue_user_batch(struct cpvt* cpvt, const char* const* input, unsigned count, int uid);
 int at_enqueue_list_messages(struct cpvt* cpvt, enum msg_status_t stat);
 int at_enqueue_retrieve_sms(struct cpvt* cpvt, int idx, int sms_type);
 void at_sms_retrieved(struct cpvt* cpvt, int confirm);
 int at_enqueue_cmgd(struct cpvt* cpvt, unsigned int index, int delflag);
 int at_enqueue_delete_sms(struct cpvt* cpvt, int idx, tristate_bool_t ack);
 int at_enqueue_delete_sms_n(struct cpvt* cpvt, int idx, tristate_bool_t ack);
+int at_enqueue_delete_sms_batch(struct cpvt* cpvt, const int* idx, unsigned int count, unsigned int batch);
 int at_enqueue_hangup(struct cpvt* cpvt, int call_idx, int release_cause);
 int at_enqueue_volsync(struct cpvt* cpvt);
 int at_enqueue_clcc(struct cpvt* cpvt);
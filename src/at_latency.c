@@ -0,0 +1,109 @@
+/*
+    at_latency.c
+*/
+
+#include <string.h>
+
+#include "at_latency.h"
+
+static unsigned at_latency_bucket(uint64_t ms)
+{
+    if (!ms) {
+        return 0;
+    }
+
+    const unsigned bucket = 64u - (unsigned)__builtin_clzll(ms);
+    return bucket < AT_LATENCY_BUCKETS ? bucket : AT_LATENCY_BUCKETS - 1u;
+}
+
+void at_latency_record(struct at_latency* lat, int64_t ms)
+{
+    if (ms < 0) {
+        ms = 0;
+    }
+
+    lat->buckets[at_latency_bucket((uint64_t)ms)]++;
+    lat->count++;
+    lat->sum += (uint64_t)ms;
+    if (ms > lat->max) {
+        lat->max = (uint32_t)ms;
+    }
+}
+
+unsigned at_latency_bucket_upper(unsigned bucket) { return 1u << bucket; }
+
+unsigned at_latency_percentile(const struct at_latency* lat, unsigned permille)
+{
+    if (!lat->count) {
+        return 0;
+    }
+
+    const uint64_t target = ((uint64_t)lat->count * permille + 999u) / 1000u;
+    uint64_t seen         = 0;
+
+    for (unsigned i = 0; i < AT_LATENCY_BUCKETS - 1u; ++i) {
+        seen += lat->buckets[i];
+        if (seen >= target) {
+            const unsigned upper = at_latency_bucket_upper(i);
+            return upper < lat->max ? upper : lat->max;
+        }
+    }
+
+    return lat->max;
+}
+
+void at_latency_window_record(struct at_latency_window* win, int64_t ms)
+{
+    if (ms < 0) {
+        ms = 0;
+    } else if (ms > UINT16_MAX) {
+        ms = UINT16_MAX;
+    }
+
+    win->samples[win->next] = (uint16_t)ms;
+    win->next               = (uint16_t)((win->next + 1u) % AT_LATENCY_WINDOW);
+    if (win->count < AT_LATENCY_WINDOW) {
+        win->count++;
+    }
+}
+
+unsigned at_latency_window_percentile(const struct at_latency_window* win, unsigned permille)
+{
+    uint16_t sorted[AT_LATENCY_WINDOW];
+    const unsigned count = win->count;
+
+    if (!count) {
+        return 0;
+    }
+
+    /* insertion sort, window is small */
+    memcpy(sorted, win->samples, count * sizeof(sorted[0]));
+    for (unsigned i = 1; i < count; ++i) {
+        const uint16_t v = sorted[i];
+        unsigned j       = i;
+        for (; j > 0 && sorted[j - 1u] > v; --j) {
+            sorted[j] = sorted[j - 1u];
+        }
+        sorted[j] = v;
+    }
+
+    const unsigned rank = (count * permille + 999u) / 1000u;
+    return sorted[rank ? rank - 1u : 0];
+}
+
+unsigned at_latency_timeout(const struct at_latency_window* win, unsigned min_ms, unsigned max_ms)
+{
+    if (win->count < AT_LATENCY_MIN_SAMPLES) {
+        return 0;
+    }
+
+    const uint64_t timeout = (uint64_t)at_latency_window_percentile(win, AT_LATENCY_TIMEOUT_PERMILLE) * AT_LATENCY_TIMEOUT_FACTOR;
+
+    if (timeout < min_ms) {
+        return min_ms;
+    }
+    if (timeout > max_ms) {
+        return max_ms;
+    }
+    return (unsigned)timeout;
+}
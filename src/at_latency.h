@@ -0,0 +1,71 @@
+/*
+    at_latency.h
+*/
+
+#ifndef CHAN_QUECTEL_AT_LATENCY_H_INCLUDED
+#define CHAN_QUECTEL_AT_LATENCY_H_INCLUDED
+
+#include <stdint.h>
+
+/*
+    Latency of latest answers of command.
+
+    Only last AT_LATENCY_WINDOW samples are kept, older ones are
+    overwritten, so derived timeout follows changes of coverage or firmware.
+*/
+
+#define AT_LATENCY_WINDOW 32             /*!< number of latest samples kept */
+#define AT_LATENCY_MIN_SAMPLES 16        /*!< number of samples required before timeout is derived from latency */
+#define AT_LATENCY_TIMEOUT_PERMILLE 990  /*!< percentile of latency used to derive timeout */
+#define AT_LATENCY_TIMEOUT_FACTOR 4      /*!< timeout is the percentile multiplied by this factor */
+
+struct at_latency_window {
+    uint16_t samples[AT_LATENCY_WINDOW]; /*!< latest latencies, milliseconds, ring buffer */
+    uint16_t next;                       /*!< index of next sample */
+    uint16_t count;                      /*!< number of samples, not more than AT_LATENCY_WINDOW */
+};
+
+/*
+    Log-scale histogram of command latency, never reset.
+
+    Bucket 0 counts latencies below 1 ms, bucket N counts latencies
+    from 2^(N-1) ms up to 2^N ms, the last bucket counts everything longer.
+*/
+
+#define AT_LATENCY_BUCKETS 18 /*!< last bucket starts at 65536 ms */
+
+struct at_latency {
+    uint32_t count;                       /*!< number of samples */
+    uint32_t max;                         /*!< maximal latency, milliseconds */
+    uint64_t sum;                         /*!< summary latency, milliseconds */
+    uint32_t buckets[AT_LATENCY_BUCKETS]; /*!< number of samples by bucket */
+};
+
+void at_latency_window_record(struct at_latency_window* win, int64_t ms);
+
+/*!
+ * \brief Get latency percentile of latest samples
+ * \param permille -- percentile in tenths of percent
+ * \return latency in milliseconds
+ */
+unsigned at_latency_window_percentile(const struct at_latency_window* win, unsigned permille);
+
+/*!
+ * \brief Derive command timeout from observed latency
+ * \return timeout in milliseconds between min_ms and max_ms, 0 if not enough samples collected yet
+ */
+unsigned at_latency_timeout(const struct at_latency_window* win, unsigned min_ms, unsigned max_ms);
+
+void at_latency_record(struct at_latency* lat, int64_t ms);
+
+/*! \brief Get upper bound of bucket in milliseconds (exclusive) */
+unsigned at_latency_bucket_upper(unsigned bucket);
+
+/*!
+ * \brief Get latency percentile
+ * \param permille -- percentile in tenths of percent
+ * \return upper bound of bucket containing percentile in milliseconds, but not more than maximal latency
+ */
+unsigned at_latency_percentile(const struct at_latency* lat, unsigned permille);
+
+#endif /* CHAN_QUECTEL_AT_LATENCY_H_INCLUDED */
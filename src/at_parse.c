@@ -789,6 +789,23 @@ int at_parse_cmgs(const char* str)
     return sscanf(str, "+CMGS:%d", &cmgs) ? cmgs : -1;
 }
 
+/*!
+ * \brief Parse a +CMS ERROR result
+ * \param str -- string to parse (null terminated)
+ * \return error code, -1 if code is not numeric
+ */
+
+int at_parse_cms_error(const char* str)
+{
+    int err = -1;
+
+    /*
+     * parse CMS ERROR in the following format:
+     * +CMS ERROR: <err>
+     */
+    return (sscanf(str, "+CMS ERROR:%d", &err) == 1) ? err : -1;
+}
+
 /*!
  * \brief Parse a CUSD answer
  * \param str -- string to parse (null terminated)
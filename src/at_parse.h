@@ -37,6 +37,7 @@ int at_parse_cbm(char* str, size_t len, int* tpdu_type, char* sca, size_t sca_le
 int at_parse_cds(char* str, size_t len, int* tpdu_type, char* sca, size_t sca_len, char* oa, size_t oa_len, struct ast_tm* scts, int* mr, int* st,
                  struct ast_tm* dt, char* msg, size_t* msg_len, pdu_udh_t* udh);
 int at_parse_cmgs(const char* str);
+int at_parse_cms_error(const char* str);
 int at_parse_cusd(char* str, int* type, char** cusd, int* dcs);
 int at_parse_cpin(const char* str, const size_t len);
 int at_parse_csq(const char* str, int* rssi);
@@ -11,16 +11,23 @@
 */
 #include "ast_config.h"
 
+#include <asterisk/threadstorage.h>
 #include <asterisk/utils.h> /* ast_free() */
 
 #include "at_queue.h"
 
+#include "at_latency.h"
 #include "chan_quectel.h" /* struct pvt */
 #include "helpers.h"
 
+/* command line joined from several commands, reused by writer thread */
+AST_THREADSTORAGE(at_line_buf);
+
 void at_queue_free_data(at_queue_cmd_t* const cmd)
 {
-    if (cmd->data) {
+    if (cmd->flags & ATQ_CMD_FLAG_INLINE) {
+        cmd->flags &= ~ATQ_CMD_FLAG_INLINE;
+    } else if (cmd->data) {
         if (!(cmd->flags & ATQ_CMD_FLAG_STATIC)) {
             ast_free(cmd->data);
             cmd->data = NULL;
@@ -30,23 +37,59 @@ void at_queue_free_data(at_queue_cmd_t* const cmd)
     cmd->length = 0;
 }
 
-static void at_queue_free(at_queue_task_t* const task)
+static void at_queue_free(struct pvt* const pvt, at_queue_task_t* const task)
 {
     for (unsigned i = 0; i < task->cmdsno; ++i) {
         at_queue_free_data(&task->cmds[i]);
     }
+
+    if (task->pooled && pvt->at_task_pool_size < ATQ_POOL_SIZE) {
+        AST_LIST_INSERT_HEAD(&pvt->at_task_pool, task, entry);
+        pvt->at_task_pool_size++;
+        return;
+    }
+
     ast_free(task);
 }
 
+static at_queue_task_t* at_queue_alloc(struct pvt* const pvt, unsigned cmdsno)
+{
+    const size_t size = sizeof(at_queue_task_t) + cmdsno * sizeof(at_queue_cmd_t);
+
+    if (cmdsno <= ATQ_POOL_CMDS) {
+        at_queue_task_t* const task = AST_LIST_REMOVE_HEAD(&pvt->at_task_pool, entry);
+        if (task) {
+            pvt->at_task_pool_size--;
+            PVT_STAT(pvt, at_task_reused)++;
+            memset(task, 0, size);
+            task->pooled = 1;
+            return task;
+        }
+    }
+
+    /* small tasks are allocated with pool capacity to be reusable for any small task */
+    const int pooled            = cmdsno <= ATQ_POOL_CMDS;
+    at_queue_task_t* const task = ast_calloc(1, pooled ? sizeof(at_queue_task_t) + ATQ_POOL_CMDS * sizeof(at_queue_cmd_t) : size);
+    if (!task) {
+        return NULL;
+    }
+
+    PVT_STAT(pvt, at_task_allocs)++;
+    task->pooled = pooled;
+    return task;
+}
+
 static void at_queue_remove(struct pvt* const pvt)
 {
     // U+21B3 : Downwards Arrow with Tip Rightwards : 0xE2 0x86 0xB3
-    at_queue_task_t* const task = AST_LIST_REMOVE_HEAD(&pvt->at_queue, entry);
+    at_queue_task_t* const task = pvt->at_task;
 
     if (!task) {
         return;
     }
 
+    pvt->at_task = NULL;
+
     PVT_STATE(pvt, at_tasks)--;
     PVT_STATE(pvt, at_cmds) -= task->cmdsno - task->cindex;
 
@@ -61,7 +104,64 @@ static void at_queue_remove(struct pvt* const pvt)
                   task->cindex, task->cmdsno, (unsigned long)PVT_STATE(pvt, at_tasks));
     }
 
-    at_queue_free(task);
+    at_queue_free(pvt, task);
+}
+
+/*!
+ * \brief Check if command is a query which may be skipped when the same query is pending already
+ */
+static int at_queue_idempotent(at_cmd_t cmd)
+{
+    switch (cmd) {
+        case CMD_AT:
+        case CMD_AT_CLCC:
+        case CMD_AT_CSQ:
+        case CMD_AT_QSPN:
+        case CMD_AT_CSPN:
+        case CMD_AT_COPS:
+        case CMD_AT_QLTS_1:
+        case CMD_AT_CCLK:
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+/*!
+ * \brief Find pending task with the same idempotent commands, task being sent is not taken into account
+ */
+static at_queue_task_t* at_queue_find_duplicate(const struct pvt* const pvt, const at_queue_cmd_t* cmds, unsigned cmdsno, unsigned at_once)
+{
+    for (unsigned i = 0; i < cmdsno; ++i) {
+        if (!at_queue_idempotent(cmds[i].cmd)) {
+            return NULL;
+        }
+    }
+
+    for (unsigned qclass = 0; qclass < ATQ_CLASSES; ++qclass) {
+        at_queue_task_t* task;
+
+        AST_LIST_TRAVERSE(&pvt->at_queue[qclass], task, entry) {
+            if (task->cmdsno != cmdsno || task->at_once != at_once || task->cindex) {
+                continue;
+            }
+
+            unsigned i = 0;
+            for (; i < cmdsno; ++i) {
+                const at_queue_cmd_t* const c = &task->cmds[i];
+                if (c->cmd != cmds[i].cmd || c->length != cmds[i].length || memcmp(at_queue_cmd_data(c), at_queue_cmd_data(&cmds[i]), c->length)) {
+                    break;
+                }
+            }
+
+            if (i == cmdsno) {
+                return task;
+            }
+        }
+    }
+
+    return NULL;
 }
 
 at_queue_task_t* at_queue_add(struct cpvt* cpvt, const at_queue_cmd_t* cmds, unsigned cmdsno, int prio, unsigned at_once)
@@ -72,7 +172,29 @@ at_queue_task_t* at_queue_add(struct cpvt* cpvt, const at_queue_cmd_t* cmds, uns
         return NULL;
     }
 
-    at_queue_task_t* const e = ast_calloc(1, sizeof(*e) + cmdsno * sizeof(*cmds));
+    struct pvt* const pvt = cpvt->pvt;
+
+    at_queue_task_t* const dup = at_queue_find_duplicate(pvt, cmds, cmdsno, at_once);
+    if (dup) {
+        /* data of commands is owned by queue now, release it as pending task sends the same */
+        for (unsigned i = 0; i < cmdsno; ++i) {
+            if (!(cmds[i].flags & (ATQ_CMD_FLAG_STATIC | ATQ_CMD_FLAG_INLINE))) {
+                ast_free(cmds[i].data);
+            }
+        }
+
+        /* urgent request promotes pending task */
+        if (prio && AST_LIST_FIRST(&pvt->at_queue[dup->qclass]) != dup) {
+            AST_LIST_REMOVE(&pvt->at_queue[dup->qclass], dup, entry);
+            AST_LIST_INSERT_HEAD(&pvt->at_queue[dup->qclass], dup, entry);
+        }
+
+        PVT_STAT(pvt, at_dedup_suppressed)++;
+        ast_debug(4, "[%s][%s] Duplicate of pending task, suppressed\n", PVT_ID(pvt), at_cmd2str(cmds[0].cmd));
+        return dup;
+    }
+
+    at_queue_task_t* const e = at_queue_alloc(pvt, cmdsno);
     if (!e) {
         return NULL;
     }
@@ -80,40 +202,106 @@ at_queue_task_t* at_queue_add(struct cpvt* cpvt, const at_queue_cmd_t* cmds, uns
     e->cmdsno  = cmdsno;
     e->cpvt    = cpvt;
     e->at_once = at_once;
+    e->qclass  = ATQ_CLASS_HOUSEKEEPING;
+    e->queued  = ast_tvnow();
 
     memcpy(&e->cmds[0], cmds, cmdsno * sizeof(*cmds));
 
-    struct pvt* const pvt        = cpvt->pvt;
-    at_queue_task_t* const first = AST_LIST_FIRST(&pvt->at_queue);
+    /* task is served in class of its most urgent command */
+    for (unsigned i = 0; i < cmdsno; ++i) {
+        const at_queue_class_t qclass = at_cmd2class(cmds[i].cmd);
+        if (qclass < e->qclass) {
+            e->qclass = qclass;
+        }
 
-    if (prio && first) {
-        AST_LIST_INSERT_AFTER(&pvt->at_queue, first, e, entry);
+        if (cmds[i].flags & ATQ_CMD_FLAG_INLINE) {
+            PVT_STAT(pvt, at_cmd_inline)++;
+        } else if (cmds[i].flags & ATQ_CMD_FLAG_STATIC) {
+            PVT_STAT(pvt, at_cmd_static)++;
+        } else if (cmds[i].data) {
+            PVT_STAT(pvt, at_cmd_allocs)++;
+        }
+    }
+
+    if (prio) {
+        AST_LIST_INSERT_HEAD(&pvt->at_queue[e->qclass], e, entry);
     } else {
-        AST_LIST_INSERT_TAIL(&pvt->at_queue, e, entry);
+        AST_LIST_INSERT_TAIL(&pvt->at_queue[e->qclass], e, entry);
     }
 
     PVT_STATE(pvt, at_tasks)++;
     PVT_STATE(pvt, at_cmds) += cmdsno;
 
     if (e->cmdsno == 1u) {
-        ast_debug(4, "[%s][%s] \xE2\x86\xB5 [%s][%s] %s%s\n", PVT_ID(pvt), at_cmd2str(e->cmds[0].cmd), at_res2str(e->cmds[0].res),
-                  tmp_esc_nstr(e->cmds[0].data, e->cmds[0].length), prio ? "after head" : "at tail", at_once ? " at once" : "");
+        ast_debug(4, "[%s][%s] \xE2\x86\xB5 [%s][%s] %s %s%s\n", PVT_ID(pvt), at_cmd2str(e->cmds[0].cmd), at_res2str(e->cmds[0].res),
+                  tmp_esc_nstr(at_queue_cmd_data(&e->cmds[0]), e->cmds[0].length), at_queue_class2str(e->qclass), prio ? "at head" : "at tail", at_once ? " at once" : "");
     } else {
-        ast_debug(4, "[%s][%s] \xE2\x86\xB5 [%s] cmds:%u %s%s\n", PVT_ID(pvt), at_cmd2str(e->cmds[0].cmd), at_res2str(e->cmds[0].res), e->cmdsno,
-                  prio ? "after head" : "at tail", at_once ? " at once" : "");
+        ast_debug(4, "[%s][%s] \xE2\x86\xB5 [%s] cmds:%u %s %s%s\n", PVT_ID(pvt), at_cmd2str(e->cmds[0].cmd), at_res2str(e->cmds[0].res), e->cmdsno,
+                  at_queue_class2str(e->qclass), prio ? "at head" : "at tail", at_once ? " at once" : "");
     }
 
     return e;
 }
 
+static void at_queue_record_latency(struct pvt* const pvt, const at_queue_task_t* const task, const at_queue_cmd_t* const cmd, at_res_t res)
+{
+    if (ast_tvzero(task->sent) || (unsigned)cmd->cmd >= AT_CMDS_NUMBER) {
+        return;
+    }
+
+    const int64_t ms = ast_tvdiff_ms(ast_tvnow(), task->sent);
+    if (res == RES_TIMEOUT) {
+        /* expired command counts as answered at its timeout, next timeout grows */
+        at_latency_window_record(&pvt->at_recent[cmd->cmd], ms);
+    } else if (cmd->res == res) {
+        at_latency_record(&pvt->at_latency[cmd->cmd], ms);
+        at_latency_window_record(&pvt->at_recent[cmd->cmd], ms);
+    }
+}
+
+/*!
+ * \brief Get timeout of command being written
+ *
+ * With adaptive_timeout enabled timeout of queries with ATQ_CMD_FLAG_IGNORE is derived from latest latency
+ * observed on this device, not shorter than ATQ_CMD_TIMEOUT_SHORT and not longer than static timeout of command.
+ * Timeout of other commands restarts device, they always use static timeout, as do commands with
+ * static timeout of ATQ_CMD_TIMEOUT_LONG or more.
+ */
+static struct timeval at_queue_cmd_timeout(const struct pvt* const pvt, const at_queue_cmd_t* const cmd)
+{
+    if (!CONF_SHARED(pvt, adaptive_timeout) || !(cmd->flags & ATQ_CMD_FLAG_IGNORE) || cmd->cmd == CMD_USER || (unsigned)cmd->cmd >= AT_CMDS_NUMBER) {
+        return cmd->timeout;
+    }
+
+    const int64_t static_ms = ast_tvdiff_ms(cmd->timeout, ast_tv(0, 0));
+    if (static_ms <= ATQ_CMD_TIMEOUT_SHORT * 1000 || static_ms >= ATQ_CMD_TIMEOUT_LONG * 1000) {
+        return cmd->timeout;
+    }
+
+    const unsigned ms = at_latency_timeout(&pvt->at_recent[cmd->cmd], ATQ_CMD_TIMEOUT_SHORT * 1000u, (unsigned)static_ms);
+    if (!ms) {
+        return cmd->timeout;
+    }
+
+    return ast_tv(ms / 1000u, (ms % 1000u) * 1000u);
+}
+
+static void at_queue_cmd_sent(struct pvt* const pvt, at_queue_task_t* const task, at_queue_cmd_t* const cmd)
+{
+    task->sent   = ast_tvnow();
+    cmd->timeout = ast_tvadd(task->sent, at_queue_cmd_timeout(pvt, cmd));
+}
+
 static void at_queue_remove_cmd(struct pvt* pvt, at_res_t res)
 {
-    at_queue_task_t* const task = AST_LIST_FIRST(&pvt->at_queue);
+    at_queue_task_t* const task = pvt->at_task;
     if (!task) {
         return;
     }
 
     if (task->at_once) {
+        at_queue_record_latency(pvt, task, &task->cmds[0], res);
+
         task->cindex             = task->cmdsno;
         PVT_STATE(pvt, at_cmds) -= task->cmdsno;
 
@@ -124,6 +312,7 @@ static void at_queue_remove_cmd(struct pvt* pvt, at_res_t res)
         // U+229F : Squared Minus : 0xE2 0x8A 0x9F
         const unsigned index = task->cindex;
 
+        at_queue_record_latency(pvt, task, &task->cmds[index], res);
         task->cindex++;
         PVT_STATE(pvt, at_cmds)--;
         if (task->cmds[index].res == res) {
@@ -136,13 +325,25 @@ static void at_queue_remove_cmd(struct pvt* pvt, at_res_t res)
 
         if ((task->cindex >= task->cmdsno) || (task->cmds[index].res != res && !(task->cmds[index].flags & ATQ_CMD_FLAG_IGNORE)) || res == RES_TIMEOUT) {
             at_queue_remove(pvt);
+        } else if (task->pipelined > 1u && task->cmds[index].res == res) {
+            /* next command is already written in same command line */
+            at_queue_cmd_t* const cmd = &task->cmds[task->cindex];
+
+            task->pipelined--;
+            task->pipeline_info = 0;
+            at_queue_cmd_sent(pvt, task, cmd);
+            at_queue_free_data(cmd);
+        } else {
+            /* modem skips rest of command line after failure, remaining commands are written again one by one */
+            task->pipelined     = 0;
+            task->pipeline_info = 0;
         }
     }
 }
 
 static void at_queue_remove_task_at_once(struct pvt* const pvt)
 {
-    at_queue_task_t* const task = AST_LIST_FIRST(&pvt->at_queue);
+    at_queue_task_t* const task = pvt->at_task;
 
     if (task && task->at_once) {
         task->cindex             = task->cmdsno;
@@ -154,6 +355,156 @@ static void at_queue_remove_task_at_once(struct pvt* const pvt)
     }
 }
 
+/*!
+ * \brief Get the only information response of query which may be written in pipelined command line
+ *
+ * Responses are attributed to pipelined commands by type, so queries answered
+ * with untagged lines (CGMI, CGMM, CGSN, CIMI) or with responses the modem
+ * also reports unsolicited (+CPIN, +CREG, +CEREG, +CSQ) are written alone.
+ *
+ * \return RES_PARSE_ERROR if command must be written alone
+ */
+static at_res_t at_queue_pipeline_res(at_cmd_t cmd)
+{
+    switch (cmd) {
+        case CMD_AT_COPS:
+            return RES_COPS;
+
+        case CMD_AT_CSPN:
+            return RES_CSPN;
+
+        case CMD_AT_QSPN:
+            return RES_QSPN;
+
+        case CMD_AT_CSCA:
+            return RES_CSCA;
+
+        case CMD_AT_CCLK:
+            return RES_CCLK;
+
+        case CMD_AT_CVOICE:
+            return RES_QPCMV;
+
+        case CMD_AT_CPCMREG:
+            return RES_CPCMREG;
+
+        default:
+            return RES_PARSE_ERROR;
+    }
+}
+
+/*!
+ * \brief Count consecutive queries starting from current command which may be written in one command line
+ */
+static unsigned at_queue_pipeline_size(const struct pvt* const pvt, const at_queue_task_t* const task)
+{
+    unsigned n = 0;
+
+    if (!CONF_SHARED(pvt, at_pipeline)) {
+        return 1u;
+    }
+
+    for (unsigned i = task->cindex; i < task->cmdsno && n < ATQ_PIPELINE_MAX; ++i, ++n) {
+        const at_queue_cmd_t* const cmd = &task->cmds[i];
+        const char* const data          = at_queue_cmd_data(cmd);
+
+        if (at_queue_pipeline_res(cmd->cmd) == RES_PARSE_ERROR || cmd->res != RES_OK || cmd->length < 3u || memcmp(data, "AT", 2) ||
+            data[cmd->length - 1u] != '\r') {
+            break;
+        }
+    }
+
+    return n ? n : 1u;
+}
+
+static int at_queue_run_pipelined(struct pvt* const pvt, at_queue_task_t* const task, unsigned n)
+{
+    at_queue_cmd_t* const cmd = &task->cmds[task->cindex];
+    size_t buflen             = 1u;
+
+    for (unsigned i = 0; i < n; ++i) {
+        buflen += task->cmds[task->cindex + i].length;
+    }
+
+    struct ast_str* buf = ast_str_thread_get(&at_line_buf, buflen);
+    if (!buf) {
+        return -1;
+    }
+    ast_str_reset(buf);
+
+    /* AT+CMD1;+CMD2;...\r */
+    for (unsigned i = 0; i < n; ++i) {
+        const at_queue_cmd_t* const c = &task->cmds[task->cindex + i];
+        const unsigned skip           = i ? 2u : 0u;
+
+        ast_str_append_substr(&buf, buflen, at_queue_cmd_data(c) + skip, c->length - skip - 1u);
+        ast_str_append_substr(&buf, buflen, (i < (n - 1u)) ? ";" : "\r", 1);
+    }
+
+    // U+21C9 : Rightwards Paired Arrows : 0xE2 0x87 0x89
+    ast_debug(2, "[%s][%s] \xE2\x87\x89 [%s] cmds:%u\n", PVT_ID(pvt), at_cmd2str(cmd->cmd), tmp_esc_str(buf), n);
+
+    const int fail = pvt_direct_write_str(pvt, buf);
+    if (fail) {
+        ast_log(LOG_ERROR, "[%s][%s] \xE2\xA5\x87 [%s]\n", PVT_ID(pvt), at_cmd2str(cmd->cmd), tmp_esc_str(buf));
+        at_queue_remove_cmd(pvt, cmd->res + 1);
+    } else {
+        PVT_STAT(pvt, at_pipeline_lines)++;
+        PVT_STAT(pvt, at_pipeline_cmds) += n;
+
+        task->pipelined     = n;
+        task->pipeline_info = 0;
+
+        /* only current command is marked as written, following ones are marked when they become current */
+        at_queue_cmd_sent(pvt, task, cmd);
+        at_queue_free_data(cmd);
+    }
+
+    return fail;
+}
+
+unsigned at_queue_pipeline_match(struct pvt* pvt, at_res_t res)
+{
+    at_queue_task_t* const task = pvt->at_task;
+
+    if (!task || task->pipelined < 2u) {
+        return 0;
+    }
+
+    const at_queue_cmd_t* const cmd = &task->cmds[task->cindex];
+
+    switch (res) {
+        case RES_ERROR:
+        case RES_CMS_ERROR:
+            /* current command answered already, failure belongs to next one */
+            return task->pipeline_info ? 1u : 0u;
+
+        case RES_UNKNOWN:
+        case RES_CPIN:
+        case RES_CREG:
+        case RES_CEREG:
+        case RES_CSQ:
+            /* may be unsolicited, never attributed to pipelined command */
+            return 0;
+
+        default:
+            break;
+    }
+
+    if (!task->pipeline_info && at_queue_pipeline_res(cmd->cmd) == res) {
+        task->pipeline_info = 1;
+        return 0;
+    }
+
+    for (unsigned i = 1u; i < task->pipelined; ++i) {
+        if (at_queue_pipeline_res(task->cmds[task->cindex + i].cmd) == res) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
 static size_t at_queue_get_total_cmd_len(const at_queue_task_t* const task)
 {
     size_t res = 0;
@@ -165,10 +516,63 @@ static size_t at_queue_get_total_cmd_len(const at_queue_task_t* const task)
     return res;
 }
 
+/*!
+ * \brief Take next task to send from the most urgent class
+ *
+ * Head of less urgent class is taken first when it waits longer than ATQ_CLASS_STARVATION_TIME
+ * and longer than head of the most urgent class.
+ */
+static at_queue_task_t* at_queue_select(struct pvt* const pvt)
+{
+    if (pvt->at_task) {
+        return pvt->at_task;
+    }
+
+    const struct timeval now = ast_tvnow();
+    at_queue_task_t* task    = NULL;
+    int starved              = 0;
+
+    for (unsigned i = 0; i < ATQ_CLASSES; ++i) {
+        at_queue_task_t* const t = AST_LIST_FIRST(&pvt->at_queue[i]);
+        if (!t) {
+            continue;
+        }
+
+        if (!task) {
+            task = t;
+        } else if (ast_tvdiff_ms(now, t->queued) >= ATQ_CLASS_STARVATION_TIME && ast_tvcmp(t->queued, task->queued) < 0) {
+            task    = t;
+            starved = 1;
+        }
+    }
+
+    if (!task) {
+        return NULL;
+    }
+
+    AST_LIST_REMOVE_HEAD(&pvt->at_queue[task->qclass], entry);
+    pvt->at_task = task;
+
+    const int64_t wait = ast_tvdiff_ms(now, task->queued);
+
+    PVT_STAT(pvt, at_class_tasks[task->qclass])++;
+    PVT_STAT(pvt, at_class_wait[task->qclass]) += (uint64_t)wait;
+    if (wait > PVT_STAT(pvt, at_class_wait_max[task->qclass])) {
+        PVT_STAT(pvt, at_class_wait_max[task->qclass]) = (uint32_t)wait;
+    }
+
+    if (starved) {
+        PVT_STAT(pvt, at_class_starved)++;
+        ast_debug(3, "[%s][%s] Starving %s task waited %ld ms\n", PVT_ID(pvt), at_cmd2str(task->cmds[0].cmd), at_queue_class2str(task->qclass), (long)wait);
+    }
+
+    return task;
+}
+
 int at_queue_run(struct pvt* pvt)
 {
     int fail                 = 0;
-    at_queue_task_t* const t = AST_LIST_FIRST(&pvt->at_queue);
+    at_queue_task_t* const t = at_queue_select(pvt);
     if (!t) {
         return fail;
     }
@@ -182,10 +586,13 @@ int at_queue_run(struct pvt* pvt)
         buflen += 2u;         // AT + (semicolon separated commands)
         buflen += t->cmdsno;  // number of semicolons
 
-        struct ast_str* buf = ast_str_create(buflen);
+        struct ast_str* buf = ast_str_thread_get(&at_line_buf, buflen);
+        if (!buf) {
+            return -1;
+        }
         ast_str_set_substr(&buf, buflen, "AT", 2);
         for (unsigned i = 0; i < t->cmdsno; ++i) {
-            ast_str_append_substr(&buf, buflen, t->cmds[i].data, t->cmds[i].length);
+            ast_str_append_substr(&buf, buflen, at_queue_cmd_data(&t->cmds[i]), t->cmds[i].length);
             ast_str_append_substr(&buf, buflen, (i < (t->cmdsno - 1u)) ? ";" : "\r", 1);
         }
 
@@ -201,25 +608,28 @@ int at_queue_run(struct pvt* pvt)
             for (unsigned i = 0; i < t->cmdsno; ++i) {
                 at_queue_free_data(&t->cmds[i]);
             }
-            at_queue_cmd_t* const cmd = &(t->cmds[0]);
-            cmd->timeout              = ast_tvadd(ast_tvnow(), cmd->timeout);
+            at_queue_cmd_sent(pvt, t, &t->cmds[0]);
         }
-        ast_free(buf);
     } else {
         at_queue_cmd_t* const cmd = &(t->cmds[t->cindex]);
         if (!cmd->length) {
             return fail;
         }
 
-        ast_debug(2, "[%s][%s] \xE2\x86\x92 [%s]\n", PVT_ID(pvt), at_cmd2str(cmd->cmd), tmp_esc_nstr(cmd->data, cmd->length));
+        const unsigned n = at_queue_pipeline_size(pvt, t);
+        if (n > 1u) {
+            return at_queue_run_pipelined(pvt, t, n);
+        }
+
+        ast_debug(2, "[%s][%s] \xE2\x86\x92 [%s]\n", PVT_ID(pvt), at_cmd2str(cmd->cmd), tmp_esc_nstr(at_queue_cmd_data(cmd), cmd->length));
 
-        fail = pvt_direct_write(pvt, cmd->data, cmd->length);
+        fail = pvt_direct_write(pvt, at_queue_cmd_data(cmd), cmd->length);
         if (fail) {
-            ast_log(LOG_ERROR, "[%s][%s] \xE2\xA5\x87 [%s]\n", PVT_ID(pvt), at_cmd2str(cmd->cmd), tmp_esc_nstr(cmd->data, cmd->length));
+            ast_log(LOG_ERROR, "[%s][%s] \xE2\xA5\x87 [%s]\n", PVT_ID(pvt), at_cmd2str(cmd->cmd), tmp_esc_nstr(at_queue_cmd_data(cmd), cmd->length));
             at_queue_remove_cmd(pvt, cmd->res + 1);
         } else {
             /* set expire time */
-            cmd->timeout = ast_tvadd(ast_tvnow(), cmd->timeout);
+            at_queue_cmd_sent(pvt, t, cmd);
 
             /* free data and mark as written */
             at_queue_free_data(cmd);
@@ -237,7 +647,7 @@ int at_queue_run_immediately(struct pvt* pvt)
     size_t pos    = 1u;
     at_queue_task_t* task;
 
-    AST_LIST_TRAVERSE(&pvt->at_queue, task, entry) {
+    AT_QUEUE_TRAVERSE(pvt, task) {
         if (!task->at_once) {
             continue;
         }
@@ -251,17 +661,20 @@ int at_queue_run_immediately(struct pvt* pvt)
 
     buflen              += 2u;
     buflen              += cmdsno;
-    struct ast_str* buf  = ast_str_create(buflen);
+    struct ast_str* buf  = ast_str_thread_get(&at_line_buf, buflen);
+    if (!buf) {
+        return -1;
+    }
 
     ast_str_set_substr(&buf, buflen, "AT", 2);
 
-    AST_LIST_TRAVERSE(&pvt->at_queue, task, entry) {
+    AT_QUEUE_TRAVERSE(pvt, task) {
         if (!task->at_once) {
             continue;
         }
         for (unsigned i = 0; i < task->cmdsno; ++i) {
             if (task->cmds[i].length) {
-                ast_str_append_substr(&buf, buflen, task->cmds[i].data, task->cmds[i].length);
+                ast_str_append_substr(&buf, buflen, at_queue_cmd_data(&task->cmds[i]), task->cmds[i].length);
                 ast_str_append_substr(&buf, buflen, (pos < cmdsno) ? ";" : "\r", 1);
             }
             pos += 1u;
@@ -277,7 +690,6 @@ int at_queue_run_immediately(struct pvt* pvt)
         ast_log(LOG_WARNING, "[%s] \xE2\x87\x8F [%s]\n", PVT_ID(pvt), tmp_esc_str(buf));
     }
 
-    ast_free(buf);
     return fail;
 }
 
@@ -316,12 +728,51 @@ void at_queue_handle_result(struct pvt* pvt, at_res_t res) { at_queue_remove_cmd
 
 void at_queue_flush(struct pvt* pvt)
 {
-    while (AST_LIST_FIRST(&pvt->at_queue)) {
-        at_queue_remove(pvt);
+    at_queue_remove(pvt);
+
+    for (unsigned i = 0; i < ATQ_CLASSES; ++i) {
+        while ((pvt->at_task = AST_LIST_REMOVE_HEAD(&pvt->at_queue[i], entry))) {
+            at_queue_remove(pvt);
+        }
+    }
+}
+
+void at_queue_pool_free(struct pvt* pvt)
+{
+    at_queue_task_t* task;
+
+    while ((task = AST_LIST_REMOVE_HEAD(&pvt->at_task_pool, entry))) {
+        ast_free(task);
+    }
+    pvt->at_task_pool_size = 0;
+}
+
+const struct at_queue_task* at_queue_head_task(const struct pvt* pvt) { return pvt->at_task; }
+
+static at_queue_task_t* at_queue_first_pending(const struct pvt* pvt, unsigned qclass)
+{
+    for (; qclass < ATQ_CLASSES; ++qclass) {
+        at_queue_task_t* const task = AST_LIST_FIRST(&pvt->at_queue[qclass]);
+        if (task) {
+            return task;
+        }
     }
+    return NULL;
 }
 
-const struct at_queue_task* at_queue_head_task(const struct pvt* pvt) { return AST_LIST_FIRST(&pvt->at_queue); }
+at_queue_task_t* at_queue_next(const struct pvt* pvt, const at_queue_task_t* task)
+{
+    if (!task) {
+        return pvt->at_task ? pvt->at_task : at_queue_first_pending(pvt, 0u);
+    }
+
+    if (task == pvt->at_task) {
+        return at_queue_first_pending(pvt, 0u);
+    }
+
+    at_queue_task_t* const next = AST_LIST_NEXT(task, entry);
+    return next ? next : at_queue_first_pending(pvt, task->qclass + 1u);
+}
 
 const at_queue_cmd_t* at_queue_head_cmd(const struct pvt* pvt) { return at_queue_task_cmd(at_queue_head_task(pvt)); }
 
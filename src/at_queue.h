@@ -34,6 +34,7 @@ typedef struct at_queue_cmd {
 #define ATQ_CMD_FLAG_STATIC 0x01         /*!< data is static no try deallocate */
 #define ATQ_CMD_FLAG_IGNORE 0x02         /*!< ignore response non match condition */
 #define ATQ_CMD_FLAG_SUPPRESS_ERROR 0x04 /*!< don't print error message if command fails */
+#define ATQ_CMD_FLAG_INLINE 0x08         /*!< data is stored in buf, not allocated */
 
     struct timeval timeout;      /*!< timeout value, started at time when command actually written on device */
 #define ATQ_CMD_TIMEOUT_SHORT 1  /*!< timeout value  1 sec */
@@ -42,8 +43,13 @@ typedef struct at_queue_cmd {
 
     void* data;      /*!< command and data to send in device */
     unsigned length; /*!< data length */
+
+#define ATQ_CMD_INLINE_LEN 32
+    char buf[ATQ_CMD_INLINE_LEN]; /*!< storage of short formatted command, see ATQ_CMD_FLAG_INLINE */
 } at_queue_cmd_t;
 
+static inline const char* at_queue_cmd_data(const at_queue_cmd_t* cmd) { return (cmd->flags & ATQ_CMD_FLAG_INLINE) ? cmd->buf : (const char*)cmd->data; }
+
 /* initializers */
 #define ATQ_CMD_INIT_STF(e, icmd, iflags, idata)            \
     do {                                                    \
@@ -91,6 +97,11 @@ typedef struct at_queue_cmd {
 #define ATQ_CMD_DECLARE_DYNI(cmd) ATQ_CMD_DECLARE_DYNF(cmd, RES_OK, ATQ_CMD_FLAG_IGNORE)
 #define ATQ_CMD_DECLARE_DYNIT(cmd, s, u) ATQ_CMD_DECLARE_DYNFT(cmd, RES_OK, ATQ_CMD_FLAG_IGNORE, s, u)
 
+#define ATQ_CLASS_STARVATION_TIME 2000 /*!< milliseconds, task waiting longer is sent before more urgent classes */
+#define ATQ_PIPELINE_MAX 8             /*!< maximal number of queries sent in one command line */
+#define ATQ_POOL_CMDS 4                /*!< number of commands in tasks kept in per-device pool */
+#define ATQ_POOL_SIZE 16               /*!< maximal number of free tasks kept in per-device pool */
+
 typedef struct at_queue_task {
     AST_LIST_ENTRY(at_queue_task) entry;
 
@@ -99,6 +110,12 @@ typedef struct at_queue_task {
     struct cpvt* cpvt;
     int uid;
     unsigned at_once:1;
+    unsigned pooled:1;        /*!< task has room for ATQ_POOL_CMDS commands and returns to pool when freed */
+    unsigned pipeline_info:1; /*!< information response of current pipelined command received */
+    unsigned pipelined;       /*!< number of commands of written command line not completed yet, current included */
+    at_queue_class_t qclass; /*!< priority class, most urgent of commands */
+    struct timeval queued;   /*!< time when task was added to queue */
+    struct timeval sent;     /*!< time when current command was written */
     at_queue_cmd_t cmds[0]; /* this field must be last */
 } at_queue_task_t;
 
@@ -110,12 +127,24 @@ int at_queue_insert(struct cpvt* cpvt, at_queue_cmd_t* cmds, unsigned cmdsno, in
 int at_queue_insert_uid(struct cpvt* cpvt, at_queue_cmd_t* cmds, unsigned cmdsno, int athead, int uid);
 void at_queue_handle_result(struct pvt* pvt, at_res_t res);
 void at_queue_flush(struct pvt* pvt);
+void at_queue_pool_free(struct pvt* pvt);
 const at_queue_task_t* at_queue_head_task(const struct pvt* pvt);
 const at_queue_cmd_t* at_queue_head_cmd(const struct pvt* pvt);
 int at_queue_timeout(const struct pvt* pvt, int* diff);
 int at_queue_run(struct pvt* pvt);
 int at_queue_run_immediately(struct pvt* pvt);
 
+/*!
+ * \brief Attribute response to command of pipelined command line
+ * \return number of commands before one the response belongs to, they are completed as the modem went past them
+ */
+unsigned at_queue_pipeline_match(struct pvt* pvt, at_res_t res);
+
+/*! \brief Next task in order of sending, task being sent first, then pending tasks by class */
+at_queue_task_t* at_queue_next(const struct pvt* pvt, const at_queue_task_t* task);
+
+#define AT_QUEUE_TRAVERSE(pvt, task) for (task = at_queue_next(pvt, NULL); task; task = at_queue_next(pvt, task))
+
 static inline const at_queue_cmd_t* at_queue_task_cmd(const at_queue_task_t* task) { return task ? &task->cmds[task->at_once ? 0u : task->cindex] : NULL; }
 
 #endif /* CHAN_QUECTEL_AT_CMD_QUEUE_H_INCLUDED */
@@ -23,6 +23,7 @@
 
 #include "at_read.h"
 
+#include "at_trace.h"
 #include "chan_quectel.h"
 #include "helpers.h"
 #include "ringbuffer.h"
@@ -50,7 +51,7 @@ int at_wait(int fd, int* ms)
 
 #/* return number of bytes read */
 
-ssize_t at_read(const char* dev, int fd, struct ringbuffer* rb)
+ssize_t at_read(const char* dev, int fd, struct ringbuffer* rb, struct at_trace* trace)
 {
     struct iovec iov[2];
     ssize_t n = -1;
@@ -69,10 +70,24 @@ ssize_t at_read(const char* dev, int fd, struct ringbuffer* rb)
 
             return 0;
         } else if (n > 0) {
+            if (at_trace_enabled(trace)) {
+                /* read data occupies beginning of io vectors passed to readv() */
+                if ((size_t)n > iov[0].iov_len) {
+                    iov[1].iov_len = n - iov[0].iov_len;
+                } else {
+                    iov[0].iov_len = n;
+                    iovcnt         = 1;
+                }
+                at_trace_write_iov(trace, AT_TRACE_RX, iov, iovcnt);
+            }
             rb_write_upd(rb, n);
 
             ast_debug(6, "[%s] receive %zu byte, used %zu, free %zu, read %zu, write %zu\n", dev, n, rb_used(rb), rb_free(rb), rb->read, rb->write);
 
+            if (!DEBUG_ATLEAST(5)) {
+                return n;
+            }
+
             iovcnt = rb_read_all_iov(rb, iov);
 
             if (iovcnt > 0) {
@@ -95,7 +110,7 @@ void at_clean_data(const char* dev, int fd, struct ringbuffer* const rb)
 {
     rb_reset(rb);
     for (int t = 0; at_wait(fd, &t); t = 0) {
-        const int iovcnt = at_read(dev, fd, rb);
+        const int iovcnt = at_read(dev, fd, rb, NULL);
         if (iovcnt) {
             ast_debug(4, "[%s] Drop %u bytes of pending data\n", dev, (unsigned)rb_used(rb));
         }
@@ -173,8 +188,7 @@ int at_read_result_iov(const char* dev, int* read_result, size_t* skip, struct r
     static const char M_CDS[]        = "+CDS:";
     static const char M_CLASS0[]     = "+CLASS0:";
 
-    static const char T_OK[]   = "\r\n\r\nOK\r\n";
-    static const char T_CMGL[] = "\r\n+CMGL:";
+    static const char T_OK[] = "\r\n\r\nOK\r\n";
 
     size_t s = rb_used(rb);
 
@@ -222,19 +236,9 @@ int at_read_result_iov(const char* dev, int* read_result, size_t* skip, struct r
                 }
 
                 return iovcnt;
-            } else if (!rb_memcmp(rb, M_CMGL, STRLEN(M_CMGL))) {
-                int iovcnt = rb_read_until_mem_iov(rb, iov, T_CMGL, STRLEN(T_CMGL));
-                if (iovcnt) {
-                    *skip += 2;
-                } else {
-                    iovcnt = rb_read_until_mem_iov(rb, iov, T_OK, STRLEN(T_OK));
-                    if (iovcnt) {
-                        *skip += 4;
-                    }
-                }
-                return iovcnt;
-            } else if (!(rb_memcmp(rb, M_CMT, STRLEN(M_CMT)) && rb_memcmp(rb, M_CBM, STRLEN(M_CBM)) && rb_memcmp(rb, M_CDS, STRLEN(M_CDS)) &&
-                         rb_memcmp(rb, M_CLASS0, STRLEN(M_CLASS0)))) {
+            } else if (!(rb_memcmp(rb, M_CMGL, STRLEN(M_CMGL)) && rb_memcmp(rb, M_CMT, STRLEN(M_CMT)) && rb_memcmp(rb, M_CBM, STRLEN(M_CBM)) &&
+                         rb_memcmp(rb, M_CDS, STRLEN(M_CDS)) && rb_memcmp(rb, M_CLASS0, STRLEN(M_CLASS0)))) {
+                /* header and PDU line, every +CMGL entry is passed on as soon as its PDU is complete */
                 s = get_2ndeol_pos(rb, iov, buf);
                 if (s) {
                     *read_result  = 0;
@@ -7,9 +7,10 @@
 struct pvt;
 struct ringbuffer;
 struct iovec;
+struct at_trace;
 
 int at_wait(int fd, int* ms);
-ssize_t at_read(const char* dev, int fd, struct ringbuffer* rb);
+ssize_t at_read(const char* dev, int fd, struct ringbuffer* rb, struct at_trace* trace);
 void at_clean_data(const char* dev, int fd, struct ringbuffer* const rb);
 
 size_t at_get_iov_size(const struct iovec* iov);
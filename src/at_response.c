@@ -19,9 +19,11 @@
 #include <asterisk/json.h>
 #include <asterisk/logger.h> /* ast_debug() */
 #include <asterisk/pbx.h>    /* ast_pbx_start() */
+#include <asterisk/threadstorage.h>
 
 #include "at_response.h"
 
+#include "at_batch.h"
 #include "at_parse.h"
 #include "at_queue.h"
 #include "at_read.h"
@@ -31,6 +33,7 @@
 #include "error.h"
 #include "helpers.h"
 #include "mutils.h" /* STRLEN() */
+#include "sms_submit.h"
 #include "smsdb.h"
 
 // ================================================================
@@ -142,7 +145,7 @@ static void request_clcc(struct pvt* pvt)
     }
 }
 
-static int at_response_cmgs_error(struct pvt*, const at_queue_task_t* const);
+static int at_response_cmgs_error(struct pvt*, const at_res_t, const at_queue_task_t* const);
 
 static void __attribute__((format(printf, 7, 8))) at_ok_response_log(int level, const char* file, int line, const char* function, const struct pvt* const pvt,
                                                                      const at_queue_cmd_t* const ecmd, const char* const fmt, ...)
@@ -180,6 +183,21 @@ static void __attribute__((format(printf, 7, 8))) at_ok_response_log(int level,
 #define at_ok_response_wrn(pvt, ecmd, ...) at_ok_response_log(LOG_WARNING, pvt, ecmd, __VA_ARGS__)
 #define at_ok_response_notice(pvt, ecmd, ...) at_ok_response_log(LOG_NOTICE, pvt, ecmd, __VA_ARGS__)
 
+/* enqueue deletion of messages collected while processing +CMGL */
+static void at_sms_delete_pending(struct pvt* const pvt)
+{
+    const unsigned int cnt = (unsigned int)AST_VECTOR_SIZE(&pvt->sms_delete_pending);
+    if (!cnt) {
+        return;
+    }
+
+    ast_debug(1, "[%s] Deleting %u listed messages\n", PVT_ID(pvt), cnt);
+    if (at_enqueue_delete_sms_batch(&pvt->sys_chan, AST_VECTOR_GET_ADDR(&pvt->sms_delete_pending, 0), cnt, CONF_SHARED(pvt, msg_delete_batch))) {
+        ast_log(LOG_ERROR, "[%s] Error deleting listed messages: %s\n", PVT_ID(pvt), error2str(chan_quectel_err));
+    }
+    AST_VECTOR_RESET(&pvt->sms_delete_pending, AST_VECTOR_ELEM_CLEANUP_NOOP);
+}
+
 static int at_response_ok(struct pvt* const pvt, const at_res_t at_res, const at_queue_task_t* const task, const at_queue_cmd_t* const ecmd)
 {
     if (!ecmd) {
@@ -200,7 +218,6 @@ static int at_response_ok(struct pvt* const pvt, const at_res_t at_res, const at
         case CMD_AT_CGMM:
         case CMD_AT_CGMR:
         case CMD_AT_CMEE:
-        case CMD_AT_CGSN:
         case CMD_AT_CIMI:
         case CMD_AT_CPIN:
         case CMD_AT_CCWA_SET:
@@ -220,10 +237,20 @@ static int at_response_ok(struct pvt* const pvt, const at_res_t at_res, const at
         case CMD_AT_QLTS:
         case CMD_AT_QLTS_1:
         case CMD_AT_CCLK:
+        case CMD_AT_CMMS:
             // U+2713 : Check mark
             at_ok_response_dbg(3, pvt, ecmd, NULL);
             break;
 
+        case CMD_AT_CGSN:
+            at_ok_response_dbg(3, pvt, ecmd, NULL);
+            /* IMEI not reported, cached identity can't be confirmed */
+            if (pvt->identity_cached && ast_strlen_zero(pvt->imei)) {
+                pvt_identity_restore(pvt);
+                at_enqueue_identity(task->cpvt);
+            }
+            break;
+
         case CMD_AT_FINAL:
             ast_verb(1, "[%s] Channel initialized\n", PVT_ID(pvt));
             if (CONF_UNIQ(pvt, uac) == TRIBOOL_NONE) {
@@ -233,7 +260,8 @@ static int at_response_ok(struct pvt* const pvt, const at_res_t at_res, const at
                 at_enqueue_list_messages(task->cpvt, MSG_STAT_REC_UNREAD);
             }
             at_enqueue_csq(task->cpvt);
-            pvt->initialized = 1;
+            pvt_initialized(pvt);
+            sms_submit_run(pvt);
             break;
 
         case CMD_AT_COPS_INIT:
@@ -347,8 +375,9 @@ static int at_response_ok(struct pvt* const pvt, const at_res_t at_res, const at
         case CMD_AT_CPCMREG1:
             at_ok_response_dbg(3, pvt, ecmd, NULL);
             if (!pvt->initialized) {
-                pvt->initialized = 1;
+                pvt_initialized(pvt);
                 ast_verb(3, "[%s] SimCom initialized and ready\n", PVT_ID(pvt));
+                sms_submit_run(pvt);
             }
             break;
 
@@ -456,6 +485,7 @@ static int at_response_ok(struct pvt* const pvt, const at_res_t at_res, const at
 
         case CMD_AT_CMGL:
             at_ok_response_dbg(1, pvt, ecmd, "Messages listed");
+            at_sms_delete_pending(pvt);
             break;
 
         case CMD_AT_CNMA:
@@ -508,6 +538,7 @@ static int at_response_ok(struct pvt* const pvt, const at_res_t at_res, const at
             break;
 
         case CMD_USER:
+            at_batch_result(pvt, task, at_res);
             break;
 
         default:
@@ -750,15 +781,19 @@ static int at_response_error(struct pvt* const pvt, const at_res_t at_res, const
 
         case CMD_AT_CMGS:
             at_err_response_err(pvt, ecmd, "[SMS:%d] Error sending message", task->uid);
-            at_response_cmgs_error(pvt, task);
+            at_response_cmgs_error(pvt, at_res, task);
             pvt_try_restate(pvt);
             break;
 
+        case CMD_AT_CMMS:
+            at_err_response_dbg(3, pvt, ecmd, "Module does not keep relay link open");
+            break;
+
         case CMD_AT_SMSTEXT: {
             const at_cmd_t cmd = task->cmds[0].cmd;
             if (cmd == CMD_AT_CMGS) {
                 at_err_response_err(pvt, ecmd, "[SMS:%d] Error sending message", task->uid);
-                at_response_cmgs_error(pvt, task);
+                at_response_cmgs_error(pvt, at_res, task);
                 pvt_try_restate(pvt);
             } else if (cmd == CMD_AT_CNMA) {
                 at_err_response_err(pvt, ecmd, "[SMS:%d] Cannot acknowledge message", task->uid);
@@ -842,6 +877,7 @@ static int at_response_error(struct pvt* const pvt, const at_res_t at_res, const
 
         case CMD_AT_CMGL:
             at_err_response_dbg(1, pvt, ecmd, "Cannot list messages");
+            at_sms_delete_pending(pvt);
             break;
 
         case CMD_AT_CNMA:
@@ -887,6 +923,7 @@ static int at_response_error(struct pvt* const pvt, const at_res_t at_res, const
             break;
 
         case CMD_USER:
+            at_batch_result(pvt, task, at_res);
             break;
 
         default:
@@ -1423,8 +1460,11 @@ static int at_response_cmgs(struct pvt* const pvt, const struct ast_str* const r
         return -1;
     }
 
-    const int partcnt = task->cmdsno / 2;
-    const int partno  = 1 + (task->cindex / 2);
+    /* parts of message accepted before retry are not in AT task */
+    const struct sms_submit* const sms = pvt->sms_queue.active;
+    const int active                   = sms && sms->uid == task->uid;
+    const int partcnt                  = active ? (int)sms->parts : task->cmdsno / 2;
+    const int partno                   = active ? (int)sms->part + 1 : 1 + (task->cindex / 2);
 
     if (partno < partcnt) {
         ast_debug(3, "[%s][SMS:%d REF:%d] Successfully sent message part %d/%d\n", PVT_ID(pvt), task->uid, refid, partno, partcnt);
@@ -1434,8 +1474,9 @@ static int at_response_cmgs(struct pvt* const pvt, const struct ast_str* const r
         } else {
             ast_verb(1, "[%s][SMS:%d] Successfully sent message [%d parts]\n", PVT_ID(pvt), task->uid, partcnt);
         }
+    }
 
-        pvt->outgoing_sms = 0;
+    if (sms_submit_sent(pvt, task->uid)) {
         pvt_try_restate(pvt);
     }
 
@@ -1457,8 +1498,12 @@ static int at_response_cmgs(struct pvt* const pvt, const struct ast_str* const r
     return 0;
 }
 
-static int at_response_cmgs_error(struct pvt* const pvt, const at_queue_task_t* const task)
+static int at_response_cmgs_error(struct pvt* const pvt, const at_res_t at_res, const at_queue_task_t* const task)
 {
+    if (sms_submit_failed(pvt, task->uid, (at_res == RES_CMS_ERROR) ? pvt->cms_error : -1)) {
+        return 0;
+    }
+
     RAII_VAR(struct ast_str*, dst, ast_str_create(DST_DEF_LEN), ast_free);
     RAII_VAR(struct ast_str*, msg, ast_str_create(DST_DEF_LEN), ast_free);
 
@@ -1472,7 +1517,6 @@ static int at_response_cmgs_error(struct pvt* const pvt, const at_queue_task_t*
     } else {
         ast_verb(1, "[%s][SMS:%d] Error sending message\n", PVT_ID(pvt), task->uid);
     }
-    pvt->outgoing_sms = 0;
     return 0;
 }
 
@@ -1552,10 +1596,16 @@ static int at_response_cdsi(struct pvt* const pvt, const struct ast_str* const r
  * \retval -1 error
  */
 
+/* decoding buffers reused by every message handled on the thread */
+AST_THREADSTORAGE(msg_buf);
+AST_THREADSTORAGE(msg_oa_buf);
+AST_THREADSTORAGE(msg_sca_buf);
+
 static int at_response_msg(struct pvt* const pvt, const struct ast_str* const response, at_res_t cmd)
 {
     static const ssize_t MSG_DEF_LEN = 64;
     static const ssize_t MSG_MAX_LEN = 4096;
+    static const size_t ADDR_LEN     = 512;
 
     struct ast_tm scts, dt;
     int mr, st;
@@ -1571,9 +1621,17 @@ static int at_response_msg(struct pvt* const pvt, const struct ast_str* const re
     memset(&scts, 0, sizeof(scts));
     memset(&dt, 0, sizeof(dt));
 
-    RAII_VAR(struct ast_str*, msg, ast_str_create(MSG_MAX_LEN), ast_free);
-    RAII_VAR(struct ast_str*, oa, ast_str_create(512), ast_free);
-    RAII_VAR(struct ast_str*, sca, ast_str_create(512), ast_free);
+    struct ast_str* const msg = ast_str_thread_get(&msg_buf, MSG_MAX_LEN);
+    struct ast_str* const oa  = ast_str_thread_get(&msg_oa_buf, ADDR_LEN);
+    struct ast_str* const sca = ast_str_thread_get(&msg_sca_buf, ADDR_LEN);
+    if (!msg || !oa || !sca) {
+        ast_log(LOG_ERROR, "[%s] Unable to allocate message buffers\n", PVT_ID(pvt));
+        return -1;
+    }
+
+    ast_str_reset(msg);
+    ast_str_reset(oa);
+    ast_str_reset(sca);
     size_t msg_len = ast_str_size(msg);
 
     switch (cmd) {
@@ -1711,7 +1769,11 @@ msg_done:
     if (CONF_SHARED(pvt, sms_autodelete) && msg_complete) {
         switch (cmd) {
             case RES_CMGL:
-                at_enqueue_delete_sms(&pvt->sys_chan, idx, TRIBOOL_NONE);
+                if (CONF_SHARED(pvt, msg_delete_batch) > 0) {
+                    AST_VECTOR_APPEND(&pvt->sms_delete_pending, idx);
+                } else {
+                    at_enqueue_delete_sms(&pvt->sys_chan, idx, TRIBOOL_NONE);
+                }
                 goto msg_ret;
 
             default:
@@ -2060,6 +2122,7 @@ static int at_response_qspn(struct pvt* const pvt, const struct ast_str* const r
     ast_string_field_set(pvt, network_name, fnn);
     ast_string_field_set(pvt, short_network_name, snn);
     ast_string_field_set(pvt, provider_name, spn);
+    pvt_update_index(pvt);
     return 0;
 }
 
@@ -2073,6 +2136,7 @@ static int at_response_cspn(struct pvt* const pvt, const struct ast_str* const r
     }
 
     ast_string_field_set(pvt, provider_name, spn);
+    pvt_update_index(pvt);
     ast_verb(1, "[%s] Service provider: %s\n", PVT_ID(pvt), pvt->provider_name);
     return 0;
 }
@@ -2166,31 +2230,21 @@ static int at_response_creg(struct pvt* const pvt, int cereg, const struct ast_s
     return 0;
 }
 
-/*!
- * \brief Handle AT+CGMI response
- * \param pvt -- pvt structure
- * \param response -- string containing response
- * \retval  0 success
- * \retval -1 error
- */
-
-static int at_response_cgmi(struct pvt* const pvt, const struct ast_str* const response)
+/* vendor specific initialization selected by manufacturer */
+static int at_enqueue_initialization_vendor(struct pvt* const pvt)
 {
-    ast_string_field_set(pvt, manufacturer, ast_str_buffer(response));
-    ast_verb(3, "[%s] Manufacturer: %s\n", PVT_ID(pvt), pvt->manufacturer);
-
-    if (!strncasecmp(ast_str_buffer(response), MANUFACTURER_QUECTEL, STRLEN(MANUFACTURER_QUECTEL))) {
+    if (!strncasecmp(pvt->manufacturer, MANUFACTURER_QUECTEL, STRLEN(MANUFACTURER_QUECTEL))) {
         ast_verb(1, "[%s] Quectel module\n", PVT_ID(pvt));
         pvt->is_simcom = 0;
         pvt->has_voice = 0;
         return at_enqueue_initialization_quectel(&pvt->sys_chan, CONF_SHARED(pvt, dsci));
-    } else if (!strncasecmp(ast_str_buffer(response), MANUFACTURER_SIMCOM, STRLEN(MANUFACTURER_SIMCOM))) {
+    } else if (!strncasecmp(pvt->manufacturer, MANUFACTURER_SIMCOM, STRLEN(MANUFACTURER_SIMCOM))) {
         ast_verb(1, "[%s] SimCOM module\n", PVT_ID(pvt));
         pvt->is_simcom = 1;
         pvt->has_voice = 0;
         return at_enqueue_initialization_simcom(&pvt->sys_chan);
     } else {
-        ast_log(LOG_WARNING, "[%s] Unknown module manufacturer: %s", PVT_ID(pvt), ast_str_buffer(response));
+        ast_log(LOG_WARNING, "[%s] Unknown module manufacturer: %s", PVT_ID(pvt), pvt->manufacturer);
         pvt->has_voice = 0;
         return at_enqueue_initialization_other(&pvt->sys_chan);
     }
@@ -2198,6 +2252,21 @@ static int at_response_cgmi(struct pvt* const pvt, const struct ast_str* const r
     return 0;
 }
 
+/*!
+ * \brief Handle AT+CGMI response
+ * \param pvt -- pvt structure
+ * \param response -- string containing response
+ * \retval  0 success
+ * \retval -1 error
+ */
+
+static int at_response_cgmi(struct pvt* const pvt, const struct ast_str* const response)
+{
+    ast_string_field_set(pvt, manufacturer, ast_str_buffer(response));
+    ast_verb(3, "[%s] Manufacturer: %s\n", PVT_ID(pvt), pvt->manufacturer);
+    return at_enqueue_initialization_vendor(pvt);
+}
+
 /*!
  * \brief Handle AT+CGMM response
  * \param pvt -- pvt structure
@@ -2251,8 +2320,18 @@ static int at_response_cgmr(struct pvt* const pvt, const struct ast_str* const r
 static int at_response_cgsn(struct pvt* const pvt, const struct ast_str* const response)
 {
     ast_string_field_set(pvt, imei, ast_str_buffer(response));
+    pvt_update_index(pvt);
     ast_verb(2, "[%s] IMEI: %s\n", PVT_ID(pvt), pvt->imei);
-    return 0;
+
+    if (!pvt->identity_cached) {
+        return 0;
+    }
+
+    /* same module after reset, identity queries are skipped */
+    if (!pvt_identity_restore(pvt)) {
+        return at_enqueue_initialization_vendor(pvt);
+    }
+    return at_enqueue_identity(&pvt->sys_chan);
 }
 
 /*!
@@ -2266,6 +2345,7 @@ static int at_response_cgsn(struct pvt* const pvt, const struct ast_str* const r
 static int at_response_cimi(struct pvt* const pvt, const struct ast_str* const response)
 {
     ast_string_field_set(pvt, imsi, ast_str_buffer(response));
+    pvt_update_index(pvt);
     ast_verb(2, "[%s] IMSI: %s\n", PVT_ID(pvt), pvt->imsi);
     return 0;
 }
@@ -2273,6 +2353,7 @@ static int at_response_cimi(struct pvt* const pvt, const struct ast_str* const r
 static int at_response_ccid(struct pvt* const pvt, const struct ast_str* const response)
 {
     ast_string_field_set(pvt, iccid, ast_str_buffer(response));
+    pvt_update_index(pvt);
     ast_verb(2, "[%s] ICCID: %s\n", PVT_ID(pvt), pvt->iccid);
     return 0;
 }
@@ -2287,15 +2368,16 @@ static int at_response_xccid(struct pvt* const pvt, const struct ast_str* const
     }
 
     ast_string_field_set(pvt, iccid, ccid);
+    pvt_update_index(pvt);
     ast_verb(2, "[%s] ICCID: %s\n", PVT_ID(pvt), pvt->iccid);
     return 0;
 }
 
-static void send_dtmf_frame(struct pvt* const pvt, char c)
+static int send_dtmf_frame(struct pvt* const pvt, char c)
 {
     if (!CONF_SHARED(pvt, dtmf)) {
         ast_debug(1, "[%s] Detected DTMF: %c", PVT_ID(pvt), c);
-        return;
+        return -1;
     }
 
     struct cpvt* const cpvt = pvt_channel_find_active(pvt);
@@ -2309,105 +2391,53 @@ static void send_dtmf_frame(struct pvt* const pvt, char c)
             ast_log(LOG_ERROR, "[%s] Fail to send detected DTMF: %c", PVT_ID(pvt), c);
         } else {
             ast_verb(1, "[%s] Detected DTMF: %c", PVT_ID(pvt), c);
+            return 0;
         }
     } else {
         ast_log(LOG_WARNING, "[%s] Detected DTMF: %c", PVT_ID(pvt), c);
     }
+    return -1;
 }
 
-static void at_response_qtonedet(struct pvt* const pvt, const struct ast_str* const response)
+/* +QTONEDET reports ASCII code of detected tone */
+static char qtonedet2dtmf(int code)
 {
-    int dtmf;
-    char c = '\000';
+    static const char dtmf_map[128] = {
+        ['0'] = '0', ['1'] = '1', ['2'] = '2', ['3'] = '3', ['4'] = '4', ['5'] = '5', ['6'] = '6', ['7'] = '7',
+        ['8'] = '8', ['9'] = '9', ['A'] = 'A', ['B'] = 'B', ['C'] = 'C', ['D'] = 'D', ['*'] = '*', ['#'] = '#',
+    };
 
-    if (at_parse_qtonedet(ast_str_buffer(response), &dtmf)) {
-        ast_log(LOG_ERROR, "[%s] Error parsing QTONEDET: '%s'\n", PVT_ID(pvt), ast_str_buffer(response));
-        return;
+    if (code < 0 || code >= (int)ARRAY_LEN(dtmf_map)) {
+        return '\000';
     }
+    return dtmf_map[code];
+}
 
-    switch (dtmf) {
-        case 48:
-            c = '0';
-            break;
-
-        case 49:
-            c = '1';
-            break;
-
-        case 50:
-            c = '2';
-            break;
-
-        case 51:
-            c = '3';
-            break;
-
-        case 52:
-            c = '4';
-            break;
-
-        case 53:
-            c = '5';
-            break;
-
-        case 54:
-            c = '6';
-            break;
-
-        case 55:
-            c = '7';
-            break;
-
-        case 56:
-            c = '8';
-            break;
-
-        case 57:
-            c = '9';
-            break;
-
-        case 65:
-            c = 'A';
-            break;
-
-        case 66:
-            c = 'B';
-            break;
-
-        case 67:
-            c = 'C';
-            break;
-
-        case 68:
-            c = 'D';
-            break;
-
-        case 42:
-            c = '*';
-            break;
+static char at_response_qtonedet(struct pvt* const pvt, const struct ast_str* const response)
+{
+    int dtmf;
 
-        case 35:
-            c = '#';
-            break;
+    if (at_parse_qtonedet(ast_str_buffer(response), &dtmf)) {
+        ast_log(LOG_ERROR, "[%s] Error parsing QTONEDET: '%s'\n", PVT_ID(pvt), ast_str_buffer(response));
+        return '\000';
     }
 
+    const char c = qtonedet2dtmf(dtmf);
     if (!c) {
         ast_log(LOG_WARNING, "[%s] Detected unknown DTMF code: %d", PVT_ID(pvt), dtmf);
-        return;
     }
-
-    send_dtmf_frame(pvt, c);
+    return c;
 }
 
-static void at_response_dtmf(struct pvt* const pvt, const struct ast_str* const response)
+static char at_response_dtmf(struct pvt* const pvt, const struct ast_str* const response)
 {
     char c = '\000';
 
     if (at_parse_dtmf(ast_str_buffer(response), &c)) {
         ast_log(LOG_ERROR, "[%s] Error parsing RXDTMF: '%s'\n", PVT_ID(pvt), ast_str_buffer(response));
-        return;
+        return '\000';
     }
-    send_dtmf_frame(pvt, c);
+    return c;
 }
 
 static const char* qpcmv2str(int qpcmv)
@@ -2754,10 +2784,22 @@ int at_response(struct pvt* const pvt, const struct ast_str* const response, con
         return 0;
     }
 
+    /* modem went past commands of pipelined command line answered with single final result */
+    for (unsigned n = at_queue_pipeline_match(pvt, at_res); n; n = at_queue_pipeline_match(pvt, at_res)) {
+        while (n--) {
+            const at_queue_task_t* const t = at_queue_head_task(pvt);
+            at_response_ok(pvt, RES_OK, t, at_queue_task_cmd(t));
+        }
+    }
+
     const at_queue_task_t* const task = at_queue_head_task(pvt);
     const at_queue_cmd_t* const ecmd  = at_queue_task_cmd(task);
     show_response(pvt, ecmd, response, at_res);
 
+    if (ecmd && ecmd->cmd == CMD_USER) {
+        at_batch_response(pvt, task, at_res, response);
+    }
+
     switch (at_res) {
         case RES_BOOT:
         case RES_CSSI:
@@ -2771,11 +2813,24 @@ int at_response(struct pvt* const pvt, const struct ast_str* const response, con
         case RES_RCEND:
             return 0;
 
-        case RES_OK:
+        case RES_OK: {
+            /* final result of pipelined command line completes all its commands */
+            unsigned n = (task && task->pipelined > 1u) ? task->pipelined : 1u;
+
             at_response_ok(pvt, at_res, task, ecmd);
+            while (--n) {
+                if (at_queue_head_task(pvt) != task) {
+                    break;
+                }
+                at_response_ok(pvt, at_res, task, at_queue_task_cmd(task));
+            }
             return 0;
+        }
 
         case RES_CMS_ERROR:
+            pvt->cms_error = at_parse_cms_error(ast_str_buffer(response));
+            return at_response_error(pvt, at_res, task, ecmd);
+
         case RES_ERROR:
         case RES_TIMEOUT:
             return at_response_error(pvt, at_res, task, ecmd);
@@ -2897,15 +2952,6 @@ int at_response(struct pvt* const pvt, const struct ast_str* const response, con
             at_response_csca(pvt, response);
             return 0;
 
-        case RES_QTONEDET:
-            at_response_qtonedet(pvt, response);
-            return 0;
-
-        case RES_DTMF:
-        case RES_RXDTMF:
-            at_response_dtmf(pvt, response);
-            return 0;
-
         case RES_QPCMV:
             at_response_qpcmv(pvt, response);
             return 0;
@@ -3024,12 +3070,16 @@ int at_response(struct pvt* const pvt, const struct ast_str* const response, con
     return 0;
 }
 
-struct at_response_taskproc_data* at_response_taskproc_data_alloc(struct pvt* const pvt, const struct ast_str* const response)
+struct at_response_taskproc_data* at_response_taskproc_data_alloc(struct pvt* const pvt, const struct ast_str* const response, const struct timeval* received)
 {
     const size_t response_len = ast_str_strlen(response);
 
     struct at_response_taskproc_data* const res = ast_calloc(1, sizeof(struct at_response_taskproc_data) + response_len + 1u);
+    if (!res) {
+        return NULL;
+    }
     res->ptd.pvt                                = pvt;
+    res->received                               = *received;
     res->response.__AST_STR_LEN                 = response_len + 1u;
     res->response.__AST_STR_USED                = response_len;
     res->response.__AST_STR_TS                  = DS_STATIC;
@@ -3037,10 +3087,62 @@ struct at_response_taskproc_data* at_response_taskproc_data_alloc(struct pvt* co
     return res;
 }
 
+/* type of DTMF URC, RES_UNKNOWN if response is not DTMF URC */
+static at_res_t at_dtmf_urc_res(const struct ast_str* const response)
+{
+    static const char M_QTONEDET[] = "+QTONEDET:";
+    static const char M_DTMF[]     = "+DTMF:";
+    static const char M_RXDTMF[]   = "+RXDTMF:";
+
+    const char* const str = ast_str_buffer(response);
+    const size_t len      = ast_str_strlen(response);
+
+    if (len < STRLEN(M_DTMF) || str[0] != '+') {
+        return RES_UNKNOWN;
+    }
+
+    if (len > STRLEN(M_QTONEDET) && !memcmp(str, M_QTONEDET, STRLEN(M_QTONEDET))) {
+        return RES_QTONEDET;
+    } else if (!memcmp(str, M_DTMF, STRLEN(M_DTMF))) {
+        return RES_DTMF;
+    } else if (len > STRLEN(M_RXDTMF) && !memcmp(str, M_RXDTMF, STRLEN(M_RXDTMF))) {
+        return RES_RXDTMF;
+    }
+    return RES_UNKNOWN;
+}
+
+/* pvt locked */
+static void at_response_dtmf_urc_locked(struct pvt* const pvt, const struct ast_str* const response, at_res_t at_res, const struct timeval* const received)
+{
+    PVT_STAT(pvt, at_responses)++;
+    show_response(pvt, NULL, response, at_res);
+
+    const char c = (at_res == RES_QTONEDET) ? at_response_qtonedet(pvt, response) : at_response_dtmf(pvt, response);
+    if (!c || send_dtmf_frame(pvt, c)) {
+        return;
+    }
+
+    const int64_t latency = ast_tvdiff_us(ast_tvnow(), *received);
+
+    PVT_STAT(pvt, dtmf_digits)++;
+    PVT_STAT(pvt, dtmf_latency_sum) += (uint64_t)latency;
+    if (latency > PVT_STAT(pvt, dtmf_latency_max)) {
+        PVT_STAT(pvt, dtmf_latency_max) = (uint32_t)latency;
+    }
+    ast_debug(3, "[%s] DTMF %c queued in %ld usec\n", PVT_ID(pvt), c, (long)latency);
+}
+
 static void response_taskproc(struct pvt_taskproc_data* ptd)
 {
     RAII_VAR(struct at_response_taskproc_data* const, rtd, (struct at_response_taskproc_data*)ptd, ast_free);
 
+    const at_res_t dtmf_res = at_dtmf_urc_res(&rtd->response);
+    if (dtmf_res != RES_UNKNOWN) {
+        /* queued behind earlier responses, see at_response_dtmf_urc() */
+        at_response_dtmf_urc_locked(rtd->ptd.pvt, &rtd->response, dtmf_res, &rtd->received);
+        return;
+    }
+
     const at_res_t at_res = at_str2res(&rtd->response);
     if (at_res != RES_UNKNOWN) {
         ast_str_trim_blanks(&rtd->response);
@@ -3055,6 +3157,32 @@ static void response_taskproc(struct pvt_taskproc_data* ptd)
         ast_log(LOG_ERROR, "[%s] Fail to run command from queue\n", PVT_ID(rtd->ptd.pvt));
         rtd->ptd.pvt->terminate_monitor = 1;
     }
+
+    pvt_publish_ready(rtd->ptd.pvt);
 }
 
-int at_response_taskproc(void* tpdata) { return PVT_TASKPROC_LOCK_AND_EXECUTE(tpdata, response_taskproc); }
+int at_response_taskproc(void* tpdata)
+{
+    struct pvt* const pvt = ((struct pvt_taskproc_data*)tpdata)->pvt;
+
+    const int res = PVT_TASKPROC_LOCK_AND_EXECUTE(tpdata, response_taskproc);
+    __atomic_fetch_sub(&pvt->d_read_pending, 1, __ATOMIC_RELEASE);
+    return res;
+}
+
+int at_response_dtmf_urc(struct pvt* const pvt, const struct ast_str* const response, const struct timeval* const received)
+{
+    const at_res_t at_res = at_dtmf_urc_res(response);
+    if (at_res == RES_UNKNOWN) {
+        return 0;
+    }
+
+    /* earlier responses may change call state, digit is queued behind them */
+    if (__atomic_load_n(&pvt->d_read_pending, __ATOMIC_ACQUIRE) > 0) {
+        return 0;
+    }
+
+    SCOPED_MUTEX(pvt_lock, &pvt->lock);
+    at_response_dtmf_urc_locked(pvt, response, at_res, received);
+    return 1;
+}
@@ -139,12 +139,20 @@ at_res_t at_str2res(const struct ast_str* const);
 
 int at_response(struct pvt* const pvt, const struct ast_str* const response, const at_res_t at_res);
 
+/*!
+ * \brief Handle DTMF URC directly in monitor thread, bypassing response task processor
+ * \param received -- time when response was read from device, used for latency statistics
+ * \return 1 if response was DTMF URC and was handled, 0 if it is not DTMF URC or earlier responses are still queued
+ */
+int at_response_dtmf_urc(struct pvt* const pvt, const struct ast_str* const response, const struct timeval* const received);
+
 typedef struct at_response_taskproc_data {
     struct pvt_taskproc_data ptd;
+    struct timeval received; /*!< time when response was read */
     struct ast_str response;
 } at_response_taskproc_data_t;
 
-struct at_response_taskproc_data* at_response_taskproc_data_alloc(struct pvt* const pvt, const struct ast_str* const response);
+struct at_response_taskproc_data* at_response_taskproc_data_alloc(struct pvt* const pvt, const struct ast_str* const response, const struct timeval* received);
 int at_response_taskproc(void* tpdata);
 
 #endif /* CHAN_QUECTEL_AT_RESPONSE_H_INCLUDED */
@@ -0,0 +1,185 @@
+/*
+    at_trace.c
+*/
+
+#include <endian.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/time.h>
+
+#include "ast_config.h"
+
+#include <asterisk/logger.h>
+#include <asterisk/utils.h>
+
+#include "at_trace.h"
+
+#include "at_read.h" /* at_get_iov_size_n() */
+#include "mutils.h"
+
+#define AT_TRACE_RECORD_MAX_LEN UINT16_MAX
+
+static void rb_copy_out(const struct ringbuffer* rb, void* dst, size_t len)
+{
+    struct iovec iov[2];
+    const int iovcnt = rb_read_n_iov(rb, iov, len);
+
+    if (iovcnt <= 0) {
+        return;
+    }
+
+    memcpy(dst, iov[0].iov_base, iov[0].iov_len);
+    if (iovcnt > 1) {
+        memcpy((char*)dst + iov[0].iov_len, iov[1].iov_base, iov[1].iov_len);
+    }
+}
+
+#/* drop oldest records until required space is available */
+
+static void at_trace_reclaim(struct at_trace* trace, size_t required)
+{
+    struct at_trace_record rec;
+
+    while (rb_free(&trace->rb) < required && rb_used(&trace->rb) >= sizeof(rec)) {
+        rb_copy_out(&trace->rb, &rec, sizeof(rec));
+        rb_read_upd(&trace->rb, sizeof(rec) + le16toh(rec.length));
+        trace->records--;
+        trace->dropped++;
+    }
+}
+
+static void at_trace_append(struct at_trace* trace, const struct timeval* tv, at_trace_dir_t dir, const struct iovec* iov, int iovcnt, size_t len)
+{
+    const size_t max_len = trace->rb.size - sizeof(struct at_trace_record);
+    const struct at_trace_record rec = {
+        .sec    = htole32((uint32_t)tv->tv_sec),
+        .usec   = htole32((uint32_t)tv->tv_usec),
+        .length = htole16((uint16_t)MIN(len, max_len)),
+        .dir    = (uint8_t)dir,
+    };
+
+    len = le16toh(rec.length);
+    at_trace_reclaim(trace, sizeof(rec) + len);
+
+    rb_write(&trace->rb, (const char*)&rec, sizeof(rec));
+    for (int i = 0; i < iovcnt && len; ++i) {
+        const size_t n = MIN(iov[i].iov_len, len);
+        rb_write(&trace->rb, iov[i].iov_base, n);
+        len -= n;
+    }
+    trace->records++;
+}
+
+#/* */
+
+struct at_trace* at_trace_alloc(size_t size)
+{
+    if (size < sizeof(struct at_trace_record) * 16) {
+        size = AT_TRACE_DEF_SIZE;
+    } else if (size > AT_TRACE_MAX_SIZE) {
+        size = AT_TRACE_MAX_SIZE;
+    }
+
+    struct at_trace* const trace = ast_calloc(1, sizeof(struct at_trace) + size);
+    if (!trace) {
+        return NULL;
+    }
+
+    ast_mutex_init(&trace->lock);
+    rb_init(&trace->rb, trace->data, size);
+    return trace;
+}
+
+void at_trace_free(struct at_trace* trace)
+{
+    if (!trace) {
+        return;
+    }
+
+    ast_mutex_destroy(&trace->lock);
+    ast_free(trace);
+}
+
+void at_trace_clear(struct at_trace* trace)
+{
+    SCOPED_MUTEX(trace_lock, &trace->lock);
+    rb_reset(&trace->rb);
+    trace->records = 0;
+    trace->dropped = 0;
+}
+
+void at_trace_write(struct at_trace* trace, at_trace_dir_t dir, const void* buf, size_t len)
+{
+    const struct iovec iov = {.iov_base = (void*)buf, .iov_len = len};
+    at_trace_write_iov(trace, dir, &iov, 1);
+}
+
+void at_trace_write_iov(struct at_trace* trace, at_trace_dir_t dir, const struct iovec* iov, int iovcnt)
+{
+    const size_t total = at_get_iov_size_n(iov, iovcnt);
+    if (!total) {
+        return;
+    }
+
+    const struct timeval tv = ast_tvnow();
+    SCOPED_MUTEX(trace_lock, &trace->lock);
+
+    if (total <= AT_TRACE_RECORD_MAX_LEN) {
+        at_trace_append(trace, &tv, dir, iov, iovcnt, total);
+        return;
+    }
+
+    /* split into records of maximal length */
+    for (int i = 0; i < iovcnt; ++i) {
+        const char* base = iov[i].iov_base;
+        size_t left      = iov[i].iov_len;
+
+        while (left) {
+            const struct iovec part = {.iov_base = (void*)base, .iov_len = MIN(left, AT_TRACE_RECORD_MAX_LEN)};
+            at_trace_append(trace, &tv, dir, &part, 1, part.iov_len);
+            base += part.iov_len;
+            left -= part.iov_len;
+        }
+    }
+}
+
+#/* */
+
+int at_trace_dump(struct at_trace* trace, const char* fname)
+{
+    const struct at_trace_file_header hdr = {
+        .magic   = AT_TRACE_MAGIC,
+        .version = htole32(AT_TRACE_VERSION),
+    };
+    struct iovec iov[2];
+
+    FILE* const f = fopen(fname, "wb");
+    if (!f) {
+        ast_log(LOG_ERROR, "Unable to open trace file %s: %s\n", fname, strerror(errno));
+        return -1;
+    }
+
+    int res = -1;
+    {
+        SCOPED_MUTEX(trace_lock, &trace->lock);
+
+        if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+            goto e_write;
+        }
+
+        const int iovcnt = rb_read_all_iov(&trace->rb, iov);
+        for (int i = 0; i < iovcnt; ++i) {
+            if (fwrite(iov[i].iov_base, 1, iov[i].iov_len, f) != iov[i].iov_len) {
+                goto e_write;
+            }
+        }
+        res = (int)trace->records;
+    }
+
+e_write:
+    if (fclose(f) || res < 0) {
+        ast_log(LOG_ERROR, "Unable to write trace file %s: %s\n", fname, strerror(errno));
+        return -1;
+    }
+    return res;
+}
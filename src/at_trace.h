@@ -0,0 +1,82 @@
+/*
+    at_trace.h
+*/
+
+#ifndef CHAN_QUECTEL_AT_TRACE_H_INCLUDED
+#define CHAN_QUECTEL_AT_TRACE_H_INCLUDED
+
+#include <stdint.h>
+#include <sys/uio.h> /* struct iovec */
+
+#include "ast_config.h"
+
+#include <asterisk/lock.h>
+
+#include "ringbuffer.h"
+
+/*
+    Binary trace file layout:
+
+        struct at_trace_file_header
+        struct at_trace_record + data
+        struct at_trace_record + data
+        ...
+
+    All integers are little-endian.
+*/
+
+#define AT_TRACE_MAGIC "QATR"
+#define AT_TRACE_VERSION 1
+#define AT_TRACE_DEF_SIZE (64 * 1024)
+#define AT_TRACE_MAX_SIZE (16 * 1024 * 1024)
+
+typedef enum {
+    AT_TRACE_RX = 0, /*!< data received from modem */
+    AT_TRACE_TX,     /*!< data written to modem */
+} at_trace_dir_t;
+
+struct at_trace_file_header {
+    char magic[4];    /*!< AT_TRACE_MAGIC */
+    uint32_t version; /*!< AT_TRACE_VERSION */
+} __attribute__((packed));
+
+struct at_trace_record {
+    uint32_t sec;    /*!< timestamp, seconds */
+    uint32_t usec;   /*!< timestamp, microseconds */
+    uint16_t length; /*!< number of data bytes following the record header */
+    uint8_t dir;     /*!< at_trace_dir_t */
+    uint8_t reserved;
+} __attribute__((packed));
+
+struct at_trace {
+    ast_mutex_t lock;
+    int enabled;           /*!< checked without lock on hot path, atomic */
+    struct ringbuffer rb;  /*!< records, oldest are dropped on overflow */
+    uint32_t records;      /*!< number of records in buffer */
+    uint32_t dropped;      /*!< number of records dropped on overflow */
+    unsigned char data[0]; /*!< ring buffer storage */
+};
+
+struct at_trace* at_trace_alloc(size_t size);
+void at_trace_free(struct at_trace* trace);
+void at_trace_clear(struct at_trace* trace);
+
+void at_trace_write(struct at_trace* trace, at_trace_dir_t dir, const void* buf, size_t len);
+void at_trace_write_iov(struct at_trace* trace, at_trace_dir_t dir, const struct iovec* iov, int iovcnt);
+
+/*!
+ * \brief Write content of trace buffer to file
+ * \return number of records written, -1 on error
+ */
+int at_trace_dump(struct at_trace* trace, const char* fname);
+
+static inline int at_trace_enabled(const struct at_trace* trace) { return trace && __atomic_load_n(&trace->enabled, __ATOMIC_RELAXED); }
+
+#define AT_TRACE(trace, dir, buf, len)                \
+    do {                                              \
+        if (at_trace_enabled(trace)) {                \
+            at_trace_write((trace), (dir), buf, len); \
+        }                                             \
+    } while (0)
+
+#endif /* CHAN_QUECTEL_AT_TRACE_H_INCLUDED */
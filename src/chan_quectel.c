@@ -34,6 +34,7 @@
  */
 
 #include <signal.h>
+#include <unistd.h> /* access() */
 
 #include "ast_config.h"
 
@@ -49,6 +50,7 @@
 #include "chan_quectel.h"
 
 #include "app.h"
+#include "at_batch.h"   /* at_batch_abort() */
 #include "at_command.h" /* at_cmd2str() */
 #include "at_queue.h"   /* struct at_queue_task_cmd at_queue_head_cmd() */
 #include "at_read.h"
@@ -60,6 +62,7 @@
 #include "error.h"
 #include "eventfd.h"
 #include "helpers.h"
+#include "hotplug.h"
 #include "monitor_thread.h"
 #include "msg_tech.h"
 #include "mutils.h" /* ARRAY_LEN() */
@@ -99,6 +102,38 @@ static int soundcard_init(struct pvt* pvt)
 
 static int public_state_init(struct public_state* state);
 
+#/* */
+
+/* identity of initialized module, used on reconnect instead of AT+CGMI, AT+CGMM and AT+CGMR */
+static void pvt_identity_save(struct pvt* const pvt)
+{
+    struct pvt_identity* const id = &pvt->identity;
+
+    ast_copy_string(id->imei, pvt->imei, sizeof(id->imei));
+    ast_copy_string(id->manufacturer, pvt->manufacturer, sizeof(id->manufacturer));
+    ast_copy_string(id->model, pvt->model, sizeof(id->model));
+    ast_copy_string(id->firmware, pvt->firmware, sizeof(id->firmware));
+}
+
+int pvt_identity_restore(struct pvt* const pvt)
+{
+    struct pvt_identity* const id = &pvt->identity;
+
+    if (ast_strlen_zero(pvt->imei) || strcmp(pvt->imei, id->imei)) {
+        ast_log(LOG_NOTICE, "[%s] Module changed, IMEI %s instead of %s\n", PVT_ID(pvt), S_OR(pvt->imei, "unknown"), id->imei);
+        ast_atomic_fetchadd_int(&gpublic->dev_manager_stat.identity_misses, 1);
+        memset(id, 0, sizeof(*id));
+        pvt->identity_cached = 0;
+        return -1;
+    }
+
+    ast_string_field_set(pvt, manufacturer, id->manufacturer);
+    ast_string_field_set(pvt, model, id->model);
+    ast_string_field_set(pvt, firmware, id->firmware);
+    ast_verb(3, "[%s] Cached identity confirmed: %s %s %s\n", PVT_ID(pvt), pvt->manufacturer, pvt->model, pvt->firmware);
+    return 0;
+}
+
 #/* phone monitor thread pvt cleanup */
 
 void pvt_disconnect(struct pvt* pvt)
@@ -125,6 +160,7 @@ void pvt_disconnect(struct pvt* pvt)
     }
 
     at_queue_flush(pvt);
+    at_batch_abort(pvt);
 
     if (CONF_UNIQ(pvt, uac) > TRIBOOL_FALSE) {
         if (pvt->icard) {
@@ -143,6 +179,11 @@ void pvt_disconnect(struct pvt* pvt)
     }
 
     tty_close(CONF_UNIQ(pvt, data_tty), pvt->data_fd);
+    eventfd_close(&pvt->d_write_event);
+    if (rb_used(&pvt->d_write_rb)) {
+        ast_debug(1, "[%s][DATA] Drop %zu bytes of buffered commands\n", PVT_ID(pvt), rb_used(&pvt->d_write_rb));
+        rb_reset(&pvt->d_write_rb);
+    }
 
     pvt->data_fd  = -1;
     pvt->audio_fd = -1;
@@ -159,6 +200,13 @@ void pvt_disconnect(struct pvt* pvt)
 
     memset(&pvt->module_time, 0, sizeof(pvt->module_time));
 
+    /* module may be reset, not replaced, identity is confirmed by IMEI on reconnect */
+    if (pvt->initialized && !ast_strlen_zero(pvt->imei)) {
+        pvt_identity_save(pvt);
+    }
+    pvt->identity_cached = 0;
+    pvt->connect_time    = ast_tv(0, 0);
+
     ast_string_field_set(pvt, manufacturer, NULL);
     ast_string_field_set(pvt, model, NULL);
     ast_string_field_set(pvt, firmware, NULL);
@@ -173,6 +221,7 @@ void pvt_disconnect(struct pvt* pvt)
     ast_string_field_set(pvt, cell_id, NULL);
     ast_string_field_set(pvt, sms_scenter, NULL);
     ast_string_field_set(pvt, subscriber_number, NULL);
+    pvt_update_index(pvt);
 
     pvt->has_subscriber_number = 0;
 
@@ -191,10 +240,14 @@ void pvt_disconnect(struct pvt* pvt)
     pvt->cwaiting           = 0;
     pvt->outgoing_sms       = 0;
     pvt->incoming_sms_index = -1;
+    pvt->cms_error          = -1;
     pvt->incoming_sms_type  = RES_UNKNOWN;
     pvt->volume_sync_step   = VOLUME_SYNC_BEGIN;
+    AST_VECTOR_RESET(&pvt->sms_delete_pending, AST_VECTOR_ELEM_CLEANUP_NOOP);
+    sms_submit_reset(pvt); /* submitted again when initialized */
 
     pvt->current_state = DEV_STATE_STOPPED;
+    pvt_publish_ready(pvt);
 
     /* clear statictics */
     memset(&pvt->stat, 0, sizeof(pvt->stat));
@@ -230,6 +283,18 @@ static void pvt_start(struct pvt* const pvt)
         return;
     }
 
+    /* ports may be symlinks, removal of their nodes is matched by cached node names */
+    hotplug_resolve(CONF_UNIQ(pvt, data_tty), pvt->data_node, sizeof(pvt->data_node));
+    hotplug_resolve(CONF_UNIQ(pvt, audio_tty), pvt->audio_node, sizeof(pvt->audio_node));
+
+    pvt->connect_time    = ast_tvnow();
+    pvt->identity_cached = ast_strlen_zero(pvt->identity.imei) ? 0 : 1;
+
+    pvt->d_write_event = eventfd_create();
+    if (pvt->d_write_event < 0) {
+        ast_log(LOG_WARNING, "[%s] Unable to create write event, buffered commands are written on next device event\n", PVT_ID(pvt));
+    }
+
     if (CONF_UNIQ(pvt, uac) > TRIBOOL_FALSE) {
         if (soundcard_init(pvt) < 0) {
             pvt_disconnect(pvt);
@@ -272,7 +337,11 @@ static void pvt_start(struct pvt* const pvt)
 
     pvt->connected     = 1;
     pvt->current_state = DEV_STATE_STARTED;
-    ast_verb(3, "[%s] Connected, initializing...\n", PVT_ID(pvt));
+    if (pvt->identity_cached) {
+        ast_verb(3, "[%s] Connected, initializing with cached identity of IMEI %s...\n", PVT_ID(pvt), pvt->identity.imei);
+    } else {
+        ast_verb(3, "[%s] Connected, initializing...\n", PVT_ID(pvt));
+    }
     return;
 
 cleanup_audiofd:
@@ -282,6 +351,7 @@ cleanup_audiofd:
 
 cleanup_datafd:
     tty_close(CONF_UNIQ(pvt, data_tty), pvt->data_fd);
+    eventfd_close(&pvt->d_write_event);
 }
 
 #/* */
@@ -289,6 +359,10 @@ cleanup_datafd:
 static void pvt_free(struct pvt* const pvt)
 {
     at_queue_flush(pvt);
+    at_queue_pool_free(pvt);
+    sms_submit_flush(pvt);
+    at_trace_free(pvt->trace);
+    AST_VECTOR_FREE(&pvt->sms_delete_pending);
     ast_string_field_free_memory(pvt);
     ast_mutex_unlock(&pvt->lock);
     ast_mutex_destroy(&pvt->lock);
@@ -304,22 +378,301 @@ static void pvt_destroy(struct pvt* const pvt)
     pvt_free(pvt);
 }
 
+// device list
+
+/* device list must be write locked, device is visible to readers when linked */
+static void devices_link(struct public_state* const state, struct pvt* const pvt)
+{
+    pvt->entry.next = NULL;
+    if (state->devices.last) {
+        __atomic_store_n(&state->devices.last->entry.next, pvt, __ATOMIC_RELEASE);
+    } else {
+        __atomic_store_n(&state->devices.first, pvt, __ATOMIC_RELEASE);
+    }
+    state->devices.last = pvt;
+}
+
+/* device list must be write locked, unlinked device keeps its link for readers until grace period */
+static void devices_unlink(struct public_state* const state, struct pvt* const prev, struct pvt* const pvt)
+{
+    struct pvt* const next = pvt->entry.next;
+
+    if (prev) {
+        __atomic_store_n(&prev->entry.next, next, __ATOMIC_RELEASE);
+    } else {
+        __atomic_store_n(&state->devices.first, next, __ATOMIC_RELEASE);
+    }
+    if (state->devices.last == pvt) {
+        state->devices.last = prev;
+    }
+}
+
 // device manager
 
 static const eventfd_t DEV_MANAGER_CMD_SCAN = 1;
-static const eventfd_t DEV_MANAGER_CMD_STOP = 2;
+
+static void stat_max(uint64_t* max, uint64_t val)
+{
+    uint64_t cur = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (val > cur && !__atomic_compare_exchange_n(max, &cur, val, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void stat_add(uint64_t* sum, uint64_t* max, uint64_t val)
+{
+    __atomic_fetch_add(sum, val, __ATOMIC_RELAXED);
+    stat_max(max, val);
+}
+
+/* device locked, time from device event to device being initialized */
+static void ready_stat(struct dev_manager_stat* const stat, struct pvt* const pvt)
+{
+    if (ast_tvzero(pvt->ready_requested)) {
+        return;
+    }
+
+    ast_atomic_fetchadd_int(&stat->ready, 1);
+    stat_add(&stat->ready_ms, &stat->ready_ms_max, (uint64_t)ast_tvdiff_ms(ast_tvnow(), pvt->ready_requested));
+    pvt->ready_requested = ast_tv(0, 0);
+}
+
+/* device locked, returns non-zero if device must be removed */
+static int dev_manager_handle(struct public_state* const state, struct pvt* const pvt)
+{
+    struct dev_manager_stat* const stat = &state->dev_manager_stat;
+
+    if (pvt->must_remove) {
+        return 1;
+    }
+
+    if (pvt->restart_time != RESTATE_TIME_NOW) {
+        return 0;
+    }
+    if (pvt->desired_state == pvt->current_state) {
+        return 0;
+    }
+
+    const struct timeval begin = ast_tvnow();
+
+    switch (pvt->desired_state) {
+        case DEV_STATE_RESTARTED:
+            ast_debug(4, "[dev-manager][%s] Restarting device\n", PVT_ID(pvt));
+            pvt_monitor_stop(pvt);
+            pvt->desired_state = DEV_STATE_STARTED;
+            /* fall through */
+
+        case DEV_STATE_STARTED:
+            ast_debug(4, "[dev-manager][%s] Starting device\n", PVT_ID(pvt));
+            pvt->start_time = begin;
+            pvt_start(pvt);
+            break;
+
+        case DEV_STATE_REMOVED:
+            ast_debug(4, "[dev-manager][%s] Removing device\n", PVT_ID(pvt));
+            pvt_monitor_stop(pvt);
+            pvt->must_remove = 1;
+            break;
+
+        case DEV_STATE_STOPPED:
+            ast_debug(4, "[dev-manager][%s] Stopping device\n", PVT_ID(pvt));
+            pvt_monitor_stop(pvt);
+            break;
+    }
+
+    const struct timeval now = ast_tvnow();
+    pvt->restate_ms          = ast_tvdiff_ms(now, begin);
+    stat_max(&stat->device_ms_max, (uint64_t)pvt->restate_ms);
+    ast_debug(3, "[dev-manager][%s] Device %s in %lld ms\n", PVT_ID(pvt), pvt->current_state == DEV_STATE_STARTED ? "started" : "stopped",
+              (long long int)pvt->restate_ms);
+
+    if (!ast_tvzero(pvt->restate_requested)) {
+        ast_atomic_fetchadd_int(&stat->restates, 1);
+        stat_add(&stat->restate_ms, &stat->restate_ms_max, (uint64_t)ast_tvdiff_ms(now, pvt->restate_requested));
+        pvt->restate_requested = ast_tv(0, 0);
+    }
+
+    if (pvt->desired_state != DEV_STATE_STARTED) {
+        /* device will not be initialized */
+        pvt->ready_requested = ast_tv(0, 0);
+    } else if (pvt->initialized) {
+        /* device was not restarted */
+        ready_stat(stat, pvt);
+    }
+
+    return pvt->must_remove;
+}
+
+/* devices started or stopped concurrently */
+struct dev_manager_batch {
+    struct public_state* state;
+    struct pvt* const* pvts;
+    unsigned count;
+    unsigned next; /*!< next device to handle, atomic */
+    int removals;  /*!< some device must be removed, atomic */
+};
+
+static void dev_manager_batch_run(struct dev_manager_batch* const batch)
+{
+    unsigned i;
+
+    while ((i = __atomic_fetch_add(&batch->next, 1u, __ATOMIC_RELAXED)) < batch->count) {
+        struct pvt* const pvt = batch->pvts[i];
+        SCOPED_MUTEX(pvt_lock, &pvt->lock);
+        if (dev_manager_handle(batch->state, pvt)) {
+            __atomic_store_n(&batch->removals, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void* dev_manager_workerproc(void* arg)
+{
+    dev_manager_batch_run(arg);
+    return NULL;
+}
+
+/*
+    Start or stop devices on bounded number of worker threads,
+    device manager thread is one of workers, device list must be locked.
+    Returns non-zero if some device must be removed.
+*/
+static int dev_manager_batch(struct public_state* const state, struct pvt* const* pvts, unsigned count)
+{
+    struct dev_manager_stat* const stat = &state->dev_manager_stat;
+    struct dev_manager_batch batch      = {.state = state, .pvts = pvts, .count = count};
+    pthread_t workers[MANAGER_WORKERS_MAX];
+    unsigned started = 0;
+
+    const struct timeval begin = ast_tvnow();
+    const unsigned limit       = MIN((unsigned)SCONF_GLOBAL(state, manager_workers), count);
+
+    for (; started + 1u < limit; ++started) {
+        if (ast_pthread_create(&workers[started], NULL, dev_manager_workerproc, &batch)) {
+            ast_log(LOG_WARNING, "[dev-manager] Unable to create worker thread, continue with %u workers\n", started + 1u);
+            break;
+        }
+    }
+
+    dev_manager_batch_run(&batch);
+    for (unsigned i = 0; i < started; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+
+    const int64_t ms = ast_tvdiff_ms(ast_tvnow(), begin);
+    ast_atomic_fetchadd_int(&stat->batches, 1);
+    __atomic_store_n(&stat->batch_devices, (int)count, __ATOMIC_RELAXED);
+    __atomic_store_n(&stat->batch_workers, (int)started + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&stat->batch_ms, ms, __ATOMIC_RELAXED);
+    stat_max(&stat->batch_ms_max, (uint64_t)ms);
+
+    ast_verb(3, "[dev-manager] %u device(s) handled in %lld ms by %u worker(s)\n", count, (long long int)ms, started + 1u);
+    return batch.removals;
+}
 
 static void dev_manager_threadproc_state(struct public_state* const state)
 {
-    int manager_interval = SCONF_GLOBAL(state, manager_interval);
-    const int fd         = state->dev_manager_event;
+    struct dev_manager_stat* const stat = &state->dev_manager_stat;
+    const int fd                        = state->dev_manager_event;
+    int removals                        = 0;
+    int retry                           = 0; /* some device failed to start although its port exists */
 
     auto int ev_wait()
     {
-        int t = manager_interval * 1000;
+        /*
+            with udev events devices without ports are started on events, no periodic scan is needed,
+            kernel events come before udev creates symlinks, so periodic scan is kept for them
+        */
+        const int idle = !retry && !removals && SCONF_GLOBAL(state, hotplug) == HOTPLUG_UDEV && __atomic_load_n(&state->hotplug, __ATOMIC_ACQUIRE);
+        int t          = idle ? -1 : SCONF_GLOBAL(state, manager_interval) * 1000;
         return at_wait(fd, &t);
     }
 
+    /* device locked, device failed to initialize is started again not sooner than after discovery interval */
+    auto int start_delayed(const struct pvt* pvt)
+    {
+        if (!pvt->start_failed || pvt->desired_state != DEV_STATE_STARTED) {
+            return 0;
+        }
+        return ast_tvdiff_ms(ast_tvnow(), pvt->start_time) < SCONF_GLOBAL(state, manager_interval) * 1000;
+    }
+
+    /* device locked */
+    auto int must_handle(struct pvt * pvt)
+    {
+        if (pvt->must_remove) {
+            removals = 1;
+            return 0;
+        }
+        if (pvt->restart_time != RESTATE_TIME_NOW || pvt->desired_state == pvt->current_state) {
+            return 0;
+        }
+        if (start_delayed(pvt)) {
+            ast_atomic_fetchadd_int(&stat->delayed, 1);
+            retry = 1;
+            return 0;
+        }
+        return 1;
+    }
+
+    /* device list locked */
+    auto void handle(struct pvt* const* pvts, unsigned count)
+    {
+        if (!count) {
+            return;
+        }
+
+        if (dev_manager_batch(state, pvts, count)) {
+            removals = 1;
+        }
+
+        for (unsigned i = 0; i < count; ++i) {
+            SCOPED_MUTEX(pvt_lock, &pvts[i]->lock);
+            if (pvts[i]->desired_state != pvts[i]->current_state && !access(CONF_UNIQ(pvts[i], data_tty), F_OK)) {
+                retry = 1;
+            }
+        }
+    }
+
+    auto void handle_all()
+    {
+        struct pvt* pvts[MAXQUECTELDEVICES];
+        unsigned count = 0;
+        struct pvt* pvt;
+
+        ast_atomic_fetchadd_int(&stat->scans, 1);
+        retry = 0;
+        const unsigned int devices_rcu = DEVICES_RDLOCK(state);
+        DEVICES_TRAVERSE(state, pvt) {
+            SCOPED_MUTEX(pvt_lock, &pvt->lock);
+            if (must_handle(pvt) && count < ARRAY_LEN(pvts)) {
+                pvts[count++] = pvt;
+            }
+        }
+        handle(pvts, count);
+        DEVICES_UNLOCK(state, devices_rcu);
+    }
+
+    /* only devices with posted events */
+    auto void handle_posted(const dev_set_t* posted)
+    {
+        struct pvt* pvts[MAXQUECTELDEVICES];
+        unsigned count = 0;
+
+        const unsigned int devices_rcu = DEVICES_RDLOCK(state);
+        const unsigned c = dev_index_posted(&state->index, posted, pvts, ARRAY_LEN(pvts));
+        ast_atomic_fetchadd_int(&stat->handled, (int)c);
+        for (unsigned i = 0; i < c; ++i) {
+            SCOPED_MUTEX(pvt_lock, &pvts[i]->lock);
+            if (must_handle(pvts[i])) {
+                pvts[count++] = pvts[i];
+            }
+        }
+        handle(pvts, count);
+        DEVICES_UNLOCK(state, devices_rcu);
+    }
+
+    /* initial start of devices */
+    handle_all();
+
     while (1) {
         if (ev_wait() == fd) {
             eventfd_t val = 0;
@@ -328,84 +681,67 @@ static void dev_manager_threadproc_state(struct public_state* const state)
                 break;
             }
 
-            if (val == DEV_MANAGER_CMD_SCAN) {
-                ast_debug(3, "[dev-manager] Got scan event\n");
-                manager_interval = SCONF_GLOBAL(state, manager_interval);
-            } else if (val == DEV_MANAGER_CMD_STOP) {
+            if (__atomic_load_n(&state->dev_manager_exit, __ATOMIC_ACQUIRE)) {
                 ast_debug(3, "[dev-manager] Got exit event\n");
                 break;
+            }
+
+            dev_set_t posted;
+            if (dev_index_take_posted(&state->index, &posted)) {
+                ast_debug(3, "[dev-manager] Got device events\n");
+                handle_posted(&posted);
             } else {
-                ast_log(LOG_WARNING, "[dev-manager] Unknown command: %d - exiting\n", (int)val);
-                continue;
+                ast_debug(3, "[dev-manager] Got scan event\n");
+                handle_all();
             }
+        } else {
+            // timeout, retry devices failed to start
+            handle_all();
         }
 
-        // timeout
-        struct pvt* pvt;
-        /* read lock for avoid deadlock when IMEI/IMSI discovery */
-        AST_RWLIST_RDLOCK(&state->devices);
-        AST_RWLIST_TRAVERSE(&state->devices, pvt, entry) {
-            SCOPED_MUTEX(pvt_lock, &pvt->lock);
+        if (!removals) {
+            continue;
+        }
 
-            if (pvt->must_remove) {
-                continue;
-            }
+        /* actual device removal here, outside of read-side section */
 
-            if (pvt->restart_time != RESTATE_TIME_NOW) {
-                continue;
-            }
-            if (pvt->desired_state == pvt->current_state) {
+        struct pvt* removed[MAXQUECTELDEVICES];
+        unsigned count   = 0;
+        struct pvt* prev = NULL;
+        struct pvt* next;
+
+        removals = 0;
+        AST_RWLIST_WRLOCK(&state->devices);
+        for (struct pvt* pvt = state->devices.first; pvt; pvt = next) {
+            next = pvt->entry.next;
+            if (ast_mutex_trylock(&pvt->lock)) {
+                removals = 1;
+                prev     = pvt;
                 continue;
             }
 
-            switch (pvt->desired_state) {
-                case DEV_STATE_RESTARTED:
-                    ast_debug(4, "[dev-manager][%s] Restarting device\n", PVT_ID(pvt));
-                    pvt_monitor_stop(pvt);
-                    pvt->desired_state = DEV_STATE_STARTED;
-                    /* fall through */
-
-                case DEV_STATE_STARTED:
-                    ast_debug(4, "[dev-manager][%s] Starting device\n", PVT_ID(pvt));
-                    pvt_start(pvt);
-                    break;
-
-                case DEV_STATE_REMOVED:
-                    ast_debug(4, "[dev-manager][%s] Removing device\n", PVT_ID(pvt));
-                    pvt_monitor_stop(pvt);
-                    pvt->must_remove = 1;
-                    break;
-
-                case DEV_STATE_STOPPED:
-                    ast_debug(4, "[dev-manager][%s] Stopping device\n", PVT_ID(pvt));
-                    pvt_monitor_stop(pvt);
-                    break;
+            if (pvt->must_remove && count < ARRAY_LEN(removed)) {
+                devices_unlink(state, prev, pvt);
+                dev_index_remove(&state->index, pvt);
+                removed[count++] = pvt;
+            } else {
+                prev = pvt;
             }
+            ast_mutex_unlock(&pvt->lock);
         }
         AST_RWLIST_UNLOCK(&state->devices);
 
-        /* actual device removal here for avoid long (discovery) time write lock on device list in loop above */
-
-        if (AST_RWLIST_TRYWRLOCK(&state->devices)) {
+        if (!count) {
             continue;
         }
 
-        AST_RWLIST_TRAVERSE_SAFE_BEGIN(&state->devices, pvt, entry)
-            {
-                if (ast_mutex_trylock(&pvt->lock)) {
-                    continue;
-                }
-
-                if (pvt->must_remove) {
-                    ast_debug(4, "[dev-manager][%s] Freeing device\n", PVT_ID(pvt));
-                    AST_RWLIST_REMOVE_CURRENT(entry);
-                    pvt_free(pvt);
-                } else {
-                    ast_mutex_unlock(&pvt->lock);
-                }
-            }
-        AST_RWLIST_TRAVERSE_SAFE_END;
-        AST_RWLIST_UNLOCK(&state->devices);
+        /* unlinked devices may be still used by readers */
+        rcu_synchronize(&state->devices_rcu);
+        for (unsigned i = 0; i < count; ++i) {
+            ast_mutex_lock(&removed[i]->lock);
+            ast_debug(4, "[dev-manager][%s] Freeing device\n", PVT_ID(removed[i]));
+            pvt_free(removed[i]);
+        }
     }
 }
 
@@ -433,9 +769,91 @@ static void dev_manager_scan(const struct public_state* const state)
     }
 }
 
+/* device locked */
+static void dev_manager_post(struct public_state* const state, struct pvt* const pvt)
+{
+    if (ast_tvzero(pvt->restate_requested)) {
+        pvt->restate_requested = ast_tvnow();
+    }
+    if (ast_tvzero(pvt->ready_requested)) {
+        pvt->ready_requested = pvt->restate_requested;
+    }
+
+    ast_atomic_fetchadd_int(&state->dev_manager_stat.events, 1);
+    if (dev_index_post(&state->index, pvt) > 0) {
+        return; /* already posted, manager not yet woken */
+    }
+    dev_manager_scan(state);
+}
+
+void pvt_post_event(struct pvt* pvt) { dev_manager_post(gpublic, pvt); }
+
+// hotplug
+
+/* device locked */
+static int pvt_hotplug_match(const struct pvt* pvt, const struct hotplug_event* ev)
+{
+    if (hotplug_match(ev, CONF_UNIQ(pvt, data_tty), pvt->data_node)) {
+        return 1;
+    }
+    return CONF_UNIQ(pvt, uac) == TRIBOOL_FALSE && hotplug_match(ev, CONF_UNIQ(pvt, audio_tty), pvt->audio_node);
+}
+
+/* port of device appeared or disappeared */
+static void pvt_hotplug(const struct hotplug_event* ev)
+{
+    struct public_state* const state = gpublic;
+    const int add                    = !strcmp(ev->action, "add");
+    struct pvt* pvt;
+
+    if (!add && strcmp(ev->action, "remove")) {
+        return;
+    }
+
+    const unsigned int devices_rcu = DEVICES_RDLOCK(state);
+    DEVICES_TRAVERSE(state, pvt) {
+        SCOPED_MUTEX(pvt_lock, &pvt->lock);
+
+        if (pvt->must_remove || pvt->desired_state != DEV_STATE_STARTED || !pvt_hotplug_match(pvt, ev)) {
+            continue;
+        }
+
+        if (add ? pvt->current_state != DEV_STATE_STOPPED : pvt->current_state != DEV_STATE_STARTED) {
+            continue;
+        }
+
+        ast_verb(3, "[%s] Port %s %s\n", PVT_ID(pvt), ev->devname, add ? "appeared" : "disappeared");
+        ast_atomic_fetchadd_int(&state->dev_manager_stat.hotplug, 1);
+        if (!add) {
+            pvt->desired_state = DEV_STATE_RESTARTED;
+        }
+        pvt->restart_time = RESTATE_TIME_NOW;
+        dev_manager_post(state, pvt);
+    }
+    DEVICES_UNLOCK(state, devices_rcu);
+}
+
+int pvt_hotplug_replay(const char* path) { return hotplug_replay(path, pvt_hotplug); }
+
+/* start, stop or switch listener when mode is changed */
+static void hotplug_configure(struct public_state* const state)
+{
+    const hotplug_mode_t mode = SCONF_GLOBAL(state, hotplug);
+
+    if (mode == hotplug_get_mode(state->hotplug)) {
+        return;
+    }
+
+    hotplug_stop(state->hotplug);
+    __atomic_store_n(&state->hotplug, hotplug_start(mode, pvt_hotplug), __ATOMIC_RELEASE);
+    /* manager may wait for events without timeout */
+    dev_manager_scan(state);
+}
+
 static void dev_manager_stop(struct public_state* const state)
 {
-    if (eventfd_write(state->dev_manager_event, DEV_MANAGER_CMD_STOP)) {
+    __atomic_store_n(&state->dev_manager_exit, 1, __ATOMIC_RELEASE);
+    if (eventfd_write(state->dev_manager_event, DEV_MANAGER_CMD_SCAN)) {
         ast_log(LOG_ERROR, "Unable to signal device manager thread\n");
     }
 
@@ -585,6 +1003,35 @@ int pvt_ready4voice_call(const struct pvt* pvt, const struct cpvt* current_cpvt,
 
 #/* */
 
+int pvt_rate_limit_check(const struct pvt* pvt, rate_limit_t limit)
+{
+    struct rate_limit rl = pvt->limits[limit];
+    return !rate_limit_take(&rl, &CONF_SHARED(pvt, limits[limit]), rate_limit_now());
+}
+
+int pvt_rate_limit_take(struct pvt* pvt, rate_limit_t limit)
+{
+    const struct rate_limit_conf* const conf = &CONF_SHARED(pvt, limits[limit]);
+
+    if (rate_limit_take(&pvt->limits[limit], conf, rate_limit_now())) {
+        PVT_STAT(pvt, rate_limited[limit])++;
+        ast_debug(1, "[%s] Rate limit of %s requests exceeded, %u per %u seconds\n", PVT_ID(pvt), rate_limit2str(limit), conf->count, conf->period);
+        chan_quectel_err = E_RATE_LIMITED;
+        return -1;
+    }
+
+    dev_index_set_throttled(&gpublic->index, pvt, limit, rate_limit_next(&pvt->limits[limit], conf));
+    return 0;
+}
+
+void pvt_rate_limit_give(struct pvt* pvt, rate_limit_t limit)
+{
+    const struct rate_limit_conf* const conf = &CONF_SHARED(pvt, limits[limit]);
+
+    rate_limit_give(&pvt->limits[limit], conf);
+    dev_index_set_throttled(&gpublic->index, pvt, limit, rate_limit_next(&pvt->limits[limit], conf));
+}
+
 static int can_dial(struct pvt* pvt, unsigned int opts)
 {
     /* not allow hold requester channel :) */
@@ -592,7 +1039,7 @@ static int can_dial(struct pvt* pvt, unsigned int opts)
     //	use ast_bridged_channel(chan) ?
     //	use requestor->tech->get_base_channel() ?
 
-    return pvt_ready4voice_call(pvt, NULL, opts);
+    return pvt_ready4voice_call(pvt, NULL, opts) && pvt_rate_limit_check(pvt, RATE_LIMIT_CALL);
 }
 
 static int can_send_message(struct pvt* pvt, attribute_unused unsigned int opts)
@@ -601,7 +1048,7 @@ static int can_send_message(struct pvt* pvt, attribute_unused unsigned int opts)
         return 0;
     }
 
-    return 1;
+    return pvt_rate_limit_check(pvt, RATE_LIMIT_SMS);
 }
 
 void pvt_unlock(struct pvt* const pvt)
@@ -613,6 +1060,59 @@ void pvt_unlock(struct pvt* const pvt)
     ast_mutex_unlock(&pvt->lock);
 }
 
+void pvt_update_index(struct pvt* pvt) { dev_index_update(&gpublic->index, pvt); }
+
+void pvt_initialized(struct pvt* pvt)
+{
+    struct dev_manager_stat* const stat = &gpublic->dev_manager_stat;
+
+    pvt->initialized = 1;
+    ready_stat(stat, pvt);
+
+    if (ast_tvzero(pvt->connect_time)) {
+        return;
+    }
+
+    pvt->init_ms      = ast_tvdiff_ms(ast_tvnow(), pvt->connect_time);
+    pvt->connect_time = ast_tv(0, 0);
+    if (pvt->identity_cached) {
+        ast_atomic_fetchadd_int(&stat->inits_cached, 1);
+        stat_add(&stat->cached_ms, &stat->cached_ms_max, (uint64_t)pvt->init_ms);
+    } else {
+        ast_atomic_fetchadd_int(&stat->inits, 1);
+        stat_add(&stat->init_ms, &stat->init_ms_max, (uint64_t)pvt->init_ms);
+    }
+    ast_verb(3, "[%s] Initialized in %lld ms%s\n", PVT_ID(pvt), (long long int)pvt->init_ms, pvt->identity_cached ? " with cached identity" : "");
+}
+
+void pvt_publish_ready(struct pvt* pvt)
+{
+    const uint32_t out_calls = PVT_STAT(pvt, out_calls);
+    const uint32_t answered  = PVT_STAT(pvt, calls_answered[CALL_DIR_OUTGOING]);
+    unsigned int ready       = 0;
+
+    const struct dev_load load = {
+        .chans  = PVT_STATE(pvt, chansno),
+        .rssi   = pvt->rssi == 99 ? -1 : pvt->rssi,
+        .asr    = out_calls ? (unsigned int)(MIN(answered, out_calls) * 1000ull / out_calls) : 1000u,
+        .weight = (unsigned int)CONF_SHARED(pvt, weight),
+    };
+
+    if (pvt->connected && pvt->initialized && pvt->gsm_registered && pvt_enabled(pvt)) {
+        if (pvt->has_voice) {
+            ready |= DEV_READY_VOICE;
+            if (is_dial_possible2(pvt, CALL_FLAG_NONE, NULL)) {
+                ready |= DEV_READY_FREE;
+            }
+        }
+        if (pvt->has_sms) {
+            ready |= DEV_READY_SMS;
+        }
+    }
+
+    dev_index_set_ready(&gpublic->index, pvt, ready, &load);
+}
+
 int pvt_taskproc_trylock_and_execute(struct pvt* pvt, void (*task_exe)(struct pvt* pvt), const char* task_name)
 {
     if (!pvt) {
@@ -660,19 +1160,23 @@ int pvt_taskproc_lock_and_execute(struct pvt_taskproc_data* ptd, void (*task_exe
 
 struct pvt* pvt_find_ex(struct public_state* state, const char* name)
 {
-    struct pvt* pvt;
+    struct pvt* candidates[MAXQUECTELDEVICES];
+    struct pvt* found = NULL;
 
-    AST_RWLIST_RDLOCK(&state->devices);
-    AST_RWLIST_TRAVERSE(&state->devices, pvt, entry) {
+    const unsigned int devices_rcu = DEVICES_RDLOCK(state);
+    const unsigned c = dev_index_find(&state->index, DEV_INDEX_ID, name, candidates, ARRAY_LEN(candidates));
+    for (unsigned i = 0; i < c; ++i) {
+        struct pvt* const pvt = candidates[i];
         ast_mutex_lock(&pvt->lock);
         if (!strcmp(PVT_ID(pvt), name)) {
+            found = pvt;
             break;
         }
         ast_mutex_unlock(&pvt->lock);
     }
-    AST_RWLIST_UNLOCK(&state->devices);
+    DEVICES_UNLOCK(state, devices_rcu);
 
-    return pvt;
+    return found;
 }
 
 #/* return locked pvt or NULL */
@@ -694,8 +1198,10 @@ struct pvt* pvt_find_by_ext(const char* name)
 }
 
 static struct pvt* pvt_find_by_resource_fn(struct public_state* state, const char* resource, unsigned int opts, int (*pvt_test_fn)(struct pvt*, unsigned int),
-                                           const struct ast_channel* requestor, int* exists)
+                                           unsigned int ready, int limit, const struct ast_channel* requestor, int* exists)
 {
+    const int64_t now = rate_limit_now();
+
     auto int test_fn(struct pvt * pvt)
     {
         if (opts & CALL_FLAG_INTERNAL_REQUEST) {
@@ -709,209 +1215,241 @@ static struct pvt* pvt_find_by_resource_fn(struct public_state* state, const cha
         return (*pvt_test_fn)(pvt, opts);
     }
 
-    int group;
-    size_t i;
-    size_t j;
-    size_t c;
-    size_t last_used;
-    struct pvt* pvt;
-    struct pvt* found = NULL;
-    struct pvt* round_robin[MAXQUECTELDEVICES];
+    /* candidate still has the key, index may be updated after lookup */
+    auto int match_fn(struct pvt * pvt, dev_index_kind_t kind, const char* key)
+    {
+        switch (kind) {
+            case DEV_INDEX_GROUP:
+                return CONF_SHARED(pvt, group) == (int)strtol(key, NULL, 10);
 
-    *exists = 0;
-    /* Find requested device and make sure it's connected and initialized. */
-    AST_RWLIST_RDLOCK(&state->devices);
+            case DEV_INDEX_PROVIDER:
+                return !strcmp(pvt->provider_name, key);
 
-    if (((resource[0] == 'g') || (resource[0] == 'G')) && ((resource[1] >= '0') && (resource[1] <= '9'))) {
-        errno = 0;
-        group = (int)strtol(&resource[1], (char**)NULL, 10);
-        if (errno != EINVAL) {
-            AST_RWLIST_TRAVERSE(&state->devices, pvt, entry) {
-                ast_mutex_lock(&pvt->lock);
-
-                if (CONF_SHARED(pvt, group) == group) {
-                    *exists = 1;
-                    if (test_fn(pvt)) {
-                        found = pvt;
-                        break;
-                    }
-                }
-                ast_mutex_unlock(&pvt->lock);
-            }
-        }
-    } else if (((resource[0] == 'r') || (resource[0] == 'R')) && ((resource[1] >= '0') && (resource[1] <= '9'))) {
-        errno = 0;
-        group = (int)strtol(&resource[1], (char**)NULL, 10);
-        if (errno != EINVAL) {
-            /* Generate a list of all available devices */
-            j         = ARRAY_LEN(round_robin);
-            c         = 0;
-            last_used = 0;
-            AST_RWLIST_TRAVERSE(&state->devices, pvt, entry) {
-                SCOPED_MUTEX(pvt_lock, &pvt->lock);
-                if (CONF_SHARED(pvt, group) == group) {
-                    round_robin[c] = pvt;
-                    if (pvt->group_last_used == 1) {
-                        pvt->group_last_used = 0;
-                        last_used            = c;
-                    }
-
-                    ++c;
-
-                    if (c == j) {
-                        break;
-                    }
-                }
-            }
+            case DEV_INDEX_IMEI:
+                return !strcmp(pvt->imei, key);
 
-            /* Search for a available device starting at the last used device */
-            for (i = 0, j = last_used + 1; i < c; i++, j++) {
-                if (j == c) {
-                    j = 0;
-                }
+            case DEV_INDEX_ICCID:
+                return !strcmp(pvt->iccid, key);
 
-                pvt     = round_robin[j];
-                *exists = 1;
+            case DEV_INDEX_IMSI:
+                return !strncmp(pvt->imsi, key, strlen(key));
 
-                ast_mutex_lock(&pvt->lock);
-                if (test_fn(pvt)) {
-                    pvt->group_last_used = 1;
-                    found                = pvt;
-                    break;
-                }
-                ast_mutex_unlock(&pvt->lock);
-            }
+            default:
+                return !strcmp(PVT_ID(pvt), key);
         }
-    } else if (((resource[0] == 'p') || (resource[0] == 'P')) && resource[1] == ':') {
-        /* Generate a list of all available devices */
-        j         = ARRAY_LEN(round_robin);
-        c         = 0;
-        last_used = 0;
-        AST_RWLIST_TRAVERSE(&state->devices, pvt, entry) {
-            SCOPED_MUTEX(pvt_lock, &pvt->lock);
-            if (!strcmp(pvt->provider_name, &resource[2])) {
-                round_robin[c] = pvt;
-                if (pvt->prov_last_used == 1) {
-                    pvt->prov_last_used = 0;
-                    last_used           = c;
-                }
+    }
 
-                ++c;
+    /* published readiness and rate limits, candidates not ready are skipped without locking */
+    auto int ready_fn(struct pvt * pvt)
+    {
+        if (dev_index_is_ready(&state->index, pvt, ready) && (limit < 0 || !dev_index_is_throttled(&state->index, pvt, (rate_limit_t)limit, now))) {
+            return 1;
+        }
 
-                if (c == j) {
-                    break;
-                }
-            }
+        ast_atomic_fetchadd_int(&state->index.select_skipped, 1);
+        return 0;
+    }
+
+    auto void lock_fn(struct pvt * pvt)
+    {
+        ast_atomic_fetchadd_int(&state->index.select_locked, 1);
+        if (!ast_mutex_trylock(&pvt->lock)) {
+            return;
         }
 
-        /* Search for a available device starting at the last used device */
-        for (i = 0, j = last_used + 1; i < c; ++i, ++j) {
-            if (j == c) {
-                j = 0;
-            }
+        ast_atomic_fetchadd_int(&state->index.select_contended, 1);
+        ast_mutex_lock(&pvt->lock);
+    }
 
-            pvt     = round_robin[j];
-            *exists = 1;
+    /* first available device */
+    auto struct pvt * find_first(struct pvt** candidates, unsigned c, dev_index_kind_t kind, const char* key)
+    {
+        for (unsigned i = 0; i < c; ++i) {
+            struct pvt* const pvt = candidates[i];
 
-            ast_mutex_lock(&pvt->lock);
-            if (test_fn(pvt)) {
-                pvt->prov_last_used = 1;
-                found               = pvt;
-                break;
+            if (!ready_fn(pvt)) {
+                *exists = 1;
+                continue;
             }
-            ast_mutex_unlock(&pvt->lock);
-        }
-    } else if (((resource[0] == 's') || (resource[0] == 'S')) && resource[1] == ':') {
-        /* Generate a list of all available devices */
-        j         = ARRAY_LEN(round_robin);
-        c         = 0;
-        last_used = 0;
-        i         = strlen(&resource[2]);
 
-        AST_RWLIST_TRAVERSE(&state->devices, pvt, entry) {
-            SCOPED_MUTEX(pvt_lock, &pvt->lock);
-            if (!strncmp(pvt->imsi, &resource[2], i)) {
-                round_robin[c] = pvt;
-                if (pvt->sim_last_used == 1) {
-                    pvt->sim_last_used = 0;
-                    last_used          = c;
+            lock_fn(pvt);
+            if (match_fn(pvt, kind, key)) {
+                *exists = 1;
+                if (test_fn(pvt)) {
+                    return pvt;
                 }
+            }
+            ast_mutex_unlock(&pvt->lock);
+        }
+        return NULL;
+    }
 
-                ++c;
+    /* first available device starting after last used one */
+    auto struct pvt * find_round_robin(struct pvt** candidates, unsigned c, dev_index_kind_t kind, const char* key)
+    {
+        unsigned last_used = 0;
 
-                if (c == j) {
-                    break;
-                }
+        for (unsigned i = 0; i < c; ++i) {
+            if (dev_index_take_last_used(&state->index, candidates[i], kind)) {
+                last_used = i;
             }
         }
 
-        /* Search for a available device starting at the last used device */
-        for (i = 0, j = last_used + 1; i < c; ++i, ++j) {
-            if (j == c) {
+        for (unsigned i = 0, j = last_used + 1u; i < c; ++i, ++j) {
+            if (j >= c) {
                 j = 0;
             }
 
-            pvt     = round_robin[j];
-            *exists = 1;
+            struct pvt* const pvt = candidates[j];
 
-            ast_mutex_lock(&pvt->lock);
-            if (test_fn(pvt)) {
-                pvt->sim_last_used = 1;
-                found              = pvt;
-                break;
+            if (!ready_fn(pvt)) {
+                *exists = 1;
+                continue;
             }
-            ast_mutex_unlock(&pvt->lock);
-        }
-    } else if (((resource[0] == 'i') || (resource[0] == 'I')) && resource[1] == ':') {
-        AST_RWLIST_TRAVERSE(&state->devices, pvt, entry) {
-            ast_mutex_lock(&pvt->lock);
-            if (!strcmp(pvt->imei, &resource[2])) {
+
+            lock_fn(pvt);
+            if (match_fn(pvt, kind, key)) {
                 *exists = 1;
                 if (test_fn(pvt)) {
-                    found = pvt;
-                    break;
+                    dev_index_set_last_used(&state->index, pvt, kind);
+                    return pvt;
                 }
             }
             ast_mutex_unlock(&pvt->lock);
         }
-    } else if (((resource[0] == 'j') || (resource[0] == 'J')) && resource[1] == ':') {
-        AST_RWLIST_TRAVERSE(&state->devices, pvt, entry) {
-            ast_mutex_lock(&pvt->lock);
-            if (!strcmp(pvt->iccid, &resource[2])) {
+        return NULL;
+    }
+
+    /* available device with the best published load */
+    auto struct pvt * find_ordered(struct pvt** candidates, unsigned c, dev_index_kind_t kind, const char* key, dev_select_t strategy)
+    {
+        unsigned n = 0;
+
+        for (unsigned i = 0; i < c; ++i) {
+            if (ready_fn(candidates[i])) {
+                candidates[n++] = candidates[i];
+            } else {
                 *exists = 1;
-                if (test_fn(pvt)) {
-                    found = pvt;
-                    break;
-                }
             }
-            ast_mutex_unlock(&pvt->lock);
         }
-    } else {
-        AST_RWLIST_TRAVERSE(&state->devices, pvt, entry) {
-            ast_mutex_lock(&pvt->lock);
-            if (!strcmp(PVT_ID(pvt), resource)) {
+
+        dev_index_order(&state->index, strategy, candidates, n);
+
+        for (unsigned i = 0; i < n; ++i) {
+            struct pvt* const pvt = candidates[i];
+
+            lock_fn(pvt);
+            if (match_fn(pvt, kind, key)) {
                 *exists = 1;
                 if (test_fn(pvt)) {
-                    found = pvt;
-                    break;
+                    return pvt;
                 }
             }
             ast_mutex_unlock(&pvt->lock);
         }
+        return NULL;
+    }
+
+    char group[16];
+    const char* key;
+    dev_index_kind_t kind;
+    dev_select_t strategy;
+    unsigned c;
+    struct pvt* found = NULL;
+    struct pvt* candidates[MAXQUECTELDEVICES];
+
+    /* optional selection strategy, e.g. r1@idle */
+    char* const res              = ast_strdupa(resource);
+    char* const suffix           = strrchr(res, '@');
+    const dev_select_t requested = suffix ? dev_select_str2strategy(suffix + 1) : DEV_SELECT_DEFAULT;
+    if (requested != DEV_SELECT_DEFAULT) {
+        *suffix = '\0';
+    }
+    resource = res;
+
+    if (opts & CALL_FLAG_INTERNAL_REQUEST) {
+        ready = 0;
+        limit = -1;
+    }
+
+    *exists = 0;
+    ast_atomic_fetchadd_int(&state->index.select_lookups, 1);
+    /* Find requested device and make sure it's connected and initialized. */
+    const unsigned int devices_rcu = DEVICES_RDLOCK(state);
+
+    if (((resource[0] == 'g') || (resource[0] == 'G')) && ((resource[1] >= '0') && (resource[1] <= '9'))) {
+        snprintf(group, sizeof(group), "%d", (int)strtol(&resource[1], (char**)NULL, 10));
+        kind     = DEV_INDEX_GROUP;
+        key      = group;
+        strategy = DEV_SELECT_FIRST;
+    } else if (((resource[0] == 'r') || (resource[0] == 'R')) && ((resource[1] >= '0') && (resource[1] <= '9'))) {
+        snprintf(group, sizeof(group), "%d", (int)strtol(&resource[1], (char**)NULL, 10));
+        kind     = DEV_INDEX_GROUP;
+        key      = group;
+        strategy = DEV_SELECT_ROUND_ROBIN;
+    } else if (((resource[0] == 'p') || (resource[0] == 'P')) && resource[1] == ':') {
+        kind     = DEV_INDEX_PROVIDER;
+        key      = &resource[2];
+        strategy = DEV_SELECT_ROUND_ROBIN;
+    } else if (((resource[0] == 's') || (resource[0] == 'S')) && resource[1] == ':') {
+        kind     = DEV_INDEX_IMSI;
+        key      = &resource[2];
+        strategy = DEV_SELECT_ROUND_ROBIN;
+    } else if (((resource[0] == 'i') || (resource[0] == 'I')) && resource[1] == ':') {
+        kind     = DEV_INDEX_IMEI;
+        key      = &resource[2];
+        strategy = DEV_SELECT_FIRST;
+    } else if (((resource[0] == 'j') || (resource[0] == 'J')) && resource[1] == ':') {
+        kind     = DEV_INDEX_ICCID;
+        key      = &resource[2];
+        strategy = DEV_SELECT_FIRST;
+    } else {
+        kind     = DEV_INDEX_ID;
+        key      = resource;
+        strategy = DEV_SELECT_FIRST;
+    }
+
+    if (requested != DEV_SELECT_DEFAULT) {
+        strategy = requested;
     }
 
-    AST_RWLIST_UNLOCK(&state->devices);
+    if (kind == DEV_INDEX_IMSI) {
+        c = dev_index_find_imsi(&state->index, key, candidates, ARRAY_LEN(candidates));
+    } else {
+        c = dev_index_find(&state->index, kind, key, candidates, ARRAY_LEN(candidates));
+    }
+
+    switch (strategy) {
+        case DEV_SELECT_FIRST:
+            found = find_first(candidates, c, kind, key);
+            break;
+
+        case DEV_SELECT_ROUND_ROBIN:
+            found = find_round_robin(candidates, c, kind, key);
+            break;
+
+        default:
+            found = find_ordered(candidates, c, kind, key, strategy);
+            break;
+    }
+
+    if (found) {
+        dev_index_selected(&state->index, found, strategy);
+    }
+
+    DEVICES_UNLOCK(state, devices_rcu);
     return found;
 }
 
 struct pvt* pvt_find_by_resource_ex(struct public_state* state, const char* resource, unsigned int opts, const struct ast_channel* requestor, int* exists)
 {
-    return pvt_find_by_resource_fn(state, resource, opts, &can_dial, requestor, exists);
+    const unsigned int ready = (opts & CALL_FLAG_HOLD_OTHER) == CALL_FLAG_HOLD_OTHER ? DEV_READY_VOICE : DEV_READY_VOICE | DEV_READY_FREE;
+    return pvt_find_by_resource_fn(state, resource, opts, &can_dial, ready, RATE_LIMIT_CALL, requestor, exists);
 }
 
 struct pvt* pvt_msg_find_by_resource_ex(struct public_state* state, const char* resource, unsigned int opts, const struct ast_channel* requestor, int* exists)
 {
-    return pvt_find_by_resource_fn(state, resource, opts, &can_send_message, requestor, exists);
+    return pvt_find_by_resource_fn(state, resource, opts, &can_send_message, DEV_READY_SMS, RATE_LIMIT_SMS, requestor, exists);
 }
 
 struct cpvt* pvt_channel_find_by_call_idx(struct pvt* pvt, int call_idx)
@@ -1121,18 +1659,27 @@ static struct pvt* pvt_create(const pvt_config_t* settings)
 
     ast_mutex_init(&pvt->lock);
 
-    AST_LIST_HEAD_INIT_NOLOCK(&pvt->at_queue);
+    for (unsigned i = 0; i < ATQ_CLASSES; ++i) {
+        AST_LIST_HEAD_INIT_NOLOCK(&pvt->at_queue[i]);
+    }
+    AST_LIST_HEAD_INIT_NOLOCK(&pvt->at_task_pool);
+    AST_LIST_HEAD_INIT_NOLOCK(&pvt->sms_queue.msgs);
     AST_LIST_HEAD_INIT_NOLOCK(&pvt->chans);
+    AST_VECTOR_INIT(&pvt->sms_delete_pending, 0);
+    rb_init(&pvt->d_write_rb, pvt->d_write_buf, sizeof(pvt->d_write_buf));
 
     pvt->monitor_thread     = AST_PTHREADT_NULL;
     pvt->sys_chan.pvt       = pvt;
     pvt->sys_chan.state     = CALL_STATE_RELEASED;
     pvt->audio_fd           = -1;
     pvt->data_fd            = -1;
+    pvt->d_write_event      = -1;
+    pvt->index_slot         = -1;
     pvt->gsm_reg_status     = -1;
     pvt->has_sms            = SCONFIG(settings, msg_direct) ? 0 : 1;
     pvt->incoming_sms_index = -1;
     pvt->incoming_sms_type  = RES_UNKNOWN;
+    pvt->cms_error          = -1;
     pvt->desired_state      = SCONFIG(settings, init_state);
 
     ast_string_field_init(pvt, 15);
@@ -1165,15 +1712,40 @@ void pvt_try_restate(struct pvt* pvt)
 {
     if (pvt_time4restate(pvt)) {
         pvt->restart_time = RESTATE_TIME_NOW;
-        dev_manager_scan(gpublic);
+        dev_manager_post(gpublic, pvt);
     }
+    pvt_publish_ready(pvt);
 }
 
 #/* assume caller hold lock */
 
+static void pvt_reconfigure_hot(struct pvt* pvt, const pvt_config_t* settings)
+{
+    const int txgain = SCONFIG(settings, txgain);
+    const int rxgain = SCONFIG(settings, rxgain);
+
+    ast_verb(3, "[%s] Settings changed, applied without restart\n", PVT_ID(pvt));
+
+    /* throttling published in device index follows changed limits */
+    for (unsigned i = 0; i < RATE_LIMITS; ++i) {
+        dev_index_set_throttled(&gpublic->index, pvt, (rate_limit_t)i, rate_limit_next(&pvt->limits[i], &SCONFIG(settings, limits[i])));
+    }
+
+    /* gains are set by initialization, set them again on running device */
+    if (!pvt->initialized || !pvt->has_voice || (txgain == CONF_SHARED(pvt, txgain) && rxgain == CONF_SHARED(pvt, rxgain))) {
+        return;
+    }
+
+    const int res = pvt->is_simcom ? at_enqueue_cgains(&pvt->sys_chan, txgain, rxgain) : at_enqueue_qgains(&pvt->sys_chan, txgain, rxgain);
+    if (res) {
+        ast_log(LOG_WARNING, "[%s] Unable to change gains: %s\n", PVT_ID(pvt), error2str(chan_quectel_err));
+    }
+}
+
 static int pvt_reconfigure(struct pvt* pvt, const pvt_config_t* settings, restate_time_t when)
 {
-    int rv = 0;
+    struct reload_stat* const stat = &gpublic->reload_stat;
+    int rv                         = 0;
 
     if (SCONFIG(settings, init_state) == DEV_STATE_REMOVED) {
         /* handle later, in one place */
@@ -1191,13 +1763,25 @@ static int pvt_reconfigure(struct pvt* pvt, const pvt_config_t* settings, restat
         else if (pvt_config_compare(settings, &pvt->settings)) {
             /* TODO: schedule restart */
             pvt->desired_state = DEV_STATE_RESTARTED;
+            ast_atomic_fetchadd_int(&stat->restarts, 1);
 
             rv                = pvt_time4restate(pvt);
             pvt->restart_time = rv ? RESTATE_TIME_NOW : when;
         }
 
+        /* settings read when used, device keeps running */
+        else if (pvt_config_compare_hot(settings, &pvt->settings)) {
+            ast_atomic_fetchadd_int(&stat->hot, 1);
+            pvt_reconfigure_hot(pvt, settings);
+        }
+
         /* and copy settings */
         pvt->settings = *settings;
+        pvt_update_index(pvt);
+        pvt_publish_ready(pvt);
+        if (rv) {
+            pvt_post_event(pvt);
+        }
     }
     return rv;
 }
@@ -1221,12 +1805,12 @@ static void mark_must_remove(public_state_t* const state)
     struct pvt* pvt;
 
     /* FIXME: deadlock avoid ? */
-    AST_RWLIST_RDLOCK(&state->devices);
-    AST_RWLIST_TRAVERSE(&state->devices, pvt, entry) {
+    const unsigned int devices_rcu = DEVICES_RDLOCK(state);
+    DEVICES_TRAVERSE(state, pvt) {
         SCOPED_MUTEX(pvt_lock, &pvt->lock);
         pvt->must_remove = 1;
     }
-    AST_RWLIST_UNLOCK(&state->devices);
+    DEVICES_UNLOCK(state, devices_rcu);
 }
 
 static void mark_remove(public_state_t* const state, const restate_time_t when, unsigned int* reload_cnt)
@@ -1235,22 +1819,24 @@ static void mark_remove(public_state_t* const state, const restate_time_t when,
 
     /* FIXME: deadlock avoid ? */
     /* schedule removal of devices not listed in config file or disabled */
-    AST_RWLIST_RDLOCK(&state->devices);
-    AST_RWLIST_TRAVERSE(&state->devices, pvt, entry) {
+    const unsigned int devices_rcu = DEVICES_RDLOCK(state);
+    DEVICES_TRAVERSE(state, pvt) {
         SCOPED_MUTEX(pvt_lock, &pvt->lock);
         if (!pvt->must_remove) {
             continue;
         }
 
         pvt->desired_state = DEV_STATE_REMOVED;
+        pvt_publish_ready(pvt);
         if (pvt_time4restate(pvt)) {
             pvt->restart_time = RESTATE_TIME_NOW;
+            dev_manager_post(state, pvt);
             (*reload_cnt)++;
         } else {
             pvt->restart_time = when;
         }
     }
-    AST_RWLIST_UNLOCK(&state->devices);
+    DEVICES_UNLOCK(state, devices_rcu);
 }
 
 static int reload_config(public_state_t* state, int recofigure, restate_time_t when, unsigned* reload_immediality)
@@ -1305,9 +1891,12 @@ static int reload_config(public_state_t* state, int recofigure, restate_time_t w
             if (!new_pvt) {
                 continue;
             }
-            /* FIXME: deadlock avoid ? */
             AST_RWLIST_WRLOCK(&state->devices);
-            AST_RWLIST_INSERT_TAIL(&state->devices, new_pvt, entry);
+            devices_link(state, new_pvt);
+            ast_mutex_lock(&new_pvt->lock);
+            dev_index_add(&state->index, new_pvt);
+            dev_manager_post(state, new_pvt);
+            ast_mutex_unlock(&new_pvt->lock);
             AST_RWLIST_UNLOCK(&state->devices);
             reload_now++;
 
@@ -1328,14 +1917,27 @@ static int reload_config(public_state_t* state, int recofigure, restate_time_t w
 
 static void devices_destroy(public_state_t* state)
 {
-    struct pvt* pvt;
+    struct pvt* removed[MAXQUECTELDEVICES];
+    unsigned count;
 
     /* Destroy the device list */
-    AST_RWLIST_WRLOCK(&state->devices);
-    while ((pvt = AST_RWLIST_REMOVE_HEAD(&state->devices, entry))) {
-        pvt_destroy(pvt);
-    }
-    AST_RWLIST_UNLOCK(&state->devices);
+    do {
+        struct pvt* pvt;
+
+        count = 0;
+        AST_RWLIST_WRLOCK(&state->devices);
+        while (count < ARRAY_LEN(removed) && (pvt = state->devices.first)) {
+            devices_unlink(state, NULL, pvt);
+            dev_index_remove(&state->index, pvt);
+            removed[count++] = pvt;
+        }
+        AST_RWLIST_UNLOCK(&state->devices);
+
+        rcu_synchronize(&state->devices_rcu);
+        for (unsigned i = 0; i < count; ++i) {
+            pvt_destroy(removed[i]);
+        }
+    } while (count);
 }
 
 const struct ast_format* pvt_get_audio_format(const struct pvt* const pvt)
@@ -1393,13 +1995,78 @@ int pvt_direct_write(struct pvt* pvt, const char* buf, size_t count)
 {
     ast_debug(5, "[%s] [%s]\n", PVT_ID(pvt), tmp_esc_nstr(buf, count));
 
-    const size_t wrote            = fd_write_all(pvt->data_fd, buf, count);
-    PVT_STAT(pvt, d_write_bytes) += wrote;
-    if (wrote != count) {
-        ast_debug(1, "[%s][DATA] Write: %s\n", PVT_ID(pvt), strerror(errno));
+    struct ringbuffer* const rb = &pvt->d_write_rb;
+    size_t wrote                = 0;
+
+    /* keep order of commands, write directly only if nothing is buffered */
+    if (!rb_used(rb)) {
+        const ssize_t res = write(pvt->data_fd, buf, count);
+        if (res < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                ast_debug(1, "[%s][DATA] Write: %s\n", PVT_ID(pvt), strerror(errno));
+                return -1;
+            }
+            PVT_STAT(pvt, d_write_eagain)++;
+        } else {
+            wrote                         = (size_t)res;
+            PVT_STAT(pvt, d_write_bytes) += wrote;
+            if (wrote < count) {
+                PVT_STAT(pvt, d_write_short)++;
+            }
+        }
+    }
+
+    if (wrote == count) {
+        AT_TRACE(pvt->trace, AT_TRACE_TX, buf, count);
+        return 0;
+    }
+
+    const size_t rest = count - wrote;
+    if (rest > rb_free(rb)) {
+        ast_log(LOG_ERROR, "[%s][DATA] Write buffer overflow, %zu bytes buffered\n", PVT_ID(pvt), rb_used(rb));
+        PVT_STAT(pvt, d_write_overflow)++;
+        return -1;
     }
 
-    return wrote != count;
+    rb_write(rb, buf + wrote, rest);
+    AT_TRACE(pvt->trace, AT_TRACE_TX, buf, count);
+    if (rb_used(rb) > PVT_STAT(pvt, d_write_max)) {
+        PVT_STAT(pvt, d_write_max) = rb_used(rb);
+    }
+    ast_debug(4, "[%s][DATA] Device busy, %zu bytes buffered\n", PVT_ID(pvt), rb_used(rb));
+
+    if (pvt->d_write_event >= 0) {
+        eventfd_signal(pvt->d_write_event);
+    }
+    return 0;
+}
+
+ssize_t pvt_direct_flush(struct pvt* pvt)
+{
+    struct ringbuffer* const rb = &pvt->d_write_rb;
+    struct iovec iov[2];
+
+    const int iovcnt = rb_read_all_iov(rb, iov);
+    if (iovcnt <= 0) {
+        return 0;
+    }
+
+    const ssize_t res = writev(pvt->data_fd, iov, iovcnt);
+    if (res < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            ast_debug(1, "[%s][DATA] Write: %s\n", PVT_ID(pvt), strerror(errno));
+            return -1;
+        }
+        PVT_STAT(pvt, d_write_eagain)++;
+        return (ssize_t)rb_used(rb);
+    }
+
+    PVT_STAT(pvt, d_write_bytes) += (size_t)res;
+    rb_read_upd(rb, (size_t)res);
+    if (rb_used(rb)) {
+        PVT_STAT(pvt, d_write_short)++;
+    }
+    return (ssize_t)rb_used(rb);
 }
 
 static struct ast_threadpool* threadpool_create()
@@ -1461,10 +2128,13 @@ static int public_state_init(struct public_state* state)
     state->dev_manager_thread = AST_PTHREADT_NULL;
 
     AST_RWLIST_HEAD_INIT(&state->devices);
+    rcu_init(&state->devices_rcu);
+    dev_index_init(&state->index);
 
     if (reload_config(state, 0, RESTATE_TIME_NOW, NULL)) {
         ast_log(LOG_ERROR, "Errors reading config file " CONFIG_FILE ", Not loading module\n");
         AST_RWLIST_HEAD_DESTROY(&state->devices);
+        dev_index_destroy(&state->index);
         return rv;
     }
 
@@ -1474,9 +2144,12 @@ static int public_state_init(struct public_state* state)
         ast_log(LOG_ERROR, "Unable to create device manager thread\n");
         devices_destroy(state);
         AST_RWLIST_HEAD_DESTROY(&state->devices);
+        dev_index_destroy(&state->index);
         return rv;
     }
 
+    hotplug_configure(state);
+
     /* set preferred capabilities */
     if (!(channel_tech.capabilities = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT))) {
         rv = AST_MODULE_LOAD_FAILURE;
@@ -1484,6 +2157,7 @@ static int public_state_init(struct public_state* state)
         dev_manager_stop(state);
         devices_destroy(state);
         AST_RWLIST_HEAD_DESTROY(&state->devices);
+        dev_index_destroy(&state->index);
         return rv;
     }
 
@@ -1499,6 +2173,7 @@ static int public_state_init(struct public_state* state)
         dev_manager_stop(state);
         devices_destroy(state);
         AST_RWLIST_HEAD_DESTROY(&state->devices);
+        dev_index_destroy(&state->index);
         return rv;
     }
 
@@ -1537,11 +2212,14 @@ static void public_state_fini(struct public_state* const state)
 
     smsdb_atexit();
 
+    hotplug_stop(state->hotplug);
+    state->hotplug = NULL;
     dev_manager_stop(state);
     devices_destroy(state);
 
     eventfd_close(&state->dev_manager_event);
     AST_RWLIST_HEAD_DESTROY(&state->devices);
+    dev_index_destroy(&state->index);
 
     ast_threadpool_shutdown(gpublic->threadpool);
 }
@@ -1558,12 +2236,19 @@ static int unload_module()
 
 void pvt_reload(restate_time_t when)
 {
-    unsigned dev_reload = 0;
+    struct reload_stat* const stat = &gpublic->reload_stat;
+    unsigned dev_reload            = 0;
+
+    const int restarts = __atomic_load_n(&stat->restarts, __ATOMIC_RELAXED);
+    const int hot      = __atomic_load_n(&stat->hot, __ATOMIC_RELAXED);
 
+    /* devices to restart now are posted to device manager */
     reload_config(gpublic, 1, when, &dev_reload);
-    if (dev_reload > 0) {
-        dev_manager_scan(gpublic);
-    }
+    hotplug_configure(gpublic);
+    ast_atomic_fetchadd_int(&stat->reloads, 1);
+    ast_debug(3, "Reloaded configuration, %u devices changed state\n", dev_reload);
+    ast_verb(3, "Reloaded configuration, %d devices to restart, %d devices reconfigured without restart\n",
+             __atomic_load_n(&stat->restarts, __ATOMIC_RELAXED) - restarts, __atomic_load_n(&stat->hot, __ATOMIC_RELAXED) - hot);
 }
 
 #/* */
@@ -22,14 +22,22 @@
 #include <asterisk/lock.h>
 #include <asterisk/strings.h>
 #include <asterisk/threadpool.h>
+#include <asterisk/vector.h>
 
 #include "at_command.h"
+#include "at_latency.h" /* struct at_latency_window */
+#include "at_trace.h"   /* struct at_trace */
 #include "cpvt.h"      /* struct cpvt */
 #include "dc_config.h" /* pvt_config_t */
+#include "dev_index.h" /* struct dev_index */
 #include "mixbuffer.h" /* struct mixbuffer */
 #include "pcm.h"
+#include "rcu.h"        /* struct rcu */
+#include "ringbuffer.h" /* struct ringbuffer */
+#include "sms_submit.h" /* struct sms_queue */
 
 #define MAX_BUFFER_SIZE 100
+#define DATA_WRITE_BUFFER_SIZE 4096
 #define MODULE_DESCRIPTION "Channel Driver for Mobile Telephony"
 #define MAXQUECTELDEVICES 128
 
@@ -63,6 +71,11 @@ typedef struct pvt_stat {
     uint32_t d_read_bytes;  /*!< number of bytes of commands actually read from device */
     uint32_t d_write_bytes; /*!< number of bytes of commands actually written to device */
 
+    uint32_t d_write_short;    /*!< number of writes to device accepted partially */
+    uint32_t d_write_eagain;   /*!< number of writes to device refused with EAGAIN */
+    uint32_t d_write_overflow; /*!< number of commands not fitting in command write buffer */
+    uint32_t d_write_max;      /*!< maximal number of bytes waiting in command write buffer */
+
     uint64_t a_read_bytes;  /*!< number of bytes of audio read from device */
     uint64_t a_write_bytes; /*!< number of bytes of audio written to device */
 
@@ -84,17 +97,56 @@ typedef struct pvt_stat {
 
     uint32_t calls_answered[2]; /*!< number of outgoing and incoming/waiting calls answered */
     uint32_t calls_duration[2]; /*!< seconds of outgoing and incoming/waiting calls */
+
+    uint32_t at_class_tasks[ATQ_CLASSES];    /*!< number of tasks taken from queue by priority class */
+    uint64_t at_class_wait[ATQ_CLASSES];     /*!< milliseconds tasks waited in queue by priority class, summary */
+    uint32_t at_class_wait_max[ATQ_CLASSES]; /*!< milliseconds tasks waited in queue by priority class, maximum */
+    uint32_t at_class_starved;               /*!< number of tasks taken before more urgent ones to avoid starvation */
+    uint32_t at_pipeline_lines;              /*!< number of command lines with pipelined queries written */
+    uint32_t at_pipeline_cmds;               /*!< number of queries sent in pipelined command lines */
+    uint32_t at_task_allocs;                 /*!< number of tasks allocated from heap */
+    uint32_t at_task_reused;                 /*!< number of tasks taken from pool */
+    uint32_t at_cmd_allocs;                  /*!< number of queued commands with data allocated from heap */
+    uint32_t at_cmd_inline;                  /*!< number of queued commands with data stored inline */
+    uint32_t at_cmd_static;                  /*!< number of queued commands with constant or pre-rendered data */
+    uint32_t at_dedup_suppressed;            /*!< number of queries not queued because the same query was pending */
+    uint32_t at_cmd_timeouts;                /*!< number of commands not answered in time */
+
+    uint32_t sms_submitted; /*!< number of outgoing messages accepted by network */
+    uint32_t sms_retried;   /*!< number of outgoing messages queued again after temporary failure */
+    uint32_t sms_failed;    /*!< number of outgoing messages dropped after failure */
+    uint32_t sms_rejected;  /*!< number of outgoing messages rejected because queue was full */
+    uint32_t sms_queue_max; /*!< maximal number of outgoing messages in queue */
+
+    uint32_t dtmf_digits;      /*!< number of detected DTMF digits queued to channel */
+    uint64_t dtmf_latency_sum; /*!< microseconds between reading DTMF URC and queueing frame, summary */
+    uint32_t dtmf_latency_max; /*!< microseconds between reading DTMF URC and queueing frame, maximum */
+
+    uint32_t rate_limited[RATE_LIMITS]; /*!< number of calls, messages and USSD requests refused by rate limit */
 } pvt_stat_t;
 
 #define PVT_STAT_T(stat, name) ((stat)->name)
 
 struct at_queue_task;
 
+/* identity of module from last initialization, kept over reconnects, valid if imei is not empty */
+struct pvt_identity {
+    char imei[32];         /*!< key, confirmed by AT+CGSN on reconnect */
+    char manufacturer[64]; /*!< selects vendor specific initialization */
+    char model[64];
+    char firmware[64];
+};
+
 typedef struct pvt {
     AST_LIST_ENTRY(pvt) entry; /*!< linked list pointers */
 
     ast_mutex_t lock;                               /*!< pvt lock */
-    AST_LIST_HEAD_NOLOCK(, at_queue_task) at_queue; /*!< queue for commands to modem */
+    struct at_queue_task* at_task;                                /*!< task being sent to modem */
+    AST_LIST_HEAD_NOLOCK(, at_queue_task) at_queue[ATQ_CLASSES]; /*!< queues for commands to modem by priority class */
+    AST_LIST_HEAD_NOLOCK(, at_queue_task) at_task_pool;          /*!< free tasks for reuse */
+    struct at_latency at_latency[AT_CMDS_NUMBER];                 /*!< latency histograms by command, kept over reconnects */
+    struct at_latency_window at_recent[AT_CMDS_NUMBER];           /*!< latest latency by command, kept over reconnects */
+    unsigned at_task_pool_size;                                   /*!< number of free tasks in pool */
 
     AST_LIST_HEAD_NOLOCK(, cpvt) chans; /*!< list of channels */
     struct cpvt sys_chan;               /*!< system channel */
@@ -107,7 +159,11 @@ typedef struct pvt {
     snd_pcm_t* ocard;
     unsigned int ocard_channels;
 
-    int data_fd; /*!< data descriptor */
+    int data_fd;                              /*!< data descriptor */
+    int d_write_event;                        /*!< eventfd signalled when commands are buffered for monitor thread */
+    int d_read_pending;                       /*!< responses pushed to taskprocessor and not handled yet, atomic */
+    struct ringbuffer d_write_rb;             /*!< commands not accepted by device yet */
+    char d_write_buf[DATA_WRITE_BUFFER_SIZE]; /*!< storage of d_write_rb */
 
     struct ast_timer* a_timer;   /*!< audio write timer */
     void* silence_buf;           //[FRAME_SIZE_PLAYBACK * 2];
@@ -125,6 +181,9 @@ typedef struct pvt {
     /* SMS support */
     int incoming_sms_index;
     int incoming_sms_type;
+    struct ast_vector_int sms_delete_pending; /*!< indexes listed by +CMGL waiting for batched delete */
+    struct sms_queue sms_queue;               /*!< outgoing messages waiting for submission */
+    int cms_error;                            /*!< code of last +CMS ERROR, -1 if not known */
 
     struct ast_tm module_time;
 
@@ -165,13 +224,11 @@ typedef struct pvt {
     unsigned int is_simcom       :1; /*!< device is a simcom module */
     unsigned int has_call_waiting:1; /*!< call waiting enabled on device */
 
-    unsigned int group_last_used:1; /*!< mark the last used device */
-    unsigned int prov_last_used :1; /*!< mark the last used device */
-    unsigned int sim_last_used  :1; /*!< mark the last used device */
-
     unsigned int terminate_monitor    :1; /*!< non-zero if we want terminate monitor thread i.e. restart, stop, remove */
     unsigned int has_subscriber_number:1; /*!< subscriber_number field is valid */
     unsigned int must_remove          :1; /*!< mean must removed from list: NOT FULLY THREADSAFE */
+    unsigned int identity_cached      :1; /*!< identity queries skipped on connect, cached identity used */
+    unsigned int start_failed         :1; /*!< monitor stopped before device was initialized, next start is delayed */
 
     volatile dev_state_t desired_state;   /*!< desired state */
     volatile restate_time_t restart_time; /*!< time when change state */
@@ -181,6 +238,22 @@ typedef struct pvt {
     pvt_state_t state;     /*!< state */
     pvt_stat_t stat;       /*!< various statistics */
 
+    struct at_trace* trace;    /*!< wire-level AT trace, allocated on first enable, published atomically, freed with pvt */
+    struct at_batch* at_batch; /*!< batch of user commands being executed */
+    int index_slot;            /*!< slot in device index, -1 if not indexed */
+
+    struct timeval restate_requested; /*!< time when device event was posted, until state is changed */
+    struct timeval ready_requested;   /*!< time when device event was posted, until device is initialized */
+    int64_t restate_ms;               /*!< milliseconds of last start or stop of device */
+    struct timeval start_time;        /*!< time of last start by device manager */
+    struct timeval connect_time;      /*!< time when data port was opened, until device is initialized */
+    int64_t init_ms;                  /*!< milliseconds from opening of data port to initialized device, last */
+    struct pvt_identity identity;     /*!< identity of module, kept over reconnects */
+    char data_node[DEVPATHLEN];       /*!< device node of data_tty resolved on start, for hotplug removal */
+    char audio_node[DEVPATHLEN];      /*!< device node of audio_tty resolved on start, for hotplug removal */
+
+    struct rate_limit limits[RATE_LIMITS]; /*!< token buckets of calls, messages and USSD requests, kept over restarts */
+
     struct ast_str empty_str; /*!< empty string */
 } pvt_t;
 
@@ -191,15 +264,66 @@ typedef struct pvt {
 #define CONF_UNIQ(pvt, name) UCONFIG(&((pvt)->settings), name)
 #define PVT_ID(pvt) UCONFIG(&((pvt)->settings), id)
 
+#define DEVICES_RDLOCK(state) rcu_read_lock(&(state)->devices_rcu)
+#define DEVICES_UNLOCK(state, token) rcu_read_unlock(&(state)->devices_rcu, (token))
+#define DEVICES_TRAVERSE(state, var) \
+    for ((var) = __atomic_load_n(&(state)->devices.first, __ATOMIC_ACQUIRE); (var); (var) = __atomic_load_n(&(var)->entry.next, __ATOMIC_ACQUIRE))
+
 #define PVT_STATE(pvt, name) PVT_STATE_T(&(pvt)->state, name)
 #define PVT_STAT(pvt, name) PVT_STAT_T(&(pvt)->stat, name)
 
+/* device manager statistics, fields are accessed atomically */
+struct dev_manager_stat {
+    int events;              /*!< number of device events posted */
+    int scans;               /*!< number of scans of all devices */
+    int handled;             /*!< number of devices handled on events */
+    int restates;            /*!< number of state changes */
+    uint64_t restate_ms;     /*!< milliseconds from event to state change, summary */
+    uint64_t restate_ms_max; /*!< milliseconds from event to state change, maximum */
+    int ready;               /*!< number of devices initialized after event */
+    uint64_t ready_ms;       /*!< milliseconds from event to initialized device, summary */
+    uint64_t ready_ms_max;   /*!< milliseconds from event to initialized device, maximum */
+    uint64_t device_ms_max;  /*!< milliseconds of start or stop of single device, maximum */
+    int hotplug;             /*!< number of ports of devices appeared or disappeared */
+    int batches;             /*!< number of batches of devices started or stopped concurrently */
+    int batch_devices;       /*!< number of devices in last batch */
+    int batch_workers;       /*!< number of workers of last batch */
+    int64_t batch_ms;        /*!< milliseconds of last batch */
+    uint64_t batch_ms_max;   /*!< milliseconds of batch, maximum */
+    int inits;               /*!< number of devices initialized with identity queries */
+    uint64_t init_ms;        /*!< milliseconds from opening of data port to initialized device, summary */
+    uint64_t init_ms_max;    /*!< milliseconds from opening of data port to initialized device, maximum */
+    int inits_cached;        /*!< number of devices initialized with cached identity */
+    uint64_t cached_ms;      /*!< milliseconds to initialized device with cached identity, summary */
+    uint64_t cached_ms_max;  /*!< milliseconds to initialized device with cached identity, maximum */
+    int identity_misses;     /*!< number of connects with cached identity of another module */
+    int delayed;             /*!< number of starts delayed after failed initialization */
+};
+
+/* reload statistics, fields are accessed atomically */
+struct reload_stat {
+    int reloads;  /*!< number of configuration reloads */
+    int restarts; /*!< number of devices restarted because of changed settings */
+    int hot;      /*!< number of devices reconfigured without restart, avoided restarts */
+};
+
+/*
+    Device list is read in RCU read-side sections without any lock,
+    rwlock of list is write locked by reload and removal only.
+    Removed devices are freed after grace period.
+*/
 typedef struct public_state {
     AST_RWLIST_HEAD(devices, pvt) devices;
+    struct rcu devices_rcu; /*!< readers of device list */
     struct ast_threadpool* threadpool;
     pthread_t dev_manager_thread;
     int dev_manager_event;
     struct dc_gconfig global_settings;
+    struct dev_index index;  /*!< devices by identity */
+    int dev_manager_exit;    /*!< device manager thread should exit */
+    struct hotplug* hotplug; /*!< listener of uevents of serial ports, NULL if disabled */
+    struct dev_manager_stat dev_manager_stat;
+    struct reload_stat reload_stat;
 } public_state_t;
 
 extern public_state_t* gpublic;
@@ -225,13 +349,61 @@ const struct ast_format* pvt_get_audio_format(const struct pvt* const);
 size_t pvt_get_audio_frame_size(unsigned int, const struct ast_format* const);
 void* pvt_get_silence_buffer(struct pvt* const);
 
-/* direct device write, dangerouse */
+/*!
+ * \brief Write command to device
+ *
+ * Part not accepted by device is kept in write buffer and written by monitor thread
+ * when device becomes writable, commands written later are queued behind it.
+ * \return 0 on success, non-zero on device error or write buffer overflow
+ */
 int pvt_direct_write(struct pvt* pvt, const char* buf, size_t count);
 
+/*!
+ * \brief Write buffered commands to device
+ * \return number of bytes still buffered, -1 on device error
+ */
+ssize_t pvt_direct_flush(struct pvt* pvt);
+
 static inline int pvt_direct_write_str(struct pvt* pvt, struct ast_str* str) { return pvt_direct_write(pvt, ast_str_buffer(str), ast_str_strlen(str)); }
 
 void pvt_disconnect(struct pvt* pvt);
 
+/*! \brief Update device index after identity or configuration change, pvt must be locked */
+void pvt_update_index(struct pvt* pvt);
+
+/*!
+ * \brief Confirm cached identity by IMEI and restore it, pvt must be locked
+ * \return 0 if restored, -1 if module was changed and cache is dropped
+ */
+int pvt_identity_restore(struct pvt* pvt);
+
+/*! \brief Post event of device to device manager, pvt must be locked */
+void pvt_post_event(struct pvt* pvt);
+
+/*!
+ * \brief Pass synthetic uevents from file to devices
+ * \return number of uevents of serial ports, -1 if file can't be read
+ */
+int pvt_hotplug_replay(const char* path);
+
+/*! \brief Mark device initialized and account time of initialization, pvt must be locked */
+void pvt_initialized(struct pvt* pvt);
+
+/*! \brief Publish readiness of device for lock-free selection, pvt must be locked */
+void pvt_publish_ready(struct pvt* pvt);
+
+/*!
+ * \brief Take token of rate limit of device, pvt must be locked
+ * \return 0 if request is admitted, -1 and chan_quectel_err is set otherwise
+ */
+int pvt_rate_limit_take(struct pvt* pvt, rate_limit_t limit);
+
+/*! \brief Return token of rate limit of device taken for request which was not sent, pvt must be locked */
+void pvt_rate_limit_give(struct pvt* pvt, rate_limit_t limit);
+
+/*! \brief Check if request would be admitted by rate limit of device, pvt must be locked */
+int pvt_rate_limit_check(const struct pvt* pvt, rate_limit_t limit);
+
 struct pvt* pvt_find_ex(struct public_state* state, const char* name);
 
 static inline struct pvt* pvt_find(const char* name) { return pvt_find_ex(gpublic, name); }
@@ -266,9 +266,15 @@ static int channel_call(struct ast_channel* channel, const char* dest, attribute
         clir = -1;
     }
 
+    if (pvt_rate_limit_take(pvt, RATE_LIMIT_CALL)) {
+        ast_log(LOG_WARNING, "[%s] Call to %s refused, rate limit of calls exceeded\n", PVT_ID(pvt), dest_num);
+        return -1;
+    }
+
     PVT_STAT(pvt, out_calls)++;
     if (at_enqueue_dial(cpvt, dest_num, clir)) {
         ast_log(LOG_ERROR, "[%s] Error sending ATD command\n", PVT_ID(pvt));
+        pvt_rate_limit_give(pvt, RATE_LIMIT_CALL);
         return -1;
     }
 
@@ -16,11 +16,13 @@
 
 #include <asterisk.h>
 
+#include <asterisk/astobj2.h>  /* ao2_cleanup() */
 #include <asterisk/callerid.h> /* ast_describe_caller_presentation() */
 #include <asterisk/cli.h>      /* struct ast_cli_entry; struct ast_cli_args */
 
 #include "cli.h"
 
+#include "at_batch.h"     /* at_batch_wait() at_batch_json() */
 #include "chan_quectel.h" /* devices */
 #include "error.h"
 #include "helpers.h" /* ARRAY_LEN() send_ccwa_set() send_reset() send_sms() send_ussd() */
@@ -56,15 +58,15 @@ static char* complete_device(const char* word, int state)
     int which   = 0;
     int wordlen = strlen(word);
 
-    AST_RWLIST_RDLOCK(&gpublic->devices);
-    AST_RWLIST_TRAVERSE(&gpublic->devices, pvt, entry) {
+    const unsigned int devices_rcu = DEVICES_RDLOCK(gpublic);
+    DEVICES_TRAVERSE(gpublic, pvt) {
         SCOPED_MUTEX(pvt_lock, &pvt->lock);
         if (!strncasecmp(PVT_ID(pvt), word, wordlen) && ++which > state) {
             res = ast_strdup(PVT_ID(pvt));
             break;
         }
     }
-    AST_RWLIST_UNLOCK(&gpublic->devices);
+    DEVICES_UNLOCK(gpublic, devices_rcu);
 
     return res;
 }
@@ -87,13 +89,13 @@ static char* cli_show_devices(struct ast_cli_entry* e, int cmd, struct ast_cli_a
 
     ast_cli(a->fd, FORMAT1, "ID", "Group", "State", "RSSI", "Mode", "Provider Name", "Model", "Firmware", "Number");
 
-    AST_RWLIST_RDLOCK(&gpublic->devices);
-    AST_RWLIST_TRAVERSE(&gpublic->devices, pvt, entry) {
+    const unsigned int devices_rcu = DEVICES_RDLOCK(gpublic);
+    DEVICES_TRAVERSE(gpublic, pvt) {
         SCOPED_MUTEX(pvt_lock, &pvt->lock);
         ast_cli(a->fd, FORMAT2, PVT_ID(pvt), CONF_SHARED(pvt, group), pvt_str_state(pvt), pvt->rssi, pvt->act, pvt->provider_name, pvt->model, pvt->firmware,
                 pvt->imei, pvt->imsi, pvt->subscriber_number);
     }
-    AST_RWLIST_UNLOCK(&gpublic->devices);
+    DEVICES_UNLOCK(gpublic, devices_rcu);
 
     return CLI_SUCCESS;
 }
@@ -119,6 +121,7 @@ static char* cli_show_device_settings(struct ast_cli_entry* e, int cmd, struct a
     if (pvt) {
         const struct ast_format* const fmt = pvt_get_audio_format(pvt);
         const char* const codec_name       = ast_format_get_name(fmt);
+        char limit_buf[24];
 
         ast_cli(a->fd, "------------- Settings ------------\n");
         ast_cli(a->fd, "  Device                  : %s\n", PVT_ID(pvt));
@@ -133,6 +136,7 @@ static char* cli_show_device_settings(struct ast_cli_entry* e, int cmd, struct a
         ast_cli(a->fd, "  Context                 : %s\n", CONF_SHARED(pvt, context));
         ast_cli(a->fd, "  Exten                   : %s\n", CONF_SHARED(pvt, exten));
         ast_cli(a->fd, "  Group                   : %d\n", CONF_SHARED(pvt, group));
+        ast_cli(a->fd, "  Weight                  : %d\n", CONF_SHARED(pvt, weight));
         ast_cli(a->fd, "  Used Notifications      : %s\n", S_COR(CONF_SHARED(pvt, dsci), "DSCI", "CCINFO"));
         ast_cli(a->fd, "  16kHz audio             : %s\n", AST_CLI_YESNO(CONF_UNIQ(pvt, slin16)));
         ast_cli(a->fd, "  RX gain                 : %d\n", CONF_SHARED(pvt, rxgain));
@@ -144,6 +148,13 @@ static char* cli_show_device_settings(struct ast_cli_entry* e, int cmd, struct a
         ast_cli(a->fd, "  Message Storage         : %s\n", dc_msgstor2str(CONF_SHARED(pvt, msg_storage)));
         ast_cli(a->fd, "  Direct Message          : %s\n", dc_3stbool2str_capitalized(CONF_SHARED(pvt, msg_direct)));
         ast_cli(a->fd, "  Auto Delete SMS         : %s\n", AST_CLI_YESNO(CONF_SHARED(pvt, sms_autodelete)));
+        ast_cli(a->fd, "  Delete SMS Batch        : %d\n", CONF_SHARED(pvt, msg_delete_batch));
+        ast_cli(a->fd, "  SMS Queue Size          : %d\n", CONF_SHARED(pvt, msg_queue_size));
+        ast_cli(a->fd, "  SMS Retries             : %d\n", CONF_SHARED(pvt, msg_retries));
+        ast_cli(a->fd, "  Keep SMS Link Open      : %s\n", AST_CLI_YESNO(CONF_SHARED(pvt, msg_cmms)));
+        ast_cli(a->fd, "  Call Limit              : %s\n", rate_limit_conf2str(&CONF_SHARED(pvt, limits[RATE_LIMIT_CALL]), limit_buf, sizeof(limit_buf)));
+        ast_cli(a->fd, "  SMS Limit               : %s\n", rate_limit_conf2str(&CONF_SHARED(pvt, limits[RATE_LIMIT_SMS]), limit_buf, sizeof(limit_buf)));
+        ast_cli(a->fd, "  USSD Limit              : %s\n", rate_limit_conf2str(&CONF_SHARED(pvt, limits[RATE_LIMIT_USSD]), limit_buf, sizeof(limit_buf)));
         ast_cli(a->fd, "  Reset Modem             : %s\n", AST_CLI_YESNO(CONF_SHARED(pvt, reset_modem)));
         ast_cli(a->fd, "  Call Waiting            : %s\n", dc_cw_setting2str(CONF_SHARED(pvt, call_waiting)));
         ast_cli(a->fd, "  Multiparty Calls        : %s\n", AST_CLI_YESNO(CONF_SHARED(pvt, multiparty)));
@@ -152,7 +163,9 @@ static char* cli_show_device_settings(struct ast_cli_entry* e, int cmd, struct a
         ast_cli(a->fd, "  Hold/Unhold Action      : %s\n", S_COR(CONF_SHARED(pvt, dtmf), "MOH", "Mute"));
         ast_cli(a->fd, "  Query Time              : %s\n", AST_CLI_YESNO(CONF_SHARED(pvt, query_time)));
         ast_cli(a->fd, "  Initial Device State    : %s\n", dev_state2str_capitalized(CONF_SHARED(pvt, init_state)));
-        ast_cli(a->fd, "  Use QHUP Command        : %s\n\n", AST_CLI_YESNO(CONF_SHARED(pvt, qhup)));
+        ast_cli(a->fd, "  Use QHUP Command        : %s\n", AST_CLI_YESNO(CONF_SHARED(pvt, qhup)));
+        ast_cli(a->fd, "  Pipeline AT Queries     : %s\n", AST_CLI_YESNO(CONF_SHARED(pvt, at_pipeline)));
+        ast_cli(a->fd, "  Adaptive Timeouts       : %s\n\n", AST_CLI_YESNO(CONF_SHARED(pvt, adaptive_timeout)));
     } else {
         ast_cli(a->fd, "Device %s not found\n", a->argv[4]);
     }
@@ -218,10 +231,16 @@ static char* cli_show_device_state(struct ast_cli_entry* e, int cmd, struct ast_
         }
         ast_cli(a->fd, "  Tasks in queue          : %u\n", PVT_STATE(pvt, at_tasks));
         ast_cli(a->fd, "  Commands in queue       : %u\n", PVT_STATE(pvt, at_cmds));
+        if (pvt->trace) {
+            ast_cli(a->fd, "  AT trace                : %s, %u records, %u dropped\n", AST_CLI_ONOFF(pvt->trace->enabled), pvt->trace->records,
+                    pvt->trace->dropped);
+        }
         ast_cli(a->fd, "  Call Waiting            : %s\n", AST_CLI_ONOFF(pvt->has_call_waiting));
         ast_cli(a->fd, "  Current device state    : %s\n", dev_state2str_capitalized(pvt->current_state));
         ast_cli(a->fd, "  Desired device state    : %s\n", dev_state2str_capitalized(pvt->desired_state));
         ast_cli(a->fd, "  When change state       : %s\n", restate2str_msg(pvt->restart_time));
+        ast_cli(a->fd, "  Last state change       : %lld ms\n", (long long int)pvt->restate_ms);
+        ast_cli(a->fd, "  Last initialization     : %lld ms%s\n", (long long int)pvt->init_ms, pvt->identity_cached ? ", cached identity" : "");
 
         ast_cli(a->fd, "  Calls/Channels          : %u\n", PVT_STATE(pvt, chansno));
         ast_cli(a->fd, "    Active                : %u\n", PVT_STATE(pvt, chan_count[CALL_STATE_ACTIVE]));
@@ -296,6 +315,10 @@ static char* cli_show_device_statistics(struct ast_cli_entry* e, int cmd, struct
         ast_cli(a->fd, "  Responses                   : %u\n", PVT_STAT(pvt, at_responses));
         ast_cli(a->fd, "  Bytes of read responses     : %u\n", PVT_STAT(pvt, d_read_bytes));
         ast_cli(a->fd, "  Bytes of written commands   : %u\n", PVT_STAT(pvt, d_write_bytes));
+        ast_cli(a->fd, "  Short command writes        : %u\n", PVT_STAT(pvt, d_write_short));
+        ast_cli(a->fd, "  Command writes with EAGAIN  : %u\n", PVT_STAT(pvt, d_write_eagain));
+        ast_cli(a->fd, "  Command buffer overflows    : %u\n", PVT_STAT(pvt, d_write_overflow));
+        ast_cli(a->fd, "  Command buffer peak bytes   : %u\n", PVT_STAT(pvt, d_write_max));
         ast_cli(a->fd, "  Bytes of read audio         : %llu\n", (unsigned long long int)PVT_STAT(pvt, a_read_bytes));
         ast_cli(a->fd, "  Bytes of written audio      : %llu\n", (unsigned long long int)PVT_STAT(pvt, a_write_bytes));
         ast_cli(a->fd, "  Readed frames               : %u\n", PVT_STAT(pvt, read_frames));
@@ -318,6 +341,34 @@ static char* cli_show_device_statistics(struct ast_cli_entry* e, int cmd, struct
                 getACD(PVT_STAT(pvt, calls_answered[CALL_DIR_INCOMING]), PVT_STAT(pvt, calls_duration[CALL_DIR_INCOMING])));
         ast_cli(a->fd, "  ACD for outgoing calls      : %d\n",
                 getACD(PVT_STAT(pvt, calls_answered[CALL_DIR_OUTGOING]), PVT_STAT(pvt, calls_duration[CALL_DIR_OUTGOING])));
+        for (unsigned i = 0; i < ATQ_CLASSES; ++i) {
+            const uint32_t tasks = PVT_STAT(pvt, at_class_tasks[i]);
+            ast_cli(a->fd, "  Queue %-12s wait     : %u tasks, avg %llu ms, max %u ms\n", at_queue_class2str(i), tasks,
+                    tasks ? (unsigned long long int)(PVT_STAT(pvt, at_class_wait[i]) / tasks) : 0ull, PVT_STAT(pvt, at_class_wait_max[i]));
+        }
+        ast_cli(a->fd, "  Queue starvation overrides  : %u\n", PVT_STAT(pvt, at_class_starved));
+        ast_cli(a->fd, "  Pipelined command lines     : %u\n", PVT_STAT(pvt, at_pipeline_lines));
+        ast_cli(a->fd, "  Pipelined commands          : %u\n", PVT_STAT(pvt, at_pipeline_cmds));
+        ast_cli(a->fd, "  Queue tasks allocated       : %u\n", PVT_STAT(pvt, at_task_allocs));
+        ast_cli(a->fd, "  Queue tasks reused          : %u\n", PVT_STAT(pvt, at_task_reused));
+        ast_cli(a->fd, "  Queue commands allocated    : %u\n", PVT_STAT(pvt, at_cmd_allocs));
+        ast_cli(a->fd, "  Queue commands inline       : %u\n", PVT_STAT(pvt, at_cmd_inline));
+        ast_cli(a->fd, "  Queue commands static       : %u\n", PVT_STAT(pvt, at_cmd_static));
+        ast_cli(a->fd, "  Suppressed duplicate queries: %u\n", PVT_STAT(pvt, at_dedup_suppressed));
+        ast_cli(a->fd, "  Command timeouts            : %u\n", PVT_STAT(pvt, at_cmd_timeouts));
+        ast_cli(a->fd, "  SMS submitted               : %u\n", PVT_STAT(pvt, sms_submitted));
+        ast_cli(a->fd, "  SMS submission retries      : %u\n", PVT_STAT(pvt, sms_retried));
+        ast_cli(a->fd, "  SMS submission failures     : %u\n", PVT_STAT(pvt, sms_failed));
+        ast_cli(a->fd, "  SMS rejected, queue full    : %u\n", PVT_STAT(pvt, sms_rejected));
+        ast_cli(a->fd, "  SMS queue length            : %u\n", pvt->sms_queue.count);
+        ast_cli(a->fd, "  SMS queue maximal length    : %u\n", PVT_STAT(pvt, sms_queue_max));
+        ast_cli(a->fd, "  Detected DTMF digits        : %u\n", PVT_STAT(pvt, dtmf_digits));
+        ast_cli(a->fd, "  DTMF average latency [us]   : %llu\n",
+                PVT_STAT(pvt, dtmf_digits) ? (unsigned long long int)(PVT_STAT(pvt, dtmf_latency_sum) / PVT_STAT(pvt, dtmf_digits)) : 0ull);
+        ast_cli(a->fd, "  DTMF maximal latency [us]   : %u\n", PVT_STAT(pvt, dtmf_latency_max));
+        ast_cli(a->fd, "  Calls refused, rate limit   : %u\n", PVT_STAT(pvt, rate_limited[RATE_LIMIT_CALL]));
+        ast_cli(a->fd, "  SMS refused, rate limit     : %u\n", PVT_STAT(pvt, rate_limited[RATE_LIMIT_SMS]));
+        ast_cli(a->fd, "  USSD refused, rate limit    : %u\n", PVT_STAT(pvt, rate_limited[RATE_LIMIT_USSD]));
         /*
                 ast_cli (a->fd, "  ACD                         : %d\n",
                     getACD(
@@ -353,6 +404,92 @@ static char* cli_show_device_statistics(struct ast_cli_entry* e, int cmd, struct
 
 CLI_ALIASES(cli_show_device_statistics, "show device statistics", "show device statistics <device>", "Shows the statistics of device")
 
+static struct ast_json* latency2json(const struct at_latency* lat)
+{
+    struct ast_json* const obj     = ast_json_object_create();
+    struct ast_json* const buckets = ast_json_array_create();
+
+    ast_json_object_set(obj, "count", ast_json_integer_create(lat->count));
+    ast_json_object_set(obj, "avg", ast_json_integer_create(lat->count ? (intmax_t)(lat->sum / lat->count) : 0));
+    ast_json_object_set(obj, "p50", ast_json_integer_create(at_latency_percentile(lat, 500u)));
+    ast_json_object_set(obj, "p90", ast_json_integer_create(at_latency_percentile(lat, 900u)));
+    ast_json_object_set(obj, "p99", ast_json_integer_create(at_latency_percentile(lat, 990u)));
+    ast_json_object_set(obj, "max", ast_json_integer_create(lat->max));
+
+    /* buckets as [upper bound in ms, samples], upper bound of the last one is null */
+    for (unsigned i = 0; i < AT_LATENCY_BUCKETS; ++i) {
+        if (!lat->buckets[i]) {
+            continue;
+        }
+        struct ast_json* const bucket = ast_json_array_create();
+        ast_json_array_append(bucket, i < AT_LATENCY_BUCKETS - 1u ? ast_json_integer_create(at_latency_bucket_upper(i)) : ast_json_null());
+        ast_json_array_append(bucket, ast_json_integer_create(lat->buckets[i]));
+        ast_json_array_append(buckets, bucket);
+    }
+    ast_json_object_set(obj, "buckets", buckets);
+
+    return obj;
+}
+
+static char* cli_show_device_latency(struct ast_cli_entry* e, int cmd, struct ast_cli_args* a)
+{
+    static const char* const choices[] = {"json", NULL};
+
+    switch (cmd) {
+        case CLI_GENERATE:
+            if (a->pos == 4) {
+                return complete_device(a->word, a->n);
+            }
+            if (a->pos == 5) {
+                return ast_cli_complete(a->word, (ast_cli_complete2_t)choices, a->n);
+            }
+            return NULL;
+    }
+
+    if (a->argc < 5 || a->argc > 6 || (a->argc == 6 && strcasecmp(a->argv[5], "json"))) {
+        return CLI_SHOWUSAGE;
+    }
+
+    RAII_VAR(struct pvt* const, pvt, pvt_find(a->argv[4]), pvt_unlock);
+
+    if (!pvt) {
+        ast_cli(a->fd, "Device %s not found\n", a->argv[4]);
+        return CLI_SUCCESS;
+    }
+
+    if (a->argc == 6) {
+        RAII_VAR(struct ast_json*, report, ast_json_object_create(), ast_json_unref);
+        struct ast_json* const commands = ast_json_object_create();
+
+        for (unsigned i = 0; i < AT_CMDS_NUMBER; ++i) {
+            if (pvt->at_latency[i].count) {
+                ast_json_object_set(commands, at_cmd2str((at_cmd_t)i), latency2json(&pvt->at_latency[i]));
+            }
+        }
+        ast_json_object_set(report, "device", ast_json_string_create(PVT_ID(pvt)));
+        ast_json_object_set(report, "commands", commands);
+
+        RAII_VAR(char*, str, ast_json_dump_string_format(report, AST_JSON_PRETTY), ast_json_free);
+        ast_cli(a->fd, "%s\n", S_OR(str, "{}"));
+        return CLI_SUCCESS;
+    }
+
+    ast_cli(a->fd, "------------------------ Latency [ms] -------------------------\n");
+    ast_cli(a->fd, "  %-24s %8s %6s %6s %6s %6s %6s\n", "Command", "Count", "Avg", "P50", "P90", "P99", "Max");
+    for (unsigned i = 0; i < AT_CMDS_NUMBER; ++i) {
+        const struct at_latency* const lat = &pvt->at_latency[i];
+        if (!lat->count) {
+            continue;
+        }
+        ast_cli(a->fd, "  %-24s %8u %6llu %6u %6u %6u %6u\n", at_cmd2str((at_cmd_t)i), lat->count, (unsigned long long int)(lat->sum / lat->count),
+                at_latency_percentile(lat, 500u), at_latency_percentile(lat, 900u), at_latency_percentile(lat, 990u), lat->max);
+    }
+
+    return CLI_SUCCESS;
+}
+
+CLI_ALIASES(cli_show_device_latency, "show device latency", "show device latency <device> [json]", "Shows round-trip latency of AT commands sent to device")
+
 static char* cli_show_version(struct ast_cli_entry* e, int cmd, struct ast_cli_args* a)
 {
     switch (cmd) {
@@ -374,6 +511,122 @@ static char* cli_show_version(struct ast_cli_entry* e, int cmd, struct ast_cli_a
 
 CLI_ALIASES(cli_show_version, "show version", "show version", "Shows the version of module")
 
+static char* cli_show_selection(struct ast_cli_entry* e, int cmd, struct ast_cli_args* a)
+{
+    switch (cmd) {
+        case CLI_GENERATE:
+            return NULL;
+    }
+
+    if (a->argc != 3) {
+        return CLI_SHOWUSAGE;
+    }
+
+    const struct dev_index* const idx = &gpublic->index;
+
+    ast_cli(a->fd, "-------------- Device selection --------------\n");
+    ast_cli(a->fd, "  Lookups                     : %d\n", __atomic_load_n(&idx->select_lookups, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Skipped as not ready        : %d\n", __atomic_load_n(&idx->select_skipped, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Locked for confirmation     : %d\n", __atomic_load_n(&idx->select_locked, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Locked by another thread    : %d\n", __atomic_load_n(&idx->select_contended, __ATOMIC_RELAXED));
+    for (int i = 0; i < DEV_SELECT_STRATEGIES; ++i) {
+        ast_cli(a->fd, "  Selected by %-16s: %d\n", dev_select_strategy2str((dev_select_t)i), __atomic_load_n(&idx->select_strategy[i], __ATOMIC_RELAXED));
+    }
+    ast_cli(a->fd, "\n");
+
+    return CLI_SUCCESS;
+}
+
+CLI_ALIASES(cli_show_selection, "show selection", "show selection", "Shows statistics of device selection")
+
+static char* cli_show_manager(struct ast_cli_entry* e, int cmd, struct ast_cli_args* a)
+{
+    switch (cmd) {
+        case CLI_GENERATE:
+            return NULL;
+    }
+
+    if (a->argc != 3) {
+        return CLI_SHOWUSAGE;
+    }
+
+    const struct dev_manager_stat* const stat = &gpublic->dev_manager_stat;
+
+    const int restates   = __atomic_load_n(&stat->restates, __ATOMIC_RELAXED);
+    const uint64_t rs_ms = __atomic_load_n(&stat->restate_ms, __ATOMIC_RELAXED);
+    const int ready      = __atomic_load_n(&stat->ready, __ATOMIC_RELAXED);
+    const uint64_t rd_ms = __atomic_load_n(&stat->ready_ms, __ATOMIC_RELAXED);
+    const int inits      = __atomic_load_n(&stat->inits, __ATOMIC_RELAXED);
+    const uint64_t in_ms = __atomic_load_n(&stat->init_ms, __ATOMIC_RELAXED);
+    const int cached     = __atomic_load_n(&stat->inits_cached, __ATOMIC_RELAXED);
+    const uint64_t ch_ms = __atomic_load_n(&stat->cached_ms, __ATOMIC_RELAXED);
+
+    ast_cli(a->fd, "-------------- Device manager --------------\n");
+    ast_cli(a->fd, "  Events posted               : %d\n", __atomic_load_n(&stat->events, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Devices handled on events   : %d\n", __atomic_load_n(&stat->handled, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Scans of all devices        : %d\n", __atomic_load_n(&stat->scans, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  State changes               : %d\n", restates);
+    ast_cli(a->fd, "  Event to state change avg   : %llu ms\n", (unsigned long long int)(restates ? rs_ms / (uint64_t)restates : 0u));
+    ast_cli(a->fd, "  Event to state change max   : %llu ms\n", (unsigned long long int)__atomic_load_n(&stat->restate_ms_max, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Devices ready               : %d\n", ready);
+    ast_cli(a->fd, "  Event to ready avg          : %llu ms\n", (unsigned long long int)(ready ? rd_ms / (uint64_t)ready : 0u));
+    ast_cli(a->fd, "  Event to ready max          : %llu ms\n", (unsigned long long int)__atomic_load_n(&stat->ready_ms_max, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Full initializations        : %d\n", inits);
+    ast_cli(a->fd, "  Connect to ready avg        : %llu ms\n", (unsigned long long int)(inits ? in_ms / (uint64_t)inits : 0u));
+    ast_cli(a->fd, "  Connect to ready max        : %llu ms\n", (unsigned long long int)__atomic_load_n(&stat->init_ms_max, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Cached identity inits       : %d\n", cached);
+    ast_cli(a->fd, "  Cached connect to ready avg : %llu ms\n", (unsigned long long int)(cached ? ch_ms / (uint64_t)cached : 0u));
+    ast_cli(a->fd, "  Cached connect to ready max : %llu ms\n", (unsigned long long int)__atomic_load_n(&stat->cached_ms_max, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Cached identity mismatches  : %d\n", __atomic_load_n(&stat->identity_misses, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Starts delayed after fail   : %d\n", __atomic_load_n(&stat->delayed, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Device start/stop max       : %llu ms\n", (unsigned long long int)__atomic_load_n(&stat->device_ms_max, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Workers                     : %d\n", SCONF_GLOBAL(gpublic, manager_workers));
+    ast_cli(a->fd, "  Batches                     : %d\n", __atomic_load_n(&stat->batches, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Last batch                  : %d devices, %d workers, %lld ms\n", __atomic_load_n(&stat->batch_devices, __ATOMIC_RELAXED),
+            __atomic_load_n(&stat->batch_workers, __ATOMIC_RELAXED), (long long int)__atomic_load_n(&stat->batch_ms, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Batch max                   : %llu ms\n", (unsigned long long int)__atomic_load_n(&stat->batch_ms_max, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Reloads                     : %d\n", __atomic_load_n(&gpublic->reload_stat.reloads, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Restarts on reload          : %d\n", __atomic_load_n(&gpublic->reload_stat.restarts, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Restarts avoided on reload  : %d\n", __atomic_load_n(&gpublic->reload_stat.hot, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Device list sections        : %d\n", rcu_sections(&gpublic->devices_rcu));
+    ast_cli(a->fd, "  Device list readers now     : %d\n", rcu_readers(&gpublic->devices_rcu));
+    ast_cli(a->fd, "  Grace periods               : %d\n", __atomic_load_n(&gpublic->devices_rcu.grace_periods, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Grace period max            : %llu ms\n", (unsigned long long int)__atomic_load_n(&gpublic->devices_rcu.grace_ms_max, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Hotplug                     : %s\n", hotplug_mode2str(SCONF_GLOBAL(gpublic, hotplug)));
+    ast_cli(a->fd, "  Uevents received            : %d\n", __atomic_load_n(&hotplug_stat.received, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Uevents rejected            : %d\n", __atomic_load_n(&hotplug_stat.rejected, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Uevents of serial ports     : %d\n", __atomic_load_n(&hotplug_stat.handled, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "  Ports of devices changed    : %d\n", __atomic_load_n(&stat->hotplug, __ATOMIC_RELAXED));
+    ast_cli(a->fd, "\n");
+
+    return CLI_SUCCESS;
+}
+
+CLI_ALIASES(cli_show_manager, "show manager", "show manager", "Shows statistics of device manager")
+
+static char* cli_hotplug_replay(struct ast_cli_entry* e, int cmd, struct ast_cli_args* a)
+{
+    switch (cmd) {
+        case CLI_GENERATE:
+            return NULL;
+    }
+
+    if (a->argc != 4) {
+        return CLI_SHOWUSAGE;
+    }
+
+    const int res = pvt_hotplug_replay(a->argv[3]);
+    if (res < 0) {
+        ast_cli(a->fd, "Unable to read uevents from %s: %s\n", a->argv[3], strerror(errno));
+    } else {
+        ast_cli(a->fd, "%d uevents of serial ports replayed from %s\n", res, a->argv[3]);
+    }
+
+    return CLI_SUCCESS;
+}
+
+CLI_ALIASES(cli_hotplug_replay, "hotplug replay", "hotplug replay <file>", "Pass synthetic uevents from <file> to devices as if they were received from kernel")
+
 static char* cli_cmd(struct ast_cli_entry* e, int cmd, struct ast_cli_args* a)
 {
     switch (cmd) {
@@ -396,6 +649,41 @@ static char* cli_cmd(struct ast_cli_entry* e, int cmd, struct ast_cli_args* a)
 
 CLI_ALIASES(cli_cmd, "cmd", "cmd <device> <command>", "Send <command> to the rfcomm port on the device with the specified <device>")
 
+static char* cli_cmds(struct ast_cli_entry* e, int cmd, struct ast_cli_args* a)
+{
+    switch (cmd) {
+        case CLI_GENERATE:
+            if (a->pos == 2) {
+                return complete_device(a->word, a->n);
+            }
+            return NULL;
+    }
+
+    if (a->argc < 4) {
+        return CLI_SHOWUSAGE;
+    }
+
+    const unsigned count = (unsigned)(a->argc - 3);
+
+    RAII_VAR(struct at_batch*, batch, send_at_batch(a->argv[2], a->argv + 3, count), ao2_cleanup);
+    if (!batch) {
+        ast_cli(a->fd, "[%s] %s\n", a->argv[2], error2str(chan_quectel_err));
+        return CLI_SUCCESS;
+    }
+
+    at_batch_wait(batch, (int)count * AT_BATCH_WAIT_PER_CMD);
+
+    RAII_VAR(struct ast_json*, report, at_batch_json(batch), ast_json_unref);
+    ast_json_object_set(report, "device", ast_json_string_create(a->argv[2]));
+
+    RAII_VAR(char*, str, ast_json_dump_string_format(report, AST_JSON_PRETTY), ast_json_free);
+    ast_cli(a->fd, "%s\n", S_OR(str, "{}"));
+    return CLI_SUCCESS;
+}
+
+CLI_ALIASES(cli_cmds, "cmds", "cmds <device> <command> [<command> ...]",
+            "Send <command>s to <device> back-to-back in one batch, wait for responses and show them in JSON")
+
 static char* cli_ussd(struct ast_cli_entry* e, int cmd, struct ast_cli_args* a)
 {
     switch (cmd) {
@@ -731,6 +1019,53 @@ static char* cli_reset(struct ast_cli_entry* e, int cmd, struct ast_cli_args* a)
 
 CLI_ALIASES(cli_reset, "reset", "reset <device>", "Reset <device>")
 
+static char* cli_trace(struct ast_cli_entry* e, int cmd, struct ast_cli_args* a)
+{
+    static const char* const choices[] = {"on", "off", "clear", "dump", NULL};
+
+    switch (cmd) {
+        case CLI_GENERATE:
+            if (a->pos == 2) {
+                return ast_cli_complete(a->word, (ast_cli_complete2_t)choices, a->n);
+            }
+            if (a->pos == 3) {
+                return complete_device(a->word, a->n);
+            }
+            return NULL;
+    }
+
+    if (a->argc < 4) {
+        return CLI_SHOWUSAGE;
+    }
+
+    int res;
+    if (!strcasecmp("on", a->argv[2])) {
+        if (a->argc > 5) {
+            return CLI_SHOWUSAGE;
+        }
+        const size_t size = a->argc == 5 ? strtoul(a->argv[4], NULL, 10) : AT_TRACE_DEF_SIZE;
+        res               = set_at_trace(a->argv[3], 1, size);
+    } else if (!strcasecmp("off", a->argv[2]) && a->argc == 4) {
+        res = set_at_trace(a->argv[3], 0, 0);
+    } else if (!strcasecmp("clear", a->argv[2]) && a->argc == 4) {
+        res = set_at_trace(a->argv[3], -1, 0);
+    } else if (!strcasecmp("dump", a->argv[2]) && a->argc == 5) {
+        res = dump_at_trace(a->argv[3], a->argv[4]);
+        if (res >= 0) {
+            ast_cli(a->fd, "[%s] %d records written to %s\n", a->argv[3], res, a->argv[4]);
+            return CLI_SUCCESS;
+        }
+    } else {
+        return CLI_SHOWUSAGE;
+    }
+
+    ast_cli(a->fd, "[%s] %s\n", a->argv[3], res < 0 ? error2str(chan_quectel_err) : "AT trace updated");
+
+    return CLI_SUCCESS;
+}
+
+CLI_ALIASES(cli_trace, "trace", "trace on|off|clear|dump <device> [size|file]", "Control wire-level AT trace of <device>, dump it to <file>")
+
 static const char* const a_choices[]  = {"now", "gracefully", "when", NULL};
 static const char* const a_choices2[] = {"convenient", NULL};
 
@@ -1076,8 +1411,13 @@ static struct ast_cli_entry cli[] = {
 	CLI_DEF_ENTRIES(cli_show_device_settings,	"Show device settings")
 	CLI_DEF_ENTRIES(cli_show_device_state,	 	"Show device state")
 	CLI_DEF_ENTRIES(cli_show_device_statistics,	"Show device statistics")
+	CLI_DEF_ENTRIES(cli_show_device_latency,	"Show AT command latency")
 	CLI_DEF_ENTRIES(cli_show_version,			"Show module version")
+	CLI_DEF_ENTRIES(cli_show_selection,			"Show device selection statistics")
+	CLI_DEF_ENTRIES(cli_show_manager,			"Show device manager statistics")
+	CLI_DEF_ENTRIES(cli_hotplug_replay,			"Replay uevents from file")
 	CLI_DEF_ENTRIES(cli_cmd,					"Send commands to port for debugging")
+	CLI_DEF_ENTRIES(cli_cmds,					"Send batch of commands to port")
 	CLI_DEF_ENTRIES(cli_ussd,					"Send USSD commands")
 
 	CLI_DEF_ENTRIES(cli_sms_send,					"Send message")
@@ -1094,6 +1434,7 @@ static struct ast_cli_entry cli[] = {
 
 	CLI_DEF_ENTRIES(cli_ccwa_set,				"Enable/Disable Call-Waiting")
 	CLI_DEF_ENTRIES(cli_reset,					"Reset modem")
+	CLI_DEF_ENTRIES(cli_trace,					"Control AT trace")
 
 	CLI_DEF_ENTRIES(cli_stop,					"Stop channel")
 	CLI_DEF_ENTRIES(cli_restart,				"Restart channel")
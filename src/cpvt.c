@@ -88,6 +88,7 @@ struct cpvt* cpvt_alloc(struct pvt* pvt, int call_idx, unsigned dir, call_state_
     }
     PVT_STATE(pvt, chansno)++;
     PVT_STATE(pvt, chan_count[cpvt->state])++;
+    pvt_publish_ready(pvt);
 
     ast_debug(3, "[%s] Create cpvt - idx:%d dir:%d state:%s buffer_len:%u\n", PVT_ID(pvt), call_idx, dir, call_state2str(state), (unsigned int)buffer_size);
     return cpvt;
@@ -112,7 +113,7 @@ static void relink_to_sys_chan(const struct cpvt* const cpvt, struct pvt* const
     struct at_queue_task* task;
 
     /* relink task to sys_chan */
-    AST_LIST_TRAVERSE(&pvt->at_queue, task, entry) {
+    AT_QUEUE_TRAVERSE(pvt, task) {
         if (task->cpvt == cpvt) {
             task->cpvt = &pvt->sys_chan;
         }
@@ -133,6 +134,7 @@ void cpvt_free(struct cpvt* cpvt)
 
     decrease_chan_counters(cpvt, pvt);
     relink_to_sys_chan(cpvt, pvt);
+    pvt_publish_ready(pvt);
 
     ast_free(cpvt->buffer);
 
@@ -367,6 +369,8 @@ int cpvt_change_state(struct cpvt* const cpvt, call_state_t newstate, int cause)
     } else {
         change_state_no_channel(cpvt, pvt, newstate);
     }
+
+    pvt_publish_ready(pvt);
     return 1;
 }
 
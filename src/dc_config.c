@@ -10,6 +10,7 @@
 static const char DEFAULT_ALSADEV[]       = "hw:Android";
 static const char DEFAULT_ALSADEV_EXT[]   = "hw:0";
 static const int DEFAULT_MANAGER_INTERVAL = 15;
+static const int DEFAULT_MANAGER_WORKERS  = 8;
 static const char DEFAULT_SMS_DB[]        = ":memory:";
 static const char DEFAULT_SMS_BACKUP_DB[] = "/var/lib/asterisk/smsdb-backup";
 static const int DEFAULT_SMS_TTL          = 600;
@@ -194,9 +195,12 @@ void dc_sconfig_fill_defaults(struct dc_sconfig* config)
     config->moh           = 1;
     config->rxgain        = -1;
     config->txgain        = -1;
-    config->msg_service   = -1;
-    config->dtmf_duration = DEF_DTMF_DURATION;
-    config->qhup          = 1u;
+    config->msg_service    = -1;
+    config->msg_queue_size = 16;
+    config->msg_retries    = 2;
+    config->weight         = 1;
+    config->dtmf_duration  = DEF_DTMF_DURATION;
+    config->qhup           = 1u;
 }
 
 #/* */
@@ -215,6 +219,13 @@ void dc_sconfig_fill(struct ast_config* cfg, const char* cat, struct dc_sconfig*
             ast_copy_string(config->language, v->value, sizeof(config->language)); /* set channel language */
         } else if (!strcasecmp(v->name, "group")) {
             config->group = (int)strtol(v->value, (char**)NULL, 10); /* group is set to 0 if invalid */
+        } else if (!strcasecmp(v->name, "weight")) {
+            const int val = (int)strtol(v->value, (char**)NULL, 10);
+            if (val < 1 || val > WEIGHT_MAX) {
+                ast_log(LOG_ERROR, "Invalid value for 'weight': '%s', must be between 1 and %d\n", v->value, WEIGHT_MAX);
+            } else {
+                config->weight = val;
+            }
         } else if (!strcasecmp(v->name, "rxgain")) {
             if (str2gain(v->value, &config->rxgain)) {
                 config->rxgain = -1;
@@ -269,12 +280,44 @@ void dc_sconfig_fill(struct ast_config* cfg, const char* cat, struct dc_sconfig*
             config->dsci = parse_on_off(v->name, v->value, 0u);
         } else if (!strcasecmp(v->name, "qhup")) {
             config->qhup = parse_on_off(v->name, v->value, 1u);
+        } else if (!strcasecmp(v->name, "at_pipeline")) {
+            config->at_pipeline = parse_on_off(v->name, v->value, 0u);
+        } else if (!strcasecmp(v->name, "adaptive_timeout")) {
+            config->adaptive_timeout = parse_on_off(v->name, v->value, 0u);
+        } else if (!strcasecmp(v->name, "msg_cmms")) {
+            config->msg_cmms = parse_on_off(v->name, v->value, 0u);
         } else if (!strcasecmp(v->name, "msg_direct")) {
             config->msg_direct = dc_str23stbool(v->value);
         } else if (!strcasecmp(v->name, "msg_storage")) {
             config->msg_storage = dc_str2msgstor(v->value);
         } else if (!strcasecmp(v->name, "msg_service")) {
             config->msg_service = (int)strtol(v->value, (char**)NULL, 10);
+        } else if (!strcasecmp(v->name, "msg_delete_batch")) {
+            const int val = (int)strtol(v->value, (char**)NULL, 10);
+            if (val < 0 || val > MSG_DELETE_BATCH_MAX) {
+                ast_log(LOG_ERROR, "Invalid value for 'msg_delete_batch': '%s', must be between 0 and %d\n", v->value, MSG_DELETE_BATCH_MAX);
+            } else {
+                config->msg_delete_batch = val;
+            }
+        } else if (!strcasecmp(v->name, "msg_queue_size")) {
+            const int val = (int)strtol(v->value, (char**)NULL, 10);
+            if (val < 1 || val > MSG_QUEUE_SIZE_MAX) {
+                ast_log(LOG_ERROR, "Invalid value for 'msg_queue_size': '%s', must be between 1 and %d\n", v->value, MSG_QUEUE_SIZE_MAX);
+            } else {
+                config->msg_queue_size = val;
+            }
+        } else if (!strcasecmp(v->name, "call_limit") || !strcasecmp(v->name, "sms_limit") || !strcasecmp(v->name, "ussd_limit")) {
+            const rate_limit_t limit = !strcasecmp(v->name, "call_limit") ? RATE_LIMIT_CALL : !strcasecmp(v->name, "sms_limit") ? RATE_LIMIT_SMS : RATE_LIMIT_USSD;
+            if (rate_limit_parse(v->value, &config->limits[limit])) {
+                ast_log(LOG_ERROR, "Invalid value for '%s': '%s', must be off or count/seconds\n", v->name, v->value);
+            }
+        } else if (!strcasecmp(v->name, "msg_retries")) {
+            const int val = (int)strtol(v->value, (char**)NULL, 10);
+            if (val < 0 || val > MSG_RETRIES_MAX) {
+                ast_log(LOG_ERROR, "Invalid value for 'msg_retries': '%s', must be between 0 and %d\n", v->value, MSG_RETRIES_MAX);
+            } else {
+                config->msg_retries = val;
+            }
         }
     }
 }
@@ -284,6 +327,8 @@ void dc_sconfig_fill(struct ast_config* cfg, const char* cat, struct dc_sconfig*
 void dc_gconfig_fill(struct ast_config* cfg, const char* cat, struct dc_gconfig* config)
 {
     config->manager_interval = DEFAULT_MANAGER_INTERVAL;
+    config->manager_workers  = DEFAULT_MANAGER_WORKERS;
+    config->hotplug          = HOTPLUG_OFF;
     ast_copy_string(config->sms_db, DEFAULT_SMS_DB, sizeof(config->sms_db));
     ast_copy_string(config->sms_backup_db, DEFAULT_SMS_BACKUP_DB, sizeof(config->sms_backup_db));
     config->sms_ttl = DEFAULT_SMS_TTL;
@@ -299,6 +344,28 @@ void dc_gconfig_fill(struct ast_config* cfg, const char* cat, struct dc_gconfig*
         }
     }
 
+    const char* const workers = ast_variable_retrieve(cfg, cat, "workers");
+    if (workers) {
+        const int tmp = (int)strtol(workers, (char**)NULL, 10);
+        if (tmp < 1 || tmp > MANAGER_WORKERS_MAX) {
+            ast_log(LOG_NOTICE, "Invalid value for 'workers' in general section, must be between 1 and %d, using default value %d\n", MANAGER_WORKERS_MAX,
+                    config->manager_workers);
+        } else {
+            config->manager_workers = tmp;
+        }
+    }
+
+    const char* const hotplug = ast_variable_retrieve(cfg, cat, "hotplug");
+    if (hotplug) {
+        const int mode = hotplug_str2mode(hotplug);
+        if (mode < 0) {
+            ast_log(LOG_NOTICE, "Invalid value for 'hotplug' in general section, must be off, kernel or udev, using default value %s\n",
+                    hotplug_mode2str(config->hotplug));
+        } else {
+            config->hotplug = (hotplug_mode_t)mode;
+        }
+    }
+
     const char* const smsdb = ast_variable_retrieve(cfg, cat, "smsdb");
     if (smsdb) {
         ast_copy_string(config->sms_db, smsdb, sizeof(config->sms_db));
@@ -338,15 +405,30 @@ int dc_config_fill(struct ast_config* cfg, const char* cat, const struct dc_scon
     return err;
 }
 
+/* settings applied by initialization of device or by channel setup, changes require restart */
 static int dc_sconfig_compare(const struct dc_sconfig* const cfg1, const struct dc_sconfig* const cfg2)
 {
+    return cfg1->multiparty != cfg2->multiparty || cfg1->dtmf != cfg2->dtmf || cfg1->dsci != cfg2->dsci || cfg1->dtmf_duration != cfg2->dtmf_duration ||
+           cfg1->init_state != cfg2->init_state || cfg1->call_waiting != cfg2->call_waiting || cfg1->msg_service != cfg2->msg_service ||
+           cfg1->msg_direct != cfg2->msg_direct || cfg1->msg_storage != cfg2->msg_storage || cfg1->at_pipeline != cfg2->at_pipeline ||
+           cfg1->reset_modem != cfg2->reset_modem;
+}
+
+/* settings read when used, changes are applied without restart */
+static int dc_sconfig_compare_hot(const struct dc_sconfig* const cfg1, const struct dc_sconfig* const cfg2)
+{
+    for (unsigned i = 0; i < RATE_LIMITS; ++i) {
+        if (cfg1->limits[i].count != cfg2->limits[i].count || cfg1->limits[i].period != cfg2->limits[i].period) {
+            return 1;
+        }
+    }
+
     return strcmp(cfg1->context, cfg2->context) || strcmp(cfg1->exten, cfg2->exten) || strcmp(cfg1->language, cfg2->language) || cfg1->group != cfg2->group ||
            cfg1->rxgain != cfg2->rxgain || cfg1->txgain != cfg2->txgain || cfg1->calling_pres != cfg2->calling_pres ||
-           cfg1->use_calling_pres != cfg2->use_calling_pres || cfg1->sms_autodelete != cfg2->sms_autodelete || cfg1->reset_modem != cfg2->reset_modem ||
-           cfg1->multiparty != cfg2->multiparty || cfg1->dtmf != cfg2->dtmf || cfg1->moh != cfg2->moh || cfg1->query_time != cfg2->query_time ||
-           cfg1->dsci != cfg2->dsci || cfg1->qhup != cfg2->qhup || cfg1->dtmf_duration != cfg2->dtmf_duration || cfg1->init_state != cfg2->init_state ||
-           cfg1->call_waiting != cfg2->call_waiting || cfg1->msg_service != cfg2->msg_service || cfg1->msg_direct != cfg2->msg_direct ||
-           cfg1->msg_storage != cfg2->msg_storage;
+           cfg1->use_calling_pres != cfg2->use_calling_pres || cfg1->sms_autodelete != cfg2->sms_autodelete ||
+           cfg1->moh != cfg2->moh || cfg1->query_time != cfg2->query_time || cfg1->qhup != cfg2->qhup || cfg1->msg_delete_batch != cfg2->msg_delete_batch ||
+           cfg1->adaptive_timeout != cfg2->adaptive_timeout || cfg1->msg_queue_size != cfg2->msg_queue_size || cfg1->msg_retries != cfg2->msg_retries ||
+           cfg1->msg_cmms != cfg2->msg_cmms || cfg1->weight != cfg2->weight;
 }
 
 static int dc_uconfig_compare(const struct dc_uconfig* const cfg1, const struct dc_uconfig* const cfg2)
@@ -362,3 +444,11 @@ int pvt_config_compare(const struct pvt_config* const cfg1, const struct pvt_con
     }
     return dc_sconfig_compare(&cfg1->shared, &cfg2->shared) || dc_uconfig_compare(&cfg1->unique, &cfg2->unique);
 }
+
+int pvt_config_compare_hot(const struct pvt_config* const cfg1, const struct pvt_config* const cfg2)
+{
+    if (!(cfg1 && cfg2)) {
+        return -1;
+    }
+    return dc_sconfig_compare_hot(&cfg1->shared, &cfg2->shared);
+}
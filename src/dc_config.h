@@ -8,12 +8,19 @@
 
 #include <asterisk/channel.h> /* AST_MAX_CONTEXT MAX_LANGUAGE */
 
+#include "hotplug.h" /* hotplug_mode_t */
 #include "mutils.h"
+#include "rate_limit.h" /* struct rate_limit_conf */
 
 #define CONFIG_FILE "quectel.conf"
 #define DEVNAMELEN 31
 #define PATHLEN 256
 #define DEVPATHLEN 256
+#define MSG_DELETE_BATCH_MAX 16 /* +CMGD commands in one command line */
+#define MSG_QUEUE_SIZE_MAX 256  /* outgoing messages waiting for submission */
+#define MSG_RETRIES_MAX 5       /* submission attempts after temporary failure */
+#define WEIGHT_MAX 100          /* weight of device in weighted selection */
+#define MANAGER_WORKERS_MAX 64  /* devices started or stopped concurrently */
 
 typedef enum { TRIBOOL_NONE = 0, TRIBOOL_FALSE = -1, TRIBOOL_TRUE = 1 } tristate_bool_t;
 
@@ -53,6 +60,7 @@ typedef struct dc_sconfig {
     char language[MAX_LANGUAGE];   /*!< default language 'en' */
 
     int group;        /*!< group number for group dialling 0 */
+    int weight;       /*!< weight of device in weighted selection 1 */
     int rxgain;       /*!< increase the incoming volume 0 */
     int txgain;       /*!< increase the outgoint volume 0 */
     int calling_pres; /*!< calling presentation */
@@ -66,19 +74,29 @@ typedef struct dc_sconfig {
     unsigned int query_time      :1; /*! 0 */
     unsigned int dsci            :1; /*!< use ^DSCI call state notifications */
     unsigned int qhup            :1; /*!< use QHUP command */
+    unsigned int at_pipeline     :1; /*!< send consecutive queries in one command line */
+    unsigned int adaptive_timeout:1; /*!< derive command timeouts from observed latency */
+    unsigned int msg_cmms        :1; /*!< keep SMS relay link open with AT+CMMS=1 between messages */
 
     long dtmf_duration;          /*! duration of DTMF in miliseconds */
     dev_state_t init_state;      /*! DEV_STATE_STARTED */
     call_waiting_t call_waiting; /*!< enable/disable/auto call waiting CALL_WAITING_AUTO */
 
     int msg_service;
+    int msg_delete_batch; /*!< number of +CMGD commands sent in one line after +CMGL, 0 - delete one by one */
+    int msg_queue_size;   /*!< maximal number of outgoing messages waiting for submission */
+    int msg_retries;      /*!< number of submission retries after temporary +CMS ERROR */
     tristate_bool_t msg_direct;
     message_storage_t msg_storage; /*! MESSAGE_STORAGE_AUTO */
+
+    struct rate_limit_conf limits[RATE_LIMITS]; /*!< call, SMS and USSD rate limits, unlimited */
 } dc_sconfig_t;
 
 /* Global settings */
 typedef struct dc_gconfig {
-    int manager_interval; /*!< The device discovery interval */
+    int manager_interval;   /*!< The device discovery interval */
+    int manager_workers;    /*!< number of devices started or stopped concurrently */
+    hotplug_mode_t hotplug; /*!< source of uevents of serial ports */
     char sms_db[PATHLEN];
     char sms_backup_db[PATHLEN];
     int sms_ttl;
@@ -108,6 +126,11 @@ void dc_sconfig_fill_defaults(struct dc_sconfig* config);
 void dc_sconfig_fill(struct ast_config* cfg, const char* cat, struct dc_sconfig* config);
 void dc_gconfig_fill(struct ast_config* cfg, const char* cat, struct dc_gconfig* config);
 int dc_config_fill(struct ast_config* cfg, const char* cat, const struct dc_sconfig* parent, struct pvt_config* config);
+
+/*! \brief Compare settings which require restart of device */
 int pvt_config_compare(const struct pvt_config* const cfg1, const struct pvt_config* const cfg2);
 
+/*! \brief Compare settings which are applied without restart of device */
+int pvt_config_compare_hot(const struct pvt_config* const cfg1, const struct pvt_config* const cfg2);
+
 #endif /* CHAN_QUECTEL_DC_CONFIG_H_INCLUDED */
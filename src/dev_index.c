@@ -0,0 +1,507 @@
+/*
+    dev_index.c
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ast_config.h"
+
+#include <asterisk/logger.h>
+#include <asterisk/utils.h>
+
+#include "dev_index.h"
+
+#include "chan_quectel.h"
+#include "mutils.h"
+
+static void dev_set_add(dev_set_t* set, unsigned slot) { set->bits[slot / 64u] |= UINT64_C(1) << (slot % 64u); }
+
+static void dev_set_del(dev_set_t* set, unsigned slot) { set->bits[slot / 64u] &= ~(UINT64_C(1) << (slot % 64u)); }
+
+static int dev_set_empty(const dev_set_t* set)
+{
+    for (unsigned i = 0; i < ARRAY_LEN(set->bits); ++i) {
+        if (set->bits[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static unsigned dev_set_pvts(const struct dev_index* idx, const dev_set_t* set, struct pvt** pvts, unsigned size)
+{
+    unsigned cnt = 0;
+
+    for (unsigned i = 0; i < ARRAY_LEN(set->bits); ++i) {
+        for (uint64_t bits = set->bits[i]; bits && cnt < size; bits &= bits - 1u) {
+            pvts[cnt++] = idx->slots[i * 64u + (unsigned)__builtin_ctzll(bits)];
+        }
+    }
+    return cnt;
+}
+
+static unsigned dev_index_hash(const char* key)
+{
+    unsigned hash = 5381u;
+
+    for (; *key; ++key) {
+        hash = hash * 33u + (unsigned char)*key;
+    }
+    return hash % DEV_INDEX_BUCKETS;
+}
+
+#/* hash maps */
+
+static void dev_index_map_add(struct dev_index* idx, dev_index_kind_t kind, const char* key, unsigned slot)
+{
+    struct dev_index_key** const bucket = &idx->maps[kind][dev_index_hash(key)];
+    struct dev_index_key* k;
+
+    for (k = *bucket; k; k = k->next) {
+        if (!strcmp(k->key, key)) {
+            break;
+        }
+    }
+
+    if (!k) {
+        const size_t len = strlen(key);
+        k                = ast_calloc(1, sizeof(struct dev_index_key) + len + 1u);
+        if (!k) {
+            return;
+        }
+        memcpy(k->key, key, len + 1u);
+        k->next = *bucket;
+        *bucket = k;
+    }
+
+    dev_set_add(&k->devices, slot);
+}
+
+static void dev_index_map_del(struct dev_index* idx, dev_index_kind_t kind, const char* key, unsigned slot)
+{
+    for (struct dev_index_key** k = &idx->maps[kind][dev_index_hash(key)]; *k; k = &(*k)->next) {
+        if (strcmp((*k)->key, key)) {
+            continue;
+        }
+
+        dev_set_del(&(*k)->devices, slot);
+        if (dev_set_empty(&(*k)->devices)) {
+            struct dev_index_key* const empty = *k;
+            *k                                = empty->next;
+            ast_free(empty);
+        }
+        return;
+    }
+}
+
+#/* IMSI trie */
+
+static void dev_index_imsi_add(struct dev_index* idx, const char* imsi, unsigned slot)
+{
+    struct dev_index_node* node = &idx->imsi_root;
+
+    dev_set_add(&node->devices, slot);
+    for (; *imsi >= '0' && *imsi <= '9'; ++imsi) {
+        struct dev_index_node** const next = &node->digit[*imsi - '0'];
+        if (!*next) {
+            *next = ast_calloc(1, sizeof(struct dev_index_node));
+            if (!*next) {
+                return;
+            }
+        }
+        node = *next;
+        dev_set_add(&node->devices, slot);
+    }
+}
+
+static int dev_index_node_unused(const struct dev_index_node* node)
+{
+    if (!dev_set_empty(&node->devices)) {
+        return 0;
+    }
+
+    for (unsigned i = 0; i < ARRAY_LEN(node->digit); ++i) {
+        if (node->digit[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void dev_index_imsi_del(struct dev_index_node* node, const char* imsi, unsigned slot)
+{
+    dev_set_del(&node->devices, slot);
+
+    if (*imsi < '0' || *imsi > '9') {
+        return;
+    }
+
+    struct dev_index_node** const next = &node->digit[*imsi - '0'];
+    if (!*next) {
+        return;
+    }
+
+    dev_index_imsi_del(*next, imsi + 1, slot);
+    if (dev_index_node_unused(*next)) {
+        ast_free(*next);
+        *next = NULL;
+    }
+}
+
+static void dev_index_node_free(struct dev_index_node* node)
+{
+    for (unsigned i = 0; i < ARRAY_LEN(node->digit); ++i) {
+        if (node->digit[i]) {
+            dev_index_node_free(node->digit[i]);
+            ast_free(node->digit[i]);
+            node->digit[i] = NULL;
+        }
+    }
+}
+
+#/* */
+
+static void dev_index_set_key(struct dev_index* idx, unsigned slot, dev_index_kind_t kind, const char* key)
+{
+    char** const cur = &idx->keys[slot][kind];
+
+    if (*cur) {
+        if (key && !strcmp(*cur, key)) {
+            return;
+        }
+        dev_index_map_del(idx, kind, *cur, slot);
+        ast_free(*cur);
+        *cur = NULL;
+    }
+
+    if (key) {
+        *cur = ast_strdup(key);
+        dev_index_map_add(idx, kind, key, slot);
+    }
+}
+
+static void dev_index_set_imsi(struct dev_index* idx, unsigned slot, const char* imsi)
+{
+    char** const cur = &idx->imsi[slot];
+
+    if (*cur) {
+        if (imsi && !strcmp(*cur, imsi)) {
+            return;
+        }
+        dev_index_imsi_del(&idx->imsi_root, *cur, slot);
+        ast_free(*cur);
+        *cur = NULL;
+    }
+
+    if (imsi) {
+        *cur = ast_strdup(imsi);
+        dev_index_imsi_add(idx, imsi, slot);
+    }
+}
+
+static void dev_index_set_keys(struct dev_index* idx, unsigned slot, struct pvt* pvt)
+{
+    char group[16];
+
+    if (pvt) {
+        snprintf(group, sizeof(group), "%d", CONF_SHARED(pvt, group));
+    }
+
+    dev_index_set_key(idx, slot, DEV_INDEX_ID, pvt ? PVT_ID(pvt) : NULL);
+    dev_index_set_key(idx, slot, DEV_INDEX_IMEI, pvt ? pvt->imei : NULL);
+    dev_index_set_key(idx, slot, DEV_INDEX_ICCID, pvt ? pvt->iccid : NULL);
+    dev_index_set_key(idx, slot, DEV_INDEX_PROVIDER, pvt ? pvt->provider_name : NULL);
+    dev_index_set_key(idx, slot, DEV_INDEX_GROUP, pvt ? group : NULL);
+    dev_index_set_imsi(idx, slot, pvt ? pvt->imsi : NULL);
+}
+
+void dev_index_init(struct dev_index* idx)
+{
+    memset(idx, 0, sizeof(*idx));
+    ast_rwlock_init(&idx->lock);
+}
+
+void dev_index_destroy(struct dev_index* idx)
+{
+    for (unsigned slot = 0; slot < DEV_INDEX_SLOTS; ++slot) {
+        if (idx->slots[slot]) {
+            dev_index_set_keys(idx, slot, NULL);
+            idx->slots[slot] = NULL;
+        }
+    }
+
+    dev_index_node_free(&idx->imsi_root);
+    ast_rwlock_destroy(&idx->lock);
+}
+
+int dev_index_add(struct dev_index* idx, struct pvt* pvt)
+{
+    SCOPED_WRLOCK(idx_lock, &idx->lock);
+
+    for (unsigned slot = 0; slot < DEV_INDEX_SLOTS; ++slot) {
+        if (idx->slots[slot]) {
+            continue;
+        }
+
+        idx->slots[slot] = pvt;
+        pvt->index_slot  = (int)slot;
+        dev_index_set_keys(idx, slot, pvt);
+        return 0;
+    }
+
+    ast_log(LOG_ERROR, "[%s] Device not indexed, more than %d devices\n", PVT_ID(pvt), DEV_INDEX_SLOTS);
+    return -1;
+}
+
+void dev_index_remove(struct dev_index* idx, struct pvt* pvt)
+{
+    if (pvt->index_slot < 0) {
+        return;
+    }
+
+    SCOPED_WRLOCK(idx_lock, &idx->lock);
+
+    const unsigned slot = (unsigned)pvt->index_slot;
+    dev_index_set_keys(idx, slot, NULL);
+    __atomic_store_n(&idx->ready[slot], 0u, __ATOMIC_RELEASE);
+    __atomic_store_n(&idx->last_used[slot], 0u, __ATOMIC_RELAXED);
+    memset(&idx->load[slot], 0, sizeof(idx->load[slot]));
+    __atomic_fetch_and(&idx->posted.bits[slot / 64u], ~(UINT64_C(1) << (slot % 64u)), __ATOMIC_RELAXED);
+    idx->slots[slot] = NULL;
+    pvt->index_slot  = -1;
+}
+
+void dev_index_update(struct dev_index* idx, struct pvt* pvt)
+{
+    if (pvt->index_slot < 0) {
+        return;
+    }
+
+    SCOPED_WRLOCK(idx_lock, &idx->lock);
+    dev_index_set_keys(idx, (unsigned)pvt->index_slot, pvt);
+}
+
+unsigned dev_index_find(struct dev_index* idx, dev_index_kind_t kind, const char* key, struct pvt** pvts, unsigned size)
+{
+    SCOPED_RDLOCK(idx_lock, &idx->lock);
+
+    for (const struct dev_index_key* k = idx->maps[kind][dev_index_hash(key)]; k; k = k->next) {
+        if (!strcmp(k->key, key)) {
+            return dev_set_pvts(idx, &k->devices, pvts, size);
+        }
+    }
+    return 0;
+}
+
+unsigned dev_index_find_imsi(struct dev_index* idx, const char* prefix, struct pvt** pvts, unsigned size)
+{
+    SCOPED_RDLOCK(idx_lock, &idx->lock);
+
+    const struct dev_index_node* node = &idx->imsi_root;
+    for (; *prefix; ++prefix) {
+        if (*prefix < '0' || *prefix > '9') {
+            return 0;
+        }
+        node = node->digit[*prefix - '0'];
+        if (!node) {
+            return 0;
+        }
+    }
+    return dev_set_pvts(idx, &node->devices, pvts, size);
+}
+
+#/* */
+
+void dev_index_set_ready(struct dev_index* idx, const struct pvt* pvt, unsigned int ready, const struct dev_load* load)
+{
+    if (pvt->index_slot < 0) {
+        return;
+    }
+
+    struct dev_load* const l = &idx->load[pvt->index_slot];
+    __atomic_store_n(&l->chans, load->chans, __ATOMIC_RELAXED);
+    __atomic_store_n(&l->rssi, load->rssi, __ATOMIC_RELAXED);
+    __atomic_store_n(&l->asr, load->asr, __ATOMIC_RELAXED);
+    __atomic_store_n(&l->weight, load->weight, __ATOMIC_RELAXED);
+    __atomic_store_n(&idx->ready[pvt->index_slot], ready, __ATOMIC_RELEASE);
+}
+
+int dev_index_is_ready(const struct dev_index* idx, const struct pvt* pvt, unsigned int mask)
+{
+    if (pvt->index_slot < 0) {
+        return 0;
+    }
+
+    return (__atomic_load_n(&idx->ready[pvt->index_slot], __ATOMIC_ACQUIRE) & mask) == mask;
+}
+
+void dev_index_set_throttled(struct dev_index* idx, const struct pvt* pvt, rate_limit_t limit, int64_t until)
+{
+    if (pvt->index_slot < 0) {
+        return;
+    }
+
+    __atomic_store_n(&idx->load[pvt->index_slot].throttled[limit], until, __ATOMIC_RELAXED);
+}
+
+int dev_index_is_throttled(const struct dev_index* idx, const struct pvt* pvt, rate_limit_t limit, int64_t now)
+{
+    if (pvt->index_slot < 0) {
+        return 0;
+    }
+
+    return __atomic_load_n(&idx->load[pvt->index_slot].throttled[limit], __ATOMIC_RELAXED) > now;
+}
+
+int dev_index_take_last_used(struct dev_index* idx, const struct pvt* pvt, dev_index_kind_t kind)
+{
+    const unsigned int mark = 1u << kind;
+
+    if (pvt->index_slot < 0) {
+        return 0;
+    }
+
+    return (__atomic_fetch_and(&idx->last_used[pvt->index_slot], ~mark, __ATOMIC_RELAXED) & mark) != 0;
+}
+
+void dev_index_set_last_used(struct dev_index* idx, const struct pvt* pvt, dev_index_kind_t kind)
+{
+    if (pvt->index_slot < 0) {
+        return;
+    }
+
+    __atomic_fetch_or(&idx->last_used[pvt->index_slot], 1u << kind, __ATOMIC_RELAXED);
+}
+
+#/* selection strategies */
+
+static const char* const strategy_names[DEV_SELECT_STRATEGIES] = {"first", "rr", "lru", "idle", "rssi", "asr", "weighted"};
+
+dev_select_t dev_select_str2strategy(const char* str)
+{
+    const int strategy = str2enum(str, strategy_names, ARRAY_LEN(strategy_names));
+    return strategy < 0 ? DEV_SELECT_DEFAULT : (dev_select_t)strategy;
+}
+
+const char* dev_select_strategy2str(dev_select_t strategy) { return enum2str_def((unsigned)strategy, strategy_names, ARRAY_LEN(strategy_names), "default"); }
+
+struct dev_rank {
+    struct pvt* pvt;
+    long score;            /*!< lower is better */
+    unsigned int selected; /*!< tie breaker, least recently selected first */
+};
+
+static long dev_index_score(const struct dev_load* load, dev_select_t strategy)
+{
+    switch (strategy) {
+        case DEV_SELECT_IDLE:
+            return __atomic_load_n(&load->chans, __ATOMIC_RELAXED);
+
+        case DEV_SELECT_RSSI:
+            return -(long)__atomic_load_n(&load->rssi, __ATOMIC_RELAXED);
+
+        case DEV_SELECT_ASR:
+            return -(long)__atomic_load_n(&load->asr, __ATOMIC_RELAXED);
+
+        default:
+            return 0;
+    }
+}
+
+int dev_index_post(struct dev_index* idx, const struct pvt* pvt)
+{
+    if (pvt->index_slot < 0) {
+        return -1;
+    }
+
+    const unsigned slot = (unsigned)pvt->index_slot;
+    const uint64_t bit  = UINT64_C(1) << (slot % 64u);
+    return (__atomic_fetch_or(&idx->posted.bits[slot / 64u], bit, __ATOMIC_ACQ_REL) & bit) ? 1 : 0;
+}
+
+int dev_index_take_posted(struct dev_index* idx, dev_set_t* posted)
+{
+    for (unsigned i = 0; i < ARRAY_LEN(posted->bits); ++i) {
+        posted->bits[i] = __atomic_exchange_n(&idx->posted.bits[i], 0, __ATOMIC_ACQ_REL);
+    }
+    return !dev_set_empty(posted);
+}
+
+unsigned dev_index_posted(struct dev_index* idx, const dev_set_t* posted, struct pvt** pvts, unsigned size)
+{
+    dev_set_t set = *posted;
+
+    SCOPED_RDLOCK(idx_lock, &idx->lock);
+    /* removed devices */
+    for (unsigned slot = 0; slot < DEV_INDEX_SLOTS; ++slot) {
+        if (!idx->slots[slot]) {
+            dev_set_del(&set, slot);
+        }
+    }
+    return dev_set_pvts(idx, &set, pvts, size);
+}
+
+void dev_index_order(struct dev_index* idx, dev_select_t strategy, struct pvt** pvts, unsigned count)
+{
+    struct dev_rank ranks[DEV_INDEX_SLOTS];
+    const unsigned int seq = (unsigned int)__atomic_load_n(&idx->select_seq, __ATOMIC_RELAXED);
+
+    count = MIN(count, DEV_INDEX_SLOTS);
+    for (unsigned i = 0; i < count; ++i) {
+        const struct dev_load* const load = &idx->load[pvts[i]->index_slot];
+
+        ranks[i].pvt      = pvts[i];
+        ranks[i].score    = dev_index_score(load, strategy);
+        ranks[i].selected = seq - __atomic_load_n(&load->selected, __ATOMIC_RELAXED);
+    }
+
+    if (strategy == DEV_SELECT_WEIGHTED) {
+        /* weighted random permutation, every place drawn from remaining candidates */
+        for (unsigned i = 0; i < count; ++i) {
+            unsigned long total = 0;
+            for (unsigned j = i; j < count; ++j) {
+                total += MAX(1u, __atomic_load_n(&idx->load[ranks[j].pvt->index_slot].weight, __ATOMIC_RELAXED));
+            }
+
+            unsigned long draw = (unsigned long)ast_random() % total;
+            for (unsigned j = i; j < count; ++j) {
+                const unsigned int weight = MAX(1u, __atomic_load_n(&idx->load[ranks[j].pvt->index_slot].weight, __ATOMIC_RELAXED));
+                if (draw < weight) {
+                    const struct dev_rank r = ranks[i];
+                    ranks[i]                = ranks[j];
+                    ranks[j]                = r;
+                    break;
+                }
+                draw -= weight;
+            }
+        }
+    } else {
+        /* insertion sort, few candidates */
+        for (unsigned i = 1; i < count; ++i) {
+            const struct dev_rank r = ranks[i];
+            unsigned j              = i;
+            for (; j > 0 && (ranks[j - 1].score > r.score || (ranks[j - 1].score == r.score && ranks[j - 1].selected < r.selected)); --j) {
+                ranks[j] = ranks[j - 1];
+            }
+            ranks[j] = r;
+        }
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+        pvts[i] = ranks[i].pvt;
+    }
+}
+
+void dev_index_selected(struct dev_index* idx, const struct pvt* pvt, dev_select_t strategy)
+{
+    if (pvt->index_slot < 0) {
+        return;
+    }
+
+    const int seq = ast_atomic_fetchadd_int(&idx->select_seq, 1) + 1;
+    __atomic_store_n(&idx->load[pvt->index_slot].selected, (unsigned int)seq, __ATOMIC_RELAXED);
+    if (strategy >= 0 && strategy < DEV_SELECT_STRATEGIES) {
+        ast_atomic_fetchadd_int(&idx->select_strategy[strategy], 1);
+    }
+}
@@ -0,0 +1,185 @@
+/*
+    dev_index.h
+*/
+
+#ifndef CHAN_QUECTEL_DEV_INDEX_H_INCLUDED
+#define CHAN_QUECTEL_DEV_INDEX_H_INCLUDED
+
+#include <stdint.h>
+
+#include "ast_config.h"
+
+#include <asterisk/lock.h>
+
+#include "rate_limit.h" /* RATE_LIMITS */
+
+/*
+    Indexes of devices by identity.
+
+    Every device occupies a slot, sets of devices are bitmaps of slots.
+    Exact keys are kept in hash maps, IMSI prefixes in a digit trie.
+    Index keeps own copies of keys, so lookups don't lock devices;
+    found devices are candidates, caller locks them and checks keys again.
+
+    Every device publishes readiness word, updated atomically by device
+    under its lock and read by selector without any lock, so devices not
+    ready are skipped without waiting for them. Round-robin marks of last
+    used devices are kept in the same way.
+
+    Load of device (channels, signal, answered calls, weight) is published
+    together with readiness, selection strategies order candidates by it.
+    Devices with exhausted rate limit publish time when next request is
+    admitted and are skipped until then.
+
+    Events of devices for device manager are posted as bits of atomic set.
+
+    Lock order: device list (writers only), device, index.
+    Indexed devices are valid while device list read-side section is held.
+*/
+
+#define DEV_INDEX_SLOTS 128  /*!< maximal number of indexed devices, MAXQUECTELDEVICES */
+#define DEV_INDEX_BUCKETS 64 /*!< number of buckets of every hash map */
+
+struct pvt;
+
+typedef enum {
+    DEV_INDEX_ID = 0,
+    DEV_INDEX_IMEI,
+    DEV_INDEX_ICCID,
+    DEV_INDEX_PROVIDER,
+    DEV_INDEX_GROUP,
+    DEV_INDEX_KINDS,                  /*!< number of hash maps */
+    DEV_INDEX_IMSI = DEV_INDEX_KINDS, /*!< IMSI prefix, kept in trie */
+} dev_index_kind_t;
+
+typedef enum {
+    DEV_READY_VOICE = 1 << 0, /*!< initialized, registered, voice capable and enabled */
+    DEV_READY_FREE  = 1 << 1, /*!< no calls, new call may be dialed */
+    DEV_READY_SMS   = 1 << 2, /*!< initialized, registered, SMS capable and enabled */
+} dev_ready_t;
+
+typedef enum {
+    DEV_SELECT_DEFAULT = -1,   /*!< strategy implied by resource */
+    DEV_SELECT_FIRST   = 0,    /*!< first available device */
+    DEV_SELECT_ROUND_ROBIN,    /*!< next available device after last used */
+    DEV_SELECT_LRU,            /*!< least recently selected device */
+    DEV_SELECT_IDLE,           /*!< device with least channels */
+    DEV_SELECT_RSSI,           /*!< device with best signal */
+    DEV_SELECT_ASR,            /*!< device with highest ratio of answered outgoing calls */
+    DEV_SELECT_WEIGHTED,       /*!< random device, probability proportional to weight */
+    DEV_SELECT_STRATEGIES,     /*!< number of strategies */
+} dev_select_t;
+
+/* published load of device, every field is accessed atomically */
+struct dev_load {
+    unsigned int chans;             /*!< number of channels */
+    int rssi;                       /*!< signal strength 0-31, -1 if unknown */
+    unsigned int asr;               /*!< permille of answered outgoing calls, 1000 if no calls yet */
+    unsigned int weight;            /*!< configured weight */
+    unsigned int selected;          /*!< selection sequence number of last selection */
+    int64_t throttled[RATE_LIMITS]; /*!< milliseconds when next request is admitted by rate limit */
+};
+
+typedef struct dev_set {
+    uint64_t bits[DEV_INDEX_SLOTS / 64];
+} dev_set_t;
+
+struct dev_index_key {
+    struct dev_index_key* next; /*!< next key in bucket */
+    dev_set_t devices;          /*!< devices having this key */
+    char key[0];
+};
+
+struct dev_index_node {
+    dev_set_t devices;                /*!< devices having IMSI with prefix of this node */
+    struct dev_index_node* digit[10]; /*!< longer prefixes */
+};
+
+struct dev_index {
+    ast_rwlock_t lock;
+    struct pvt* slots[DEV_INDEX_SLOTS];                             /*!< indexed devices */
+    char* keys[DEV_INDEX_SLOTS][DEV_INDEX_KINDS];                   /*!< current keys of devices */
+    char* imsi[DEV_INDEX_SLOTS];                                    /*!< current IMSI of devices */
+    struct dev_index_key* maps[DEV_INDEX_KINDS][DEV_INDEX_BUCKETS]; /*!< hash maps by kind */
+    struct dev_index_node imsi_root;                                /*!< IMSI trie */
+    unsigned int ready[DEV_INDEX_SLOTS];                            /*!< readiness words of devices, dev_ready_t, atomic */
+    unsigned int last_used[DEV_INDEX_SLOTS];                        /*!< round-robin marks of devices by kind, atomic */
+    struct dev_load load[DEV_INDEX_SLOTS];                          /*!< published load of devices */
+
+    int select_lookups;   /*!< number of device selections */
+    int select_skipped;   /*!< candidates skipped as not ready without locking */
+    int select_locked;    /*!< candidates locked for confirmation */
+    int select_contended; /*!< candidates locked by another thread at confirmation */
+    int select_seq;       /*!< selection sequence number */
+    int select_strategy[DEV_SELECT_STRATEGIES]; /*!< number of selections by strategy */
+
+    dev_set_t posted; /*!< devices with events for device manager, atomic */
+};
+
+void dev_index_init(struct dev_index* idx);
+void dev_index_destroy(struct dev_index* idx);
+
+/*!
+ * \brief Add device to index, device must be locked
+ * \return 0 on success, -1 if there is no free slot
+ */
+int dev_index_add(struct dev_index* idx, struct pvt* pvt);
+
+void dev_index_remove(struct dev_index* idx, struct pvt* pvt);
+
+/*! \brief Update keys of device after identity or configuration change, device must be locked */
+void dev_index_update(struct dev_index* idx, struct pvt* pvt);
+
+/*!
+ * \brief Find devices by exact key
+ * \param pvts -- candidates in slot order
+ * \return number of candidates
+ */
+unsigned dev_index_find(struct dev_index* idx, dev_index_kind_t kind, const char* key, struct pvt** pvts, unsigned size);
+
+/*! \brief Find devices with IMSI starting with prefix */
+unsigned dev_index_find_imsi(struct dev_index* idx, const char* prefix, struct pvt** pvts, unsigned size);
+
+/*! \brief Publish readiness word and load of device, device must be locked */
+void dev_index_set_ready(struct dev_index* idx, const struct pvt* pvt, unsigned int ready, const struct dev_load* load);
+
+/*! \brief Test readiness word of device without locking, mask of dev_ready_t */
+int dev_index_is_ready(const struct dev_index* idx, const struct pvt* pvt, unsigned int mask);
+
+/*! \brief Publish time when next request is admitted by rate limit of device */
+void dev_index_set_throttled(struct dev_index* idx, const struct pvt* pvt, rate_limit_t limit, int64_t until);
+
+/*! \brief Test if rate limit of device is exhausted without locking */
+int dev_index_is_throttled(const struct dev_index* idx, const struct pvt* pvt, rate_limit_t limit, int64_t now);
+
+/*! \brief Test and clear round-robin mark of device for kind of key */
+int dev_index_take_last_used(struct dev_index* idx, const struct pvt* pvt, dev_index_kind_t kind);
+
+/*! \brief Mark device as last used for kind of key */
+void dev_index_set_last_used(struct dev_index* idx, const struct pvt* pvt, dev_index_kind_t kind);
+
+/*!
+ * \brief Post event of device to device manager
+ * \return 0 if posted, 1 if already posted, -1 if device is not indexed
+ */
+int dev_index_post(struct dev_index* idx, const struct pvt* pvt);
+
+/*!
+ * \brief Take set of devices with posted events
+ * \return non-zero if any event was posted
+ */
+int dev_index_take_posted(struct dev_index* idx, dev_set_t* posted);
+
+/*! \brief Devices of set, device list must be locked */
+unsigned dev_index_posted(struct dev_index* idx, const dev_set_t* posted, struct pvt** pvts, unsigned size);
+
+/*! \brief Order candidates by published load according to strategy, the best first */
+void dev_index_order(struct dev_index* idx, dev_select_t strategy, struct pvt** pvts, unsigned count);
+
+/*! \brief Account selection of device */
+void dev_index_selected(struct dev_index* idx, const struct pvt* pvt, dev_select_t strategy);
+
+dev_select_t dev_select_str2strategy(const char* str);
+const char* dev_select_strategy2str(dev_select_t strategy);
+
+#endif /* CHAN_QUECTEL_DEV_INDEX_H_INCLUDED */
@@ -37,6 +37,12 @@ const char* error2str(int err)
         "Input too large",
         "Fail to format AT command",
         "Unable to allocate memory",
+        "AT trace was not enabled",
+        "Unable to write AT trace file",
+        "Outgoing message queue is full",
+        "Another command batch is running",
+        "Invalid number of commands in batch",
+        "Rate limit of device exceeded",
     };
     return enum2str(err, errors, ARRAY_LEN(errors));
 }
@@ -35,7 +35,13 @@ enum error {
     E_BUILD_PHONE_NUMBER,
     E_2BIG,
     E_CMD_FORMAT,
-    E_MALLOC
+    E_MALLOC,
+    E_NO_TRACE,
+    E_TRACE_WRITE,
+    E_SMS_QUEUE_FULL,
+    E_BATCH_BUSY,
+    E_BATCH_SIZE,
+    E_RATE_LIMITED
 };
 
 const char* error2str(int err);
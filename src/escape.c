@@ -0,0 +1,39 @@
+/*
+    escape.c
+*/
+
+#include "escape.h"
+
+/* escape sequence character by byte value, zero if byte is passed as is */
+static const char escape_map[256] = {
+    ['\0'] = '0', ['\a'] = 'a', ['\b'] = 'b', ['\t'] = 't', ['\n'] = 'n', ['\v'] = 'v', ['\f'] = 'f', ['\r'] = 'r', [0x1A] = 'z', [0x1B] = 'e',
+};
+
+size_t escape_c(char* dest, size_t size, const char* src, size_t len)
+{
+    if (!dest || !size) {
+        return 0;
+    }
+
+    char* p               = dest;
+    const char* const end = dest + size - 1u;
+
+    for (; len && p < end; --len, ++src) {
+        const char e = escape_map[(unsigned char)*src];
+        if (!e) {
+            *p++ = *src;
+            continue;
+        }
+
+        if (end - p < 2) {
+            /* Not enough room left for the escape sequence. */
+            break;
+        }
+
+        *p++ = '\\';
+        *p++ = e;
+    }
+    *p = '\0';
+
+    return (size_t)(p - dest);
+}
@@ -0,0 +1,23 @@
+/*
+    escape.h
+*/
+
+#ifndef CHAN_QUECTEL_ESCAPE_H_INCLUDED
+#define CHAN_QUECTEL_ESCAPE_H_INCLUDED
+
+#include <stddef.h>
+
+/*! \brief Size of buffer required to escape len bytes, including terminating zero */
+static inline size_t escape_buffer_size(size_t len) { return (len * 2u) + 1u; }
+
+/*!
+ * \brief Replace control characters by C-like escape sequences
+ * \param dest -- destination buffer, always zero-terminated
+ * \param size -- size of destination buffer
+ * \param src -- source data, may contain zero bytes
+ * \param len -- length of source data
+ * \return length of escaped string
+ */
+size_t escape_c(char* dest, size_t size, const char* src, size_t len);
+
+#endif /* CHAN_QUECTEL_ESCAPE_H_INCLUDED */
@@ -12,11 +12,16 @@
 
 #include "ast_config.h"
 
+#include <asterisk/astobj2.h> /* ao2_ref() */
+#include <asterisk/threadstorage.h>
+
 #include "helpers.h"
 
+#include "at_batch.h" /* at_batch_alloc() at_batch_start() */
 #include "at_command.h"
 #include "chan_quectel.h" /* devices */
 #include "error.h"
+#include "escape.h"
 #include "smsdb.h"
 
 // #include "pdu.h"				/* pdu_digit2code() */
@@ -90,11 +95,14 @@ int send_ussd(const char* dev_name, const char* ussd)
 
     RAII_VAR(struct pvt*, pvt, get_pvt(dev_name, 1), pvt_unlock);
 
-    if (!pvt) {
+    if (!pvt || pvt_rate_limit_take(pvt, RATE_LIMIT_USSD)) {
         return -1;
     }
 
     const int res = at_enqueue_ussd(&pvt->sys_chan, ussd, 0);
+    if (res) {
+        pvt_rate_limit_give(pvt, RATE_LIMIT_USSD);
+    }
     return res;
 }
 
@@ -109,11 +117,15 @@ int send_sms(const char* const resource, const char* const sca, const char* cons
 
     RAII_VAR(struct pvt* const, pvt, get_msg_pvt(resource), pvt_unlock);
 
-    if (!pvt) {
+    if (!pvt || pvt_rate_limit_take(pvt, RATE_LIMIT_SMS)) {
         return -1;
     }
 
     const int res = at_enqueue_sms(&pvt->sys_chan, sca, destination, message, validity, report);
+    if (res) {
+        /* message refused (queue full, invalid text), it does not count */
+        pvt_rate_limit_give(pvt, RATE_LIMIT_SMS);
+    }
     return res;
 }
 
@@ -379,6 +391,28 @@ int send_at_command(const char* dev_name, const char* command)
     return res;
 }
 
+struct at_batch* send_at_batch(const char* dev_name, const char* const* commands, unsigned count)
+{
+    RAII_VAR(struct pvt* const, pvt, get_pvt(dev_name, 0), pvt_unlock);
+
+    if (!pvt) {
+        return NULL;
+    }
+
+    struct at_batch* const batch = at_batch_alloc(commands, count);
+    if (!batch) {
+        chan_quectel_err = E_MALLOC;
+        return NULL;
+    }
+
+    if (at_batch_start(pvt, batch)) {
+        ao2_ref(batch, -1);
+        return NULL;
+    }
+
+    return batch;
+}
+
 int schedule_restart_event(dev_state_t event, restate_time_t when, const char* dev_name)
 {
     RAII_VAR(struct pvt* const, pvt, pvt_find(dev_name), pvt_unlock);
@@ -395,6 +429,60 @@ int schedule_restart_event(dev_state_t event, restate_time_t when, const char* d
     return 0;
 }
 
+#/* */
+
+int set_at_trace(const char* dev_name, int enable, size_t size)
+{
+    RAII_VAR(struct pvt* const, pvt, pvt_find(dev_name), pvt_unlock);
+
+    if (!pvt) {
+        chan_quectel_err = E_DEVICE_NOT_FOUND;
+        return -1;
+    }
+
+    struct at_trace* trace = pvt->trace;
+
+    if (enable && !trace) {
+        trace = at_trace_alloc(size);
+        if (!trace) {
+            chan_quectel_err = E_MALLOC;
+            return -1;
+        }
+        /* monitor thread reads trace without lock, trace is freed only with device */
+        __atomic_store_n(&pvt->trace, trace, __ATOMIC_RELEASE);
+    } else if (!trace) {
+        return 0;
+    }
+
+    if (enable < 0) {
+        at_trace_clear(trace);
+    } else {
+        __atomic_store_n(&trace->enabled, enable, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+int dump_at_trace(const char* dev_name, const char* fname)
+{
+    RAII_VAR(struct pvt* const, pvt, pvt_find(dev_name), pvt_unlock);
+
+    if (!pvt) {
+        chan_quectel_err = E_DEVICE_NOT_FOUND;
+        return -1;
+    }
+
+    if (!pvt->trace) {
+        chan_quectel_err = E_NO_TRACE;
+        return -1;
+    }
+
+    const int res = at_trace_dump(pvt->trace, fname);
+    if (res < 0) {
+        chan_quectel_err = E_TRACE_WRITE;
+    }
+    return res;
+}
+
 int str2gain(const char* s, int* gain)
 {
     if (!s) {
@@ -494,118 +582,77 @@ struct ast_str* const gain2str_simcom(int gain)
     return res;
 }
 
-static char escape_sequences[] = {0x1A, 0x1B, '\a', '\b', '\f', '\n', '\r', '\t', '\v', '\0'};
-
-static char escape_sequences_map[] = {'z', 'e', 'a', 'b', 'f', 'n', 'r', 't', 'v', '\0'};
-
-static char* escape_c(char* dest, const char* s, size_t size)
+struct ast_str* escape_nstr(const char* buf, size_t cnt)
 {
-    /*
-     * Note - This is an optimized version of ast_escape. When looking only
-     * for escape_sequences a couple of checks used in the generic case can
-     * be left out thus making it slightly more efficient.
-     */
-    char* p;
-    char* c;
-
-    if (!dest || !size) {
-        return dest;
-    }
-    if (ast_strlen_zero(s)) {
-        *dest = '\0';
-        return dest;
-    }
-
-    for (p = dest; *s && --size; ++s, ++p) {
-        /*
-         * See if the character to escape is part of the standard escape
-         * sequences. If so use its mapped counterpart.
-         */
-        c = strchr(escape_sequences, *s);
-        if (c) {
-            if (!--size) {
-                /* Not enough room left for the escape sequence. */
-                break;
-            }
-
-            *p++ = '\\';
-            *p   = escape_sequences_map[c - escape_sequences];
-        } else {
-            *p = *s;
-        }
+    const size_t size          = get_esc_str_buffer_size(cnt);
+    struct ast_str* const ebuf = ast_str_create(size);
+    if (!ebuf) {
+        return NULL;
     }
-    *p = '\0';
 
-    return dest;
+    ast_str_truncate(ebuf, escape_c(ast_str_buffer(ebuf), ast_str_size(ebuf), buf, cnt));
+    return ebuf;
 }
 
-size_t get_esc_str_buffer_size(size_t len) { return (len * 2u) + 1u; }
-
-struct ast_str* escape_nstr(const char* buf, size_t cnt)
+struct ast_str* escape_str(const struct ast_str* const str)
 {
-    if (!buf || !cnt) {  // build empty string
-        struct ast_str* nbuf = ast_str_create(1);
-        ast_str_truncate(nbuf, 0);
-        return nbuf;
+    if (!str) {
+        return escape_nstr(NULL, 0);
     }
+    return escape_nstr(ast_str_buffer(str), ast_str_strlen(str));
+}
 
-    // build null-terminated string
-    struct ast_str* nbuf = ast_str_create(cnt + 1u);
-    memcpy(ast_str_buffer(nbuf), buf, cnt);
-    ast_str_truncate(nbuf, cnt);
+#/* thread-local buffers of tmp_esc_str()/tmp_esc_nstr() */
 
-    // unescape string
-    struct ast_str* const ebuf = ast_str_create(get_esc_str_buffer_size(cnt));
-    escape_c(ast_str_buffer(ebuf), ast_str_buffer(nbuf), ast_str_size(ebuf));
-    ast_str_update(ebuf);
+#define ESC_TMP_SLOTS 4
+#define ESC_TMP_DEF_LEN 128
 
-    ast_free(nbuf);
-    return ebuf;
-}
+struct esc_tmp {
+    unsigned int next;
+    struct ast_str* slots[ESC_TMP_SLOTS];
+};
 
-const char* escape_nstr_ex(struct ast_str* ebuf, const char* buf, size_t cnt)
+static void esc_tmp_free(void* data)
 {
-    if (!cnt) {
-        ast_str_truncate(ebuf, 0);
-        return ast_str_buffer(ebuf);
-    }
+    struct esc_tmp* const tmp = data;
 
-    // build null-terminated string
-    struct ast_str* nbuf = ast_str_create(cnt + 1u);
-    memcpy(ast_str_buffer(nbuf), buf, cnt);
-    ast_str_truncate(nbuf, cnt);
-
-    // unescape string
-    const char* const res = escape_str_ex(ebuf, nbuf);
-    ast_free(nbuf);
-    return res;
+    for (unsigned int i = 0; i < ESC_TMP_SLOTS; ++i) {
+        ast_free(tmp->slots[i]);
+    }
+    ast_free(tmp);
 }
 
-struct ast_str* escape_str(const struct ast_str* const str)
+AST_THREADSTORAGE_CUSTOM(esc_tmp_buf, NULL, esc_tmp_free);
+
+const char* tmp_esc_nstr(const char* buf, size_t cnt)
 {
-    if (!str || !ast_str_strlen(str)) {
-        struct ast_str* nbuf = ast_str_create(1);
-        ast_str_truncate(nbuf, 0);
-        return nbuf;
+    struct esc_tmp* const tmp = ast_threadstorage_get(&esc_tmp_buf, sizeof(struct esc_tmp));
+    if (!tmp) {
+        return "";
     }
 
-    const size_t len           = ast_str_strlen(str);
-    struct ast_str* const ebuf = ast_str_create(get_esc_str_buffer_size(len));
-    escape_c(ast_str_buffer(ebuf), ast_str_buffer(str), ast_str_size(ebuf));
-    ast_str_update(ebuf);
+    struct ast_str** const slot = &tmp->slots[tmp->next++ % ESC_TMP_SLOTS];
+    const size_t size           = get_esc_str_buffer_size(cnt);
 
-    return ebuf;
+    if (!*slot) {
+        *slot = ast_str_create(MAX(size, ESC_TMP_DEF_LEN));
+        if (!*slot) {
+            return "";
+        }
+    } else if (ast_str_make_space(slot, size)) {
+        return "";
+    }
+
+    ast_str_truncate(*slot, escape_c(ast_str_buffer(*slot), ast_str_size(*slot), buf, cnt));
+    return ast_str_buffer(*slot);
 }
 
-const char* escape_str_ex(struct ast_str* ebuf, const struct ast_str* const str)
+const char* tmp_esc_str(const struct ast_str* const str)
 {
-    const size_t len = ast_str_strlen(str);
-    if (ast_str_make_space(&ebuf, get_esc_str_buffer_size(len))) {
-        return ast_str_buffer(str);
+    if (!str) {
+        return "";
     }
-    escape_c(ast_str_buffer(ebuf), ast_str_buffer(str), ast_str_size(ebuf));
-    ast_str_update(ebuf);
-    return ast_str_buffer(ebuf);
+    return tmp_esc_nstr(ast_str_buffer(str), ast_str_strlen(str));
 }
 
 #/* */
@@ -9,6 +9,7 @@
 
 #include "chan_quectel.h" /* restate_time_t */
 #include "dc_config.h"    /* call_waiting_t */
+#include "escape.h"
 
 /* return status string of sending, status arg is optional */
 int send_ussd(const char* dev_name, const char* ussd);
@@ -29,7 +30,17 @@ int query_rxgain(const char* dev_name);
 int send_rxgain(const char* dev_name, int gain);
 int send_uac_apply(const char* dev_name);
 int send_at_command(const char* dev_name, const char* command);
+
+/*!
+ * \brief Queue batch of user commands on device
+ * \return batch reference to wait for, NULL on error and chan_quectel_err is set
+ */
+struct at_batch* send_at_batch(const char* dev_name, const char* const* commands, unsigned count);
 int schedule_restart_event(dev_state_t event, restate_time_t when, const char* dev_name);
+
+/* enable > 0 - start tracing, 0 - stop tracing, < 0 - clear trace buffer */
+int set_at_trace(const char* dev_name, int enable, size_t size);
+int dump_at_trace(const char* dev_name, const char* fname);
 int is_valid_phone_number(const char* number);
 
 int str2gain(const char*, int*);
@@ -38,26 +49,18 @@ struct ast_str* const gain2str(int);
 int str2gain_simcom(const char*, int*);
 struct ast_str* const gain2str_simcom(int);
 
-size_t get_esc_str_buffer_size(size_t);
+static inline size_t get_esc_str_buffer_size(size_t len) { return escape_buffer_size(len); }
+
 struct ast_str* escape_nstr(const char*, size_t);
 struct ast_str* escape_str(const struct ast_str* const);
 
-const char* escape_nstr_ex(struct ast_str*, const char*, size_t);
-const char* escape_str_ex(struct ast_str*, const struct ast_str* const);
-
-#define tmp_esc_str(str)                                                         \
-    ({                                                                           \
-        const size_t STR_TMP_LEN = get_esc_str_buffer_size(ast_str_strlen(str)); \
-        struct ast_str* STR_TMP  = ast_str_alloca(STR_TMP_LEN);                  \
-        escape_str_ex(STR_TMP, str);                                             \
-    })
-
-#define tmp_esc_nstr(str, len)                                   \
-    ({                                                           \
-        const size_t STR_TMP_LEN = get_esc_str_buffer_size(len); \
-        struct ast_str* STR_TMP  = ast_str_alloca(STR_TMP_LEN);  \
-        escape_nstr_ex(STR_TMP, str, len);                       \
-    })
+/*
+    Escape into one of few thread-local buffers reused in round-robin manner.
+    Result is valid until the same thread escapes a few more strings,
+    so it is suitable for log message arguments only.
+*/
+const char* tmp_esc_nstr(const char*, size_t);
+const char* tmp_esc_str(const struct ast_str* const);
 
 #define AST_JSON_OBJECT_SET(j, s) \
     if (s && ast_str_strlen(s)) ast_json_object_set(j, #s, ast_json_string_create(ast_str_buffer(s)));
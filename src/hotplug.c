@@ -0,0 +1,370 @@
+/*
+    hotplug.c
+*/
+
+#include <arpa/inet.h> /* ntohl() */
+#include <errno.h>
+#include <limits.h> /* PATH_MAX */
+#include <linux/netlink.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h> /* realpath() */
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ast_config.h"
+
+#include <asterisk/lock.h>
+#include <asterisk/logger.h>
+#include <asterisk/utils.h>
+
+#include "hotplug.h"
+
+#include "eventfd.h"
+#include "mutils.h"
+
+#define HOTPLUG_GROUP_KERNEL 1u   /* multicast group of kernel uevents */
+#define HOTPLUG_GROUP_UDEV 2u     /* multicast group of uevents processed by udev */
+#define HOTPLUG_BUFSIZE 8192      /* maximal size of uevent */
+#define HOTPLUG_RCVBUF (1 << 20)  /* socket buffer for uevent storm at boot */
+
+static const char DEV_PREFIX[]    = "/dev/";
+static const uint32_t UDEV_MAGIC  = 0xfeedcafe;
+static const char UDEV_PREFIX[8]  = "libudev";
+
+/* header of uevent sent by udev */
+struct udev_header {
+    char prefix[8];          /*!< libudev */
+    uint32_t magic;          /*!< UDEV_MAGIC, network order */
+    uint32_t header_size;    /*!< size of header */
+    uint32_t properties_off; /*!< offset of properties */
+    uint32_t properties_len; /*!< size of properties */
+    uint32_t filter[4];      /*!< subsystem, devtype and tag filters */
+};
+
+struct hotplug {
+    hotplug_mode_t mode;
+    hotplug_handler_t handler;
+    int sock;       /*!< netlink socket */
+    int stop_event; /*!< eventfd signalled to stop thread */
+    pthread_t thread;
+};
+
+struct hotplug_stat hotplug_stat;
+
+static const char* const mode_names[] = {"off", "kernel", "udev"};
+
+int hotplug_str2mode(const char* str) { return str2enum(str, mode_names, ARRAY_LEN(mode_names)); }
+
+const char* hotplug_mode2str(hotplug_mode_t mode) { return enum2str((unsigned)mode, mode_names, ARRAY_LEN(mode_names)); }
+
+#/* */
+
+static void hotplug_property(char* prop, struct hotplug_event* ev)
+{
+    char* const eq = strchr(prop, '=');
+    if (!eq) {
+        return;
+    }
+
+    *eq               = '\0';
+    const char* value = eq + 1;
+
+    if (!strcmp(prop, "ACTION")) {
+        ev->action = value;
+    } else if (!strcmp(prop, "SUBSYSTEM")) {
+        ev->subsystem = value;
+    } else if (!strcmp(prop, "DEVNAME")) {
+        ev->devname = value;
+    } else if (!strcmp(prop, "DEVLINKS")) {
+        ev->devlinks = value;
+    }
+}
+
+/* zero-separated KEY=VALUE properties, buf[end] is writable */
+static int hotplug_parse_properties(char* buf, size_t off, size_t end, struct hotplug_event* ev)
+{
+    memset(ev, 0, sizeof(*ev));
+
+    while (off < end) {
+        char* const prop = buf + off;
+        const size_t len = strnlen(prop, end - off);
+        prop[len]        = '\0';
+        hotplug_property(prop, ev);
+        off += len + 1u;
+    }
+
+    return ev->action && ev->subsystem ? 0 : -1;
+}
+
+int hotplug_parse(char* buf, size_t len, struct hotplug_event* ev)
+{
+    if (len >= sizeof(struct udev_header) && !memcmp(buf, UDEV_PREFIX, sizeof(UDEV_PREFIX))) {
+        struct udev_header hdr;
+        memcpy(&hdr, buf, sizeof(hdr));
+
+        if (ntohl(hdr.magic) != UDEV_MAGIC || hdr.properties_off < sizeof(hdr) || hdr.properties_off > len ||
+            hdr.properties_len > len - hdr.properties_off) {
+            return -1;
+        }
+        return hotplug_parse_properties(buf, hdr.properties_off, (size_t)hdr.properties_off + hdr.properties_len, ev);
+    }
+
+    /* kernel uevent: action@devpath followed by properties */
+    const size_t head = strnlen(buf, len);
+    if (head == len || !memchr(buf, '@', head)) {
+        return -1;
+    }
+    return hotplug_parse_properties(buf, head + 1u, len, ev);
+}
+
+static int hotplug_dispatch(hotplug_handler_t handler, const struct hotplug_event* ev)
+{
+    if (!ev->devname || strcmp(ev->subsystem, "tty")) {
+        return 0;
+    }
+
+    ast_debug(4, "[hotplug] %s %s\n", ev->action, ev->devname);
+    ast_atomic_fetchadd_int(&hotplug_stat.handled, 1);
+    handler(ev);
+    return 1;
+}
+
+int hotplug_match(const struct hotplug_event* ev, const char* path, const char* resolved)
+{
+    char node[PATH_MAX];
+    char real[PATH_MAX];
+
+    if (!ev->devname || ast_strlen_zero(path)) {
+        return 0;
+    }
+
+    /* kernel reports name relative to /dev */
+    if (strncmp(ev->devname, DEV_PREFIX, STRLEN(DEV_PREFIX))) {
+        snprintf(node, sizeof(node), "%s%s", DEV_PREFIX, ev->devname);
+    } else {
+        ast_copy_string(node, ev->devname, sizeof(node));
+    }
+
+    if (!strcmp(path, node)) {
+        return 1;
+    }
+
+    if (ev->devlinks) {
+        const size_t len = strlen(path);
+        for (const char* link = ev->devlinks; *link; link += strspn(link, " ")) {
+            const size_t link_len = strcspn(link, " ");
+            if (link_len == len && !strncmp(link, path, len)) {
+                return 1;
+            }
+            link += link_len;
+        }
+    }
+
+    if (!ast_strlen_zero(resolved) && !strcmp(resolved, node)) {
+        return 1;
+    }
+
+    /* symlink not reported by event, resolve it while it exists */
+    return realpath(path, real) && !strcmp(real, node);
+}
+
+void hotplug_resolve(const char* path, char* buf, size_t size)
+{
+    char real[PATH_MAX];
+
+    if (ast_strlen_zero(path) || !realpath(path, real)) {
+        buf[0] = '\0';
+        return;
+    }
+    ast_copy_string(buf, real, size);
+}
+
+#/* */
+
+static void hotplug_receive(struct hotplug* hp)
+{
+    char buf[HOTPLUG_BUFSIZE + 1];
+    char control[CMSG_SPACE(sizeof(struct ucred))];
+    struct sockaddr_nl addr;
+    struct iovec iov  = {.iov_base = buf, .iov_len = HOTPLUG_BUFSIZE};
+    struct msghdr msg = {
+        .msg_name = &addr, .msg_namelen = sizeof(addr), .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control, .msg_controllen = sizeof(control)};
+
+    const ssize_t n = recvmsg(hp->sock, &msg, MSG_DONTWAIT);
+    if (n <= 0) {
+        if (n < 0 && errno == ENOBUFS) {
+            ast_log(LOG_WARNING, "[hotplug] Events lost, devices are found by periodic scan\n");
+        }
+        return;
+    }
+
+    ast_atomic_fetchadd_int(&hotplug_stat.received, 1);
+
+    /* kernel events are sent by kernel, udev events by root process */
+    const struct cmsghdr* const cmsg = CMSG_FIRSTHDR(&msg);
+    const struct ucred* const cred   = (cmsg && cmsg->cmsg_type == SCM_CREDENTIALS) ? (const struct ucred*)CMSG_DATA(cmsg) : NULL;
+    if (!cred || cred->uid || (msg.msg_flags & MSG_TRUNC) || (hp->mode == HOTPLUG_KERNEL) != !addr.nl_pid) {
+        ast_atomic_fetchadd_int(&hotplug_stat.rejected, 1);
+        return;
+    }
+
+    struct hotplug_event ev;
+    if (hotplug_parse(buf, (size_t)n, &ev)) {
+        ast_atomic_fetchadd_int(&hotplug_stat.rejected, 1);
+        return;
+    }
+
+    hotplug_dispatch(hp->handler, &ev);
+}
+
+static void* hotplug_threadproc(void* arg)
+{
+    struct hotplug* const hp = arg;
+    struct pollfd fds[]      = {{.fd = hp->sock, .events = POLLIN}, {.fd = hp->stop_event, .events = POLLIN}};
+
+    while (1) {
+        if (poll(fds, ARRAY_LEN(fds), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ast_log(LOG_ERROR, "[hotplug] Fail to wait for events: %s - exiting\n", strerror(errno));
+            break;
+        }
+
+        if (fds[1].revents) {
+            ast_debug(3, "[hotplug] Got exit event\n");
+            break;
+        }
+
+        if (fds[0].revents) {
+            hotplug_receive(hp);
+        }
+    }
+
+    return NULL;
+}
+
+struct hotplug* hotplug_start(hotplug_mode_t mode, hotplug_handler_t handler)
+{
+    static const int on    = 1;
+    static const int rcvbuf = HOTPLUG_RCVBUF;
+
+    if (mode == HOTPLUG_OFF) {
+        return NULL;
+    }
+
+    struct hotplug* const hp = ast_calloc(1, sizeof(*hp));
+    if (!hp) {
+        return NULL;
+    }
+
+    hp->mode       = mode;
+    hp->handler    = handler;
+    hp->stop_event = eventfd_create();
+    hp->sock       = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (hp->sock < 0 || hp->stop_event < 0) {
+        ast_log(LOG_ERROR, "[hotplug] Unable to create uevent socket: %s\n", strerror(errno));
+        goto cleanup;
+    }
+
+    setsockopt(hp->sock, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on));
+    setsockopt(hp->sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    const struct sockaddr_nl addr = {.nl_family = AF_NETLINK, .nl_groups = mode == HOTPLUG_KERNEL ? HOTPLUG_GROUP_KERNEL : HOTPLUG_GROUP_UDEV};
+    if (bind(hp->sock, (const struct sockaddr*)&addr, sizeof(addr))) {
+        ast_log(LOG_ERROR, "[hotplug] Unable to bind uevent socket: %s\n", strerror(errno));
+        goto cleanup;
+    }
+
+    if (ast_pthread_create(&hp->thread, NULL, hotplug_threadproc, hp)) {
+        ast_log(LOG_ERROR, "[hotplug] Unable to create listener thread\n");
+        goto cleanup;
+    }
+
+    ast_verb(3, "[hotplug] Listening to %s events\n", hotplug_mode2str(mode));
+    return hp;
+
+cleanup:
+    if (hp->sock >= 0) {
+        close(hp->sock);
+    }
+    eventfd_close(&hp->stop_event);
+    ast_free(hp);
+    return NULL;
+}
+
+void hotplug_stop(struct hotplug* hp)
+{
+    if (!hp) {
+        return;
+    }
+
+    if (eventfd_signal(hp->stop_event)) {
+        ast_log(LOG_ERROR, "[hotplug] Unable to signal listener thread\n");
+    } else {
+        pthread_join(hp->thread, NULL);
+    }
+
+    close(hp->sock);
+    eventfd_close(&hp->stop_event);
+    ast_free(hp);
+}
+
+hotplug_mode_t hotplug_get_mode(const struct hotplug* hp) { return hp ? hp->mode : HOTPLUG_OFF; }
+
+int hotplug_replay(const char* path, hotplug_handler_t handler)
+{
+    char props[HOTPLUG_BUFSIZE + 1];
+    char line[1024];
+    size_t len = 0;
+    int count  = 0;
+
+    FILE* const f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+
+    auto void flush()
+    {
+        struct hotplug_event ev;
+
+        if (!len) {
+            return;
+        }
+
+        ast_atomic_fetchadd_int(&hotplug_stat.received, 1);
+        if (hotplug_parse_properties(props, 0, len, &ev)) {
+            ast_atomic_fetchadd_int(&hotplug_stat.rejected, 1);
+        } else {
+            count += hotplug_dispatch(handler, &ev);
+        }
+        len = 0;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!line[0]) {
+            flush();
+            continue;
+        }
+
+        /* headers of udevadm output and comments */
+        if (line[0] == '#' || !strchr(line, '=')) {
+            continue;
+        }
+
+        const size_t l = strlen(line) + 1u;
+        if (len + l > HOTPLUG_BUFSIZE) {
+            continue;
+        }
+        memcpy(props + len, line, l);
+        len += l;
+    }
+    flush();
+
+    fclose(f);
+    return count;
+}
@@ -0,0 +1,84 @@
+/*
+    hotplug.h
+*/
+
+#ifndef CHAN_QUECTEL_HOTPLUG_H_INCLUDED
+#define CHAN_QUECTEL_HOTPLUG_H_INCLUDED
+
+#include <stddef.h>
+
+/*
+    Hotplug of serial ports.
+
+    Listener thread receives uevents from netlink socket, either raw kernel
+    events or events processed by udev, latter carry symlinks of device node
+    in DEVLINKS property. Events of tty subsystem are passed to handler,
+    which starts devices with appearing ports and stops devices with
+    disappearing ones.
+
+    Synthetic uevents may be read from file for testing, one event per block
+    of KEY=VALUE lines, blocks are separated by empty lines, other lines are
+    ignored (format of `udevadm monitor --property` output).
+*/
+
+typedef enum {
+    HOTPLUG_OFF = 0, /*!< no listener, devices are found by periodic scan only */
+    HOTPLUG_KERNEL,  /*!< kernel uevents, only device node names are known */
+    HOTPLUG_UDEV,    /*!< uevents processed by udev, symlinks are known */
+} hotplug_mode_t;
+
+struct hotplug_event {
+    const char* action;    /*!< add, remove, change ... */
+    const char* subsystem; /*!< tty, usb ... */
+    const char* devname;   /*!< device node, with or without /dev/ prefix */
+    const char* devlinks;  /*!< space separated symlinks of device node, udev only */
+};
+
+/* statistics, fields are accessed atomically */
+struct hotplug_stat {
+    int received; /*!< number of received uevents */
+    int rejected; /*!< number of malformed or foreign uevents */
+    int handled;  /*!< number of uevents of serial ports passed to handler */
+};
+
+typedef void (*hotplug_handler_t)(const struct hotplug_event* ev);
+
+struct hotplug;
+
+/*! \brief Start listener thread */
+struct hotplug* hotplug_start(hotplug_mode_t mode, hotplug_handler_t handler);
+
+/*! \brief Stop listener thread and free listener */
+void hotplug_stop(struct hotplug* hp);
+
+hotplug_mode_t hotplug_get_mode(const struct hotplug* hp);
+
+/*!
+ * \brief Read synthetic uevents from file and pass them to handler
+ * \return number of events passed to handler, -1 if file can't be read
+ */
+int hotplug_replay(const char* path, hotplug_handler_t handler);
+
+/*!
+ * \brief Test if event is about device node or symlink path
+ * \param resolved -- device node of path resolved while it existed, may be empty;
+ *                    symlink can't be resolved on removal, node is already gone
+ */
+int hotplug_match(const struct hotplug_event* ev, const char* path, const char* resolved);
+
+/*! \brief Resolve symlinks of path to device node, empty string if path doesn't exist */
+void hotplug_resolve(const char* path, char* buf, size_t size);
+
+/*!
+ * \brief Parse netlink message, buffer of len + 1 bytes is modified
+ * \return 0 on success, -1 if message is malformed
+ */
+int hotplug_parse(char* buf, size_t len, struct hotplug_event* ev);
+
+extern struct hotplug_stat hotplug_stat;
+
+/*! \brief Parse mode, -1 if invalid */
+int hotplug_str2mode(const char* str);
+const char* hotplug_mode2str(hotplug_mode_t mode);
+
+#endif /* CHAN_QUECTEL_HOTPLUG_H_INCLUDED */
@@ -8,6 +8,7 @@
 #include "ast_config.h"
 
 #include <asterisk/lock.h>
+#include <asterisk/poll-compat.h>
 #include <asterisk/strings.h>
 #include <asterisk/taskprocessor.h>
 #include <asterisk/threadpool.h>
@@ -18,6 +19,7 @@
 #include "at_read.h"
 #include "chan_quectel.h"
 #include "channel.h"
+#include "eventfd.h"
 #include "helpers.h"
 #include "smsdb.h"
 #include "tty.h"
@@ -81,7 +83,10 @@ static void cmd_timeout(struct pvt* const pvt)
         return;
     }
 
-    if (at_response(pvt, &pvt->empty_str, RES_TIMEOUT)) {
+    PVT_STAT(pvt, at_cmd_timeouts)++;
+    const int res = at_response(pvt, &pvt->empty_str, RES_TIMEOUT);
+    pvt_publish_ready(pvt);
+    if (res) {
         ast_log(LOG_ERROR, "[%s] Fail to handle response\n", PVT_ID(pvt));
         pvt->terminate_monitor = 1;
         return;
@@ -165,6 +170,69 @@ static int check_dev_status(struct pvt* const pvt, struct ast_taskprocessor* tps
     return 0;
 }
 
+static void flush_commands(struct pvt* const pvt, int* const pending)
+{
+    /* called with pvt unlocked but pvt lock may be held by another thread, retry on next POLLOUT */
+    if (ast_mutex_trylock(&pvt->lock)) {
+        *pending = 1;
+        return;
+    }
+
+    const ssize_t res = pvt_direct_flush(pvt);
+    if (res < 0) {
+        ast_log(LOG_ERROR, "[%s][DATA] Unable to write buffered commands\n", PVT_ID(pvt));
+        pvt->terminate_monitor = 1;
+        *pending               = 0;
+    } else {
+        *pending = res > 0;
+    }
+
+    ast_mutex_unlock(&pvt->lock);
+}
+
+/*!
+ * \brief Wait for data from device, write buffered commands meanwhile
+ * \param efd -- eventfd signalled when commands are buffered
+ * \param pending -- commands are buffered, wait for device to become writable too
+ * \param ms -- timeout, updated with remaining time
+ * \return non-zero if device is readable, 0 on timeout or signal
+ */
+static int monitor_wait(struct pvt* const pvt, int fd, int efd, int* pending, int* ms)
+{
+    const struct timeval start = ast_tvnow();
+    const int timeout          = *ms;
+
+    while (1) {
+        struct pollfd pfd[2] = {
+            {.fd = fd,  .events = POLLIN | POLLPRI | (*pending ? POLLOUT : 0)},
+            {.fd = efd, .events = POLLIN                                     },
+        };
+
+        const int elapsed = (int)ast_tvdiff_ms(ast_tvnow(), start);
+        *ms               = timeout > elapsed ? timeout - elapsed : 0;
+
+        const int res = ast_poll(pfd, ARRAY_LEN(pfd), *ms);
+        if (res <= 0) {
+            /* timeout or signal from pvt_monitor_stop() */
+            *ms = 0;
+            return 0;
+        }
+
+        const int signalled = pfd[1].revents & POLLIN;
+        if (signalled) {
+            eventfd_reset(efd);
+        }
+
+        if (signalled || (pfd[0].revents & POLLOUT)) {
+            flush_commands(pvt, pending);
+        }
+
+        if (pfd[0].revents & (POLLIN | POLLPRI | POLLERR | POLLHUP)) {
+            return 1;
+        }
+    }
+}
+
 static void monitor_threadproc_pvt(struct pvt* const pvt)
 {
     static const size_t RINGBUFFER_SIZE = 2 * 1024;
@@ -188,8 +256,11 @@ static void monitor_threadproc_pvt(struct pvt* const pvt)
     }
 
     /* 4 reduce locking time make copy of this readonly fields */
-    const int fd = pvt->data_fd;
+    const int fd  = pvt->data_fd;
+    const int efd = pvt->d_write_event;
+    int pending   = 0;
     at_clean_data(dev, fd, &rb);
+    __atomic_store_n(&pvt->d_read_pending, 0, __ATOMIC_RELEASE);
 
     /* schedule initilization  */
     if (at_enqueue_initialization(&pvt->sys_chan)) {
@@ -207,7 +278,7 @@ static void monitor_threadproc_pvt(struct pvt* const pvt)
 
         if (ast_mutex_trylock(&pvt->lock)) {  // pvt unlocked
             int t = RESPONSE_READ_TIMEOUT;
-            if (!at_wait(fd, &t)) {
+            if (!monitor_wait(pvt, fd, efd, &pending, &t)) {
                 if (ast_taskprocessor_push(tps, at_enqueue_ping_taskproc, pvt)) {
                     ast_debug(5, "[%s] Unable to handle timeout\n", dev);
                 }
@@ -244,10 +315,10 @@ static void monitor_threadproc_pvt(struct pvt* const pvt)
                     }
 
                     t = UNHANDLED_COMMAND_TIMEOUT;
-                    if (!at_wait(fd, &t)) {
+                    if (!monitor_wait(pvt, fd, efd, &pending, &t)) {
                         continue;
                     }
-                } else if (!at_wait(fd, &t)) {
+                } else if (!monitor_wait(pvt, fd, efd, &pending, &t)) {
                     if (ast_taskprocessor_push(tps, cmd_timeout_taskproc, pvt)) {
                         ast_debug(5, "[%s] Unable to handle timeout\n", dev);
                     }
@@ -255,7 +326,7 @@ static void monitor_threadproc_pvt(struct pvt* const pvt)
                 }
             } else {
                 t = RESPONSE_READ_TIMEOUT;
-                if (!at_wait(fd, &t)) {
+                if (!monitor_wait(pvt, fd, efd, &pending, &t)) {
                     if (check_taskprocessor(tps, dev)) {
                         if (ast_taskprocessor_push(tps, restart_monitor_taskproc, pvt)) {
                             ast_debug(5, "[%s] Unable to restart monitor thread\n", dev);
@@ -270,11 +341,12 @@ static void monitor_threadproc_pvt(struct pvt* const pvt)
             }
         }
 
-        /* FIXME: access to device not locked */
-        int iovcnt = at_read(dev, fd, &rb);
+        /* trace is published atomically and freed only with device, after this thread is stopped */
+        int iovcnt = at_read(dev, fd, &rb, __atomic_load_n(&pvt->trace, __ATOMIC_ACQUIRE));
         if (iovcnt < 0) {
             break;
         }
+        const struct timeval received = ast_tvnow();
 
         if (!ast_mutex_trylock(&pvt->lock)) {
             PVT_STAT(pvt, d_read_bytes) += iovcnt;
@@ -292,10 +364,16 @@ static void monitor_threadproc_pvt(struct pvt* const pvt)
                 continue;
             }
 
-            struct at_response_taskproc_data* const tpdata = at_response_taskproc_data_alloc(pvt, result);
+            if (at_response_dtmf_urc(pvt, result, &received)) {
+                continue;
+            }
+
+            struct at_response_taskproc_data* const tpdata = at_response_taskproc_data_alloc(pvt, result, &received);
             if (tpdata) {
+                __atomic_fetch_add(&pvt->d_read_pending, 1, __ATOMIC_RELEASE);
                 if (ast_taskprocessor_push(tps, at_response_taskproc, tpdata)) {
                     ast_log(LOG_ERROR, "[%s] Fail to handle response\n", dev);
+                    __atomic_fetch_sub(&pvt->d_read_pending, 1, __ATOMIC_RELEASE);
                     ast_free(tpdata);
                     goto e_restart;
                 }
@@ -312,8 +390,16 @@ e_cleanup:
     }
     /* it real, unsolicited disconnect */
     pvt->terminate_monitor = 0;
+    /* device failing before initialization is not restarted in a loop */
+    pvt->start_failed = !pvt->initialized;
+    pvt_disconnect(pvt);
+    /* let device manager reconnect device */
+    pvt_post_event(pvt);
+    ast_mutex_unlock(&pvt->lock);
+    return;
 
 e_restart:
+    pvt->start_failed = 0;
     pvt_disconnect(pvt);
     //	pvt->monitor_running = 0;
     ast_mutex_unlock(&pvt->lock);
@@ -0,0 +1,90 @@
+/*
+    rate_limit.c
+*/
+
+#include <stdio.h>
+
+#include "ast_config.h"
+
+#include <asterisk/time.h>
+
+#include "rate_limit.h"
+
+#include "mutils.h"
+
+static int64_t rate_limit_cost(const struct rate_limit_conf* conf) { return (int64_t)conf->period * 1000 / conf->count; }
+
+static int64_t rate_limit_tolerance(const struct rate_limit_conf* conf) { return (int64_t)conf->period * 1000 - rate_limit_cost(conf); }
+
+int rate_limit_parse(const char* str, struct rate_limit_conf* conf)
+{
+    unsigned int count;
+    unsigned int period;
+    char tail;
+
+    if (!strcasecmp(str, "off") || !strcmp(str, "0")) {
+        conf->count  = 0;
+        conf->period = 0;
+        return 0;
+    }
+
+    if (sscanf(str, "%u/%u%c", &count, &period, &tail) != 2 || !count || !period || period > 86400u) {
+        return -1;
+    }
+
+    conf->count  = count;
+    conf->period = period;
+    return 0;
+}
+
+int rate_limit_take(struct rate_limit* rl, const struct rate_limit_conf* conf, int64_t now)
+{
+    if (!conf->count) {
+        return 0;
+    }
+
+    const int64_t tat = MAX(rl->tat, now);
+    if (tat - now > rate_limit_tolerance(conf)) {
+        return -1;
+    }
+
+    rl->tat = tat + rate_limit_cost(conf);
+    return 0;
+}
+
+void rate_limit_give(struct rate_limit* rl, const struct rate_limit_conf* conf)
+{
+    if (!conf->count) {
+        return;
+    }
+
+    rl->tat -= rate_limit_cost(conf);
+}
+
+int64_t rate_limit_next(const struct rate_limit* rl, const struct rate_limit_conf* conf)
+{
+    if (!conf->count) {
+        return 0;
+    }
+
+    return MAX(rl->tat - rate_limit_tolerance(conf), 0);
+}
+
+const char* rate_limit_conf2str(const struct rate_limit_conf* conf, char* buf, unsigned int size)
+{
+    if (!conf->count) {
+        return "Off";
+    }
+
+    snprintf(buf, size, "%u/%u", conf->count, conf->period);
+    return buf;
+}
+
+int64_t rate_limit_now(void) { return ast_tvdiff_ms(ast_tvnow(), ast_tv(0, 0)); }
+
+const char* rate_limit2str(rate_limit_t limit)
+{
+    static const char* const names[] = {"call", "sms", "ussd"};
+
+    return enum2str_def(limit, names, ARRAY_LEN(names), "unknown");
+}
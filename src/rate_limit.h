@@ -0,0 +1,61 @@
+/*
+    rate_limit.h
+*/
+
+#ifndef CHAN_QUECTEL_RATE_LIMIT_H_INCLUDED
+#define CHAN_QUECTEL_RATE_LIMIT_H_INCLUDED
+
+#include <stdint.h>
+
+/*
+    Token bucket of requests of one kind.
+
+    Bucket holds up to count tokens and is refilled with count tokens per
+    period, so a burst of count requests is admitted and then one request
+    every period/count. Implemented as generic cell rate algorithm: only
+    theoretical arrival time of next request is kept.
+*/
+
+typedef enum {
+    RATE_LIMIT_CALL = 0, /*!< outgoing call attempts */
+    RATE_LIMIT_SMS,      /*!< outgoing messages */
+    RATE_LIMIT_USSD,     /*!< USSD requests */
+    RATE_LIMITS,         /*!< number of limits */
+} rate_limit_t;
+
+struct rate_limit_conf {
+    unsigned int count;  /*!< requests per period, 0 - unlimited */
+    unsigned int period; /*!< seconds */
+};
+
+struct rate_limit {
+    int64_t tat; /*!< theoretical arrival time in milliseconds */
+};
+
+/*!
+ * \brief Parse limit in form count/seconds, 0 or off disables limit
+ * \return 0 on success, -1 if value is invalid
+ */
+int rate_limit_parse(const char* str, struct rate_limit_conf* conf);
+
+/*!
+ * \brief Take token from bucket
+ * \return 0 if request is admitted, -1 if bucket is empty
+ */
+int rate_limit_take(struct rate_limit* rl, const struct rate_limit_conf* conf, int64_t now);
+
+/*! \brief Return token taken for request which was not sent */
+void rate_limit_give(struct rate_limit* rl, const struct rate_limit_conf* conf);
+
+/*! \brief Time in milliseconds when next request is admitted */
+int64_t rate_limit_next(const struct rate_limit* rl, const struct rate_limit_conf* conf);
+
+/*! \brief Format limit as count/seconds or Off */
+const char* rate_limit_conf2str(const struct rate_limit_conf* conf, char* buf, unsigned int size);
+
+/*! \brief Current time in milliseconds */
+int64_t rate_limit_now(void);
+
+const char* rate_limit2str(rate_limit_t limit);
+
+#endif /* CHAN_QUECTEL_RATE_LIMIT_H_INCLUDED */
@@ -0,0 +1,92 @@
+/*
+    rcu.c
+*/
+
+#include <string.h>
+#include <time.h>   /* clock_gettime() */
+#include <unistd.h> /* usleep() */
+
+#include "rcu.h"
+
+#define RCU_POLL_US 1000 /* interval of polling of readers during grace period */
+
+static unsigned int rcu_next_shard;
+static __thread unsigned int rcu_thread_shard = RCU_SHARDS;
+
+static unsigned int rcu_shard(void)
+{
+    if (rcu_thread_shard >= RCU_SHARDS) {
+        rcu_thread_shard = __atomic_fetch_add(&rcu_next_shard, 1u, __ATOMIC_RELAXED) % RCU_SHARDS;
+    }
+    return rcu_thread_shard;
+}
+
+/* no Asterisk dependency, test/rcu.c links this file alone */
+static int64_t rcu_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int rcu_phase_readers(const struct rcu* rcu, unsigned int phase)
+{
+    int readers = 0;
+
+    for (unsigned i = 0; i < RCU_SHARDS; ++i) {
+        readers += __atomic_load_n(&rcu->shards[i].readers[phase], __ATOMIC_SEQ_CST);
+    }
+    return readers;
+}
+
+void rcu_init(struct rcu* rcu) { memset(rcu, 0, sizeof(*rcu)); }
+
+unsigned int rcu_read_lock(struct rcu* rcu)
+{
+    struct rcu_shard* const shard = &rcu->shards[rcu_shard()];
+
+    while (1) {
+        const unsigned int phase = __atomic_load_n(&rcu->phase, __ATOMIC_SEQ_CST) & 1u;
+        __atomic_fetch_add(&shard->readers[phase], 1, __ATOMIC_SEQ_CST);
+
+        /* phase flipped before counter was seen by writer, enter next phase */
+        if ((__atomic_load_n(&rcu->phase, __ATOMIC_SEQ_CST) & 1u) == phase) {
+            __atomic_fetch_add(&shard->sections, 1, __ATOMIC_RELAXED);
+            return (unsigned int)(shard - rcu->shards) << 1 | phase;
+        }
+        __atomic_fetch_sub(&shard->readers[phase], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void rcu_read_unlock(struct rcu* rcu, unsigned int token) { __atomic_fetch_sub(&rcu->shards[token >> 1].readers[token & 1u], 1, __ATOMIC_SEQ_CST); }
+
+void rcu_synchronize(struct rcu* rcu)
+{
+    const int64_t begin      = rcu_now_ms();
+    const unsigned int phase = __atomic_fetch_add(&rcu->phase, 1u, __ATOMIC_SEQ_CST) & 1u;
+
+    while (rcu_phase_readers(rcu, phase)) {
+        usleep(RCU_POLL_US);
+    }
+
+    const uint64_t ms = (uint64_t)(rcu_now_ms() - begin);
+    __atomic_fetch_add(&rcu->grace_periods, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&rcu->grace_ms, ms, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&rcu->grace_ms_max, __ATOMIC_RELAXED);
+    while (ms > max && !__atomic_compare_exchange_n(&rcu->grace_ms_max, &max, ms, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+int rcu_sections(const struct rcu* rcu)
+{
+    int sections = 0;
+
+    for (unsigned i = 0; i < RCU_SHARDS; ++i) {
+        sections += __atomic_load_n(&rcu->shards[i].sections, __ATOMIC_RELAXED);
+    }
+    return sections;
+}
+
+int rcu_readers(const struct rcu* rcu) { return rcu_phase_readers(rcu, 0) + rcu_phase_readers(rcu, 1); }
@@ -0,0 +1,56 @@
+/*
+    rcu.h
+*/
+
+#ifndef CHAN_QUECTEL_RCU_H_INCLUDED
+#define CHAN_QUECTEL_RCU_H_INCLUDED
+
+#include <stdint.h>
+
+/*
+    Read-copy-update style protection of linked objects.
+
+    Readers enter read-side section by incrementing counter of current
+    phase and never block. Writer unlinks object, waits for grace period,
+    i.e. until every section entered before unlinking is left, and then
+    frees object. Grace period flips phase, so sections entered later are
+    not waited for.
+
+    Counters are sharded by reader thread, readers on different threads
+    don't share cache lines. Sections may be nested, but grace period
+    must not be waited for inside a section, grace periods are waited for
+    by one writer at a time.
+*/
+
+#define RCU_SHARDS 16 /*!< number of reader counters of each phase */
+
+struct rcu_shard {
+    int readers[2]; /*!< readers in section by phase, atomic */
+    int sections;   /*!< number of entered sections, atomic */
+} __attribute__((aligned(64)));
+
+struct rcu {
+    unsigned int phase;                  /*!< current phase, atomic */
+    struct rcu_shard shards[RCU_SHARDS]; /*!< reader counters */
+    int grace_periods;                   /*!< number of waited grace periods */
+    uint64_t grace_ms;                   /*!< milliseconds of grace periods, summary */
+    uint64_t grace_ms_max;               /*!< milliseconds of grace period, maximum */
+};
+
+void rcu_init(struct rcu* rcu);
+
+/*! \brief Enter read-side section, never blocks, returns token for rcu_read_unlock() */
+unsigned int rcu_read_lock(struct rcu* rcu);
+
+void rcu_read_unlock(struct rcu* rcu, unsigned int token);
+
+/*! \brief Wait until every read-side section entered before call is left */
+void rcu_synchronize(struct rcu* rcu);
+
+/*! \brief Number of entered read-side sections */
+int rcu_sections(const struct rcu* rcu);
+
+/*! \brief Number of readers in section now */
+int rcu_readers(const struct rcu* rcu);
+
+#endif /* CHAN_QUECTEL_RCU_H_INCLUDED */
@@ -0,0 +1,186 @@
+/*
+    sms_submit.c
+*/
+
+#include "ast_config.h"
+
+#include <asterisk/logger.h>
+#include <asterisk/utils.h>
+
+#include "sms_submit.h"
+
+#include "at_command.h" /* at_enqueue_sms_submit() */
+#include "chan_quectel.h"
+#include "char_conv.h" /* hexify() */
+#include "error.h"
+
+struct sms_submit* sms_submit_alloc(const pdu_part_t* pdus, unsigned parts)
+{
+    struct sms_submit* const sms = ast_calloc(1, sizeof(struct sms_submit) + sizeof(struct sms_submit_pdu) * parts);
+    if (!sms) {
+        return NULL;
+    }
+
+    sms->parts = parts;
+    for (unsigned i = 0; i < parts; ++i) {
+        hexify(pdus[i].buffer, pdus[i].length, sms->pdus[i].hex);
+        sms->pdus[i].length      = pdus[i].length * 2;
+        sms->pdus[i].tpdu_length = pdus[i].tpdu_length;
+    }
+    return sms;
+}
+
+/*
+ * Temporary failures of 3GPP TS 27.005:
+ *   38 - network out of order, 41 - temporary failure, 42 - congestion,
+ *   47 - resources unavailable, 331 - no network service, 332 - network timeout,
+ *   500 - unknown error
+ */
+static int sms_submit_retryable(int cms_error)
+{
+    switch (cms_error) {
+        case 38:
+        case 41:
+        case 42:
+        case 47:
+        case 331:
+        case 332:
+        case 500:
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+static void sms_submit_done(struct pvt* pvt)
+{
+    struct sms_queue* const q = &pvt->sms_queue;
+
+    ast_free(q->active);
+    q->active = NULL;
+    q->count--;
+    pvt->outgoing_sms = 0;
+}
+
+#/* */
+
+int sms_submit_full(const struct pvt* pvt) { return pvt->sms_queue.count >= (unsigned)CONF_SHARED(pvt, msg_queue_size); }
+
+int sms_submit_add(struct pvt* pvt, struct sms_submit* sms)
+{
+    struct sms_queue* const q = &pvt->sms_queue;
+
+    AST_LIST_INSERT_TAIL(&q->msgs, sms, entry);
+    q->count++;
+
+    if (sms_submit_run(pvt) && AST_LIST_FIRST(&q->msgs) == sms) {
+        /* nothing else to trigger another attempt, let caller fail */
+        AST_LIST_REMOVE_HEAD(&q->msgs, entry);
+        q->count--;
+        return -1;
+    }
+
+    if (q->count > PVT_STAT(pvt, sms_queue_max)) {
+        PVT_STAT(pvt, sms_queue_max) = q->count;
+    }
+    return 0;
+}
+
+int sms_submit_run(struct pvt* pvt)
+{
+    struct sms_queue* const q = &pvt->sms_queue;
+
+    if (q->active || !pvt->initialized) {
+        return 0;
+    }
+
+    struct sms_submit* const sms = AST_LIST_REMOVE_HEAD(&q->msgs, entry);
+    if (!sms) {
+        return 0;
+    }
+
+    /* keep relay link open for remaining parts and waiting messages */
+    const int cmms = CONF_SHARED(pvt, msg_cmms) && (sms->parts - sms->part > 1u || !AST_LIST_EMPTY(&q->msgs));
+
+    if (at_enqueue_sms_submit(&pvt->sys_chan, sms, cmms)) {
+        ast_log(LOG_ERROR, "[%s][SMS:%d] Unable to submit message: %s\n", PVT_ID(pvt), sms->uid, error2str(chan_quectel_err));
+        AST_LIST_INSERT_HEAD(&q->msgs, sms, entry);
+        return -1;
+    }
+
+    sms->attempts++;
+    q->active         = sms;
+    pvt->outgoing_sms = 1;
+    ast_debug(3, "[%s][SMS:%d] Submitting message parts %u-%u/%u, attempt %u\n", PVT_ID(pvt), sms->uid, sms->part + 1u, sms->parts, sms->parts,
+              sms->attempts);
+    return 0;
+}
+
+int sms_submit_sent(struct pvt* pvt, int uid)
+{
+    struct sms_submit* const sms = pvt->sms_queue.active;
+
+    if (!sms || sms->uid != uid) {
+        return 0;
+    }
+
+    if (++sms->part < sms->parts) {
+        return 0;
+    }
+
+    PVT_STAT(pvt, sms_submitted)++;
+    sms_submit_done(pvt);
+    sms_submit_run(pvt);
+    return 1;
+}
+
+int sms_submit_failed(struct pvt* pvt, int uid, int cms_error)
+{
+    struct sms_queue* const q    = &pvt->sms_queue;
+    struct sms_submit* const sms = q->active;
+
+    if (!sms || sms->uid != uid) {
+        return 0;
+    }
+
+    if (sms_submit_retryable(cms_error) && sms->attempts <= (unsigned)CONF_SHARED(pvt, msg_retries)) {
+        ast_verb(3, "[%s][SMS:%d] Temporary failure [CMS:%d], message will be sent again\n", PVT_ID(pvt), uid, cms_error);
+        PVT_STAT(pvt, sms_retried)++;
+        q->active         = NULL;
+        pvt->outgoing_sms = 0;
+        AST_LIST_INSERT_HEAD(&q->msgs, sms, entry);
+        sms_submit_run(pvt);
+        return 1;
+    }
+
+    PVT_STAT(pvt, sms_failed)++;
+    sms_submit_done(pvt);
+    sms_submit_run(pvt);
+    return 0;
+}
+
+void sms_submit_reset(struct pvt* pvt)
+{
+    struct sms_queue* const q = &pvt->sms_queue;
+
+    if (!q->active) {
+        return;
+    }
+
+    AST_LIST_INSERT_HEAD(&q->msgs, q->active, entry);
+    q->active = NULL;
+}
+
+void sms_submit_flush(struct pvt* pvt)
+{
+    struct sms_queue* const q = &pvt->sms_queue;
+    struct sms_submit* sms;
+
+    sms_submit_reset(pvt);
+    while ((sms = AST_LIST_REMOVE_HEAD(&q->msgs, entry))) {
+        ast_verb(3, "[%s][SMS:%d] Message dropped\n", PVT_ID(pvt), sms->uid);
+        ast_free(sms);
+    }
+    q->count = 0;
+}
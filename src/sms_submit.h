@@ -0,0 +1,78 @@
+/*
+    sms_submit.h
+*/
+
+#ifndef CHAN_QUECTEL_SMS_SUBMIT_H_INCLUDED
+#define CHAN_QUECTEL_SMS_SUBMIT_H_INCLUDED
+
+#include "ast_config.h"
+
+#include <asterisk/linkedlists.h>
+
+#include "pdu.h" /* pdu_part_t */
+
+/*
+    Outgoing messages are submitted one at a time: module accepts
+    only one AT+CMGS prompt, the next message is handed to AT queue
+    when network accepted or rejected the last part of previous one.
+*/
+
+struct pvt;
+
+struct sms_submit_pdu {
+    size_t tpdu_length;           /*!< length of TPDU in octets, argument of AT+CMGS */
+    size_t length;                /*!< number of hex digits */
+    char hex[PDU_LENGTH * 2 + 1]; /*!< hex encoded PDU */
+};
+
+struct sms_submit {
+    AST_LIST_ENTRY(sms_submit) entry; /*!< linked list pointers */
+    int uid;                          /*!< message id in smsdb */
+    unsigned attempts;                /*!< number of submission attempts */
+    unsigned part;                    /*!< first part not accepted by network yet */
+    unsigned parts;                   /*!< number of parts */
+    struct sms_submit_pdu pdus[0];    /*!< parts of message */
+};
+
+struct sms_queue {
+    AST_LIST_HEAD_NOLOCK(, sms_submit) msgs; /*!< messages waiting for submission */
+    struct sms_submit* active;               /*!< message being submitted */
+    unsigned count;                          /*!< number of waiting and active messages */
+};
+
+struct sms_submit* sms_submit_alloc(const pdu_part_t* pdus, unsigned parts);
+
+/*! \brief Check whether the queue has space for another message */
+int sms_submit_full(const struct pvt* pvt);
+
+/*!
+ * \brief Append message to queue and start submission if module is idle
+ * \return -1 if message could not be handed to AT queue and is not queued, 0 otherwise
+ */
+int sms_submit_add(struct pvt* pvt, struct sms_submit* sms);
+
+/*!
+ * \brief Hand next waiting message to AT queue unless another one is being submitted
+ * \return -1 if message could not be handed to AT queue and remains waiting, 0 otherwise
+ */
+int sms_submit_run(struct pvt* pvt);
+
+/*!
+ * \brief Message part accepted by network
+ * \return 1 if all parts of message are accepted, 0 otherwise
+ */
+int sms_submit_sent(struct pvt* pvt, int uid);
+
+/*!
+ * \brief Message submission failed
+ * \param cms_error -- code of +CMS ERROR, -1 if not known
+ * \return 1 if message is queued again for retry, 0 if it's dropped
+ */
+int sms_submit_failed(struct pvt* pvt, int uid, int cms_error);
+
+/*! \brief Return message being submitted to the head of queue, used on disconnect */
+void sms_submit_reset(struct pvt* pvt);
+
+void sms_submit_flush(struct pvt* pvt);
+
+#endif /* CHAN_QUECTEL_SMS_SUBMIT_H_INCLUDED */
@@ -4,10 +4,13 @@
 
 SET(SOURCES
     app.c
+    at_batch.c
     at_command.c
     at_parse.c
     at_queue.c
+    at_latency.c
     at_read.c
+    at_trace.c
     at_response.c
     chan_quectel.c
     channel.c
@@ -18,10 +21,16 @@ SET(SOURCES
     ringbuffer.c
     cpvt.c
     dc_config.c
+    dev_index.c
+    hotplug.c
+    rate_limit.c
+    rcu.c
     pdu.c
     mixbuffer.c
     error.c
+    escape.c
     smsdb.c
+    sms_submit.c
     monitor_thread.c
     tty.c
     pcm.c
@@ -31,10 +40,13 @@ SET(SOURCES
 
 SET(HEADERS
     app.h
+    at_batch.h
     at_command.h
     at_parse.h
     at_queue.h
+    at_latency.h
     at_read.h
+    at_trace.h
     at_response.h
     chan_quectel.h
     channel.h
@@ -45,10 +57,16 @@ SET(HEADERS
     ringbuffer.h
     cpvt.h
     dc_config.h
+    dev_index.h
+    hotplug.h
+    rate_limit.h
+    rcu.h
     pdu.h
     mixbuffer.h
     error.h
+    escape.h
     smsdb.h
+    sms_submit.h
     mutils.h
     gsm7_luts.h
     ast_config.h
@@ -0,0 +1,92 @@
+/* build with Asterisk headers: gcc -I../src batch.c */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "at_batch.h"			/* at_batch_recorded() */
+
+#define ITEMS_OF(x) (sizeof(x) / sizeof((x)[0]))
+
+int ok = 0;
+int faults = 0;
+
+/* lines read from device while commands of batch are current */
+struct line {
+	unsigned	cindex;
+	at_res_t	res;
+	const char	* text;
+};
+
+/* collect recorded lines of command to "response" JSON array as at_batch_response() does */
+static const char * response_json(char * buf, size_t size, const struct line * lines, unsigned count, unsigned cindex)
+{
+	size_t len = snprintf(buf, size, "[");
+
+	for(unsigned i = 0; i < count && len < size; ++i) {
+		if(lines[i].cindex != cindex || !at_batch_recorded(lines[i].res, lines[i].text)) {
+			continue;
+		}
+		len += snprintf(buf + len, size - len, "%s\"%s\"", buf[len - 1] == '[' ? "" : ", ", lines[i].text);
+	}
+	if(len < size) {
+		snprintf(buf + len, size - len, "]");
+	}
+	return buf;
+}
+
+static void check_response(const char * name, const struct line * lines, unsigned count, unsigned cindex, const char * expected)
+{
+	char buf[256];
+	const char * res = response_json(buf, sizeof(buf), lines, count, cindex);
+	const int cond = !strcmp(res, expected);
+
+	fprintf(stderr, "%s: %s...\t%s\n", name, res, cond ? "OK" : "FAIL");
+	if(cond) {
+		ok++;
+	} else {
+		faults++;
+	}
+}
+
+#/* */
+void test_batch_response()
+{
+	/* AT+CSQ;+CGMI;+CPIN?;+CMGF=2;+CUSD=1,"*100#" */
+	static const struct line lines[] = {
+		{ 0, RES_CSQ, "+CSQ: 20,99" },
+		{ 0, RES_RING, "RING" },
+		{ 0, RES_OK, "OK" },
+		{ 1, RES_CMTI, "+CMTI: \"ME\",3" },
+		{ 1, RES_UNKNOWN, "Quectel" },
+		{ 1, RES_CREG, "+CREG: 1" },
+		{ 1, RES_QIND, "+QIND: \"csq\",21,99" },
+		{ 1, RES_OK, "OK" },
+		{ 2, RES_DSCI, "^DSCI: 1,0,2,0,+79990000000,145" },
+		{ 2, RES_CPIN, "+CPIN: READY" },
+		{ 2, RES_UNKNOWN, "" },
+		{ 2, RES_OK, "OK" },
+		{ 3, RES_UNKNOWN, "+CME ERROR: 3" },
+		{ 4, RES_CUSD, "+CUSD: 0,\"Balance\",15" },
+		{ 4, RES_ERROR, "ERROR" },
+	};
+
+	check_response("information response", lines, ITEMS_OF(lines), 0, "[\"+CSQ: 20,99\"]");
+	check_response("unsolicited responses skipped", lines, ITEMS_OF(lines), 1, "[\"Quectel\"]");
+	check_response("empty lines skipped", lines, ITEMS_OF(lines), 2, "[\"+CPIN: READY\"]");
+	check_response("+CME ERROR skipped", lines, ITEMS_OF(lines), 3, "[]");
+	check_response("result codes skipped", lines, ITEMS_OF(lines), 4, "[]");
+	fprintf(stderr, "\n");
+}
+
+#/* */
+int main()
+{
+	test_batch_response();
+
+	fprintf(stderr, "done %d tests: %d OK %d FAILS\n", ok + faults, ok, faults);
+
+	if (faults) {
+		return 1;
+	}
+	return 0;
+}
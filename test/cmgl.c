@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ast_config.h"
+
+#include <asterisk/strings.h>
+
+#include "at_parse.h"			/* at_parse_cmgl() */
+#include "at_read.h"			/* at_read_result_iov() */
+#include "ringbuffer.h"
+#include "mutils.h"			/* ITEMS_OF() */
+
+/*
+ * Replay +CMGL response of a full SIM card through the reader in small chunks
+ * the same way monitor thread does and decode every entry.
+ */
+
+#define SIM_MESSAGES 255
+#define RB_SIZE (2 * 1024)		/* same as monitor thread */
+
+static const char PDU[] = "07911111111100F3040B911111111111F200000121702214952163B1582C168BC562B1984C2693C96432994C369BCD66B3D96C369BD168341A8D46A3D168B55AAD56ABD56AB59ACD66B3D96C369BCD76BBDD6EB7DBED76BBE170381C0E87C3E170B95C2E97CBE572B91C0C0683C16030180C";
+static const char OA[] = "+11111111112";
+static const char TEXT[] = "111111111122222222223333333333444444444455555555556666666666777777777788888888889999999999000000000";
+
+int ok = 0;
+int faults = 0;
+
+/* We call ast_log from pdu.c, so we'll fake an implementation here. */
+void ast_log(int level, const char* file, int line, const char* function, const char* fmt, ...)
+{
+	/* Silence compiler warnings */
+	(void)level;
+	(void)file;
+	(void)line;
+	(void)function;
+	(void)fmt;
+}
+
+static void check(int cond, const char * what, int idx)
+{
+	if (cond) {
+		ok++;
+	} else {
+		faults++;
+		fprintf(stderr, "/* %d */ %s FAIL\n", idx, what);
+	}
+}
+
+static size_t build_dump(char * buf, size_t size)
+{
+	size_t len = 0;
+
+	for (int i = 0; i < SIM_MESSAGES; ++i) {
+		len += snprintf(buf + len, size - len, "\r\n+CMGL: %d,1,,106\r\n%s", i, PDU);
+	}
+	len += snprintf(buf + len, size - len, "\r\n\r\nOK\r\n");
+	return len;
+}
+
+#/* */
+int main()
+{
+	static char dump[SIM_MESSAGES * 300];
+	static char rb_buf[RB_SIZE];
+
+	struct ringbuffer rb;
+	struct iovec iov[2];
+	struct ast_str * result = ast_str_create(RB_SIZE);
+	char oa[200], sca[200], msg[4096];
+	int read_result = 0, entries = 0, oks = 0;
+	size_t skip = 0, pos = 0, peak = 0;
+	struct timespec start, stop;
+
+	const size_t len = build_dump(dump, sizeof(dump));
+
+	rb_init(&rb, rb_buf, sizeof(rb_buf));
+	srand(1);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (pos < len) {
+		/* chunks of random size as returned by read() from tty */
+		size_t chunk = 1 + rand() % 96;
+		if (chunk > len - pos) {
+			chunk = len - pos;
+		}
+		if (chunk > rb_free(&rb)) {
+			fprintf(stderr, "ring buffer overflow at %zu\n", pos);
+			faults++;
+			break;
+		}
+		rb_write(&rb, dump + pos, chunk);
+		pos += chunk;
+		if (rb_used(&rb) > peak) {
+			peak = rb_used(&rb);
+		}
+
+		int iovcnt;
+		while ((iovcnt = at_read_result_iov("test", &read_result, &skip, &rb, iov, result)) > 0) {
+			const size_t rlen = at_combine_iov(result, iov, iovcnt);
+			rb_read_upd(&rb, rlen + skip);
+			skip = 0;
+			if (!rlen) {
+				continue;
+			}
+
+			char * const str = ast_str_buffer(result);
+			if (!strncmp(str, "+CMGL:", 6)) {
+				struct ast_tm scts, dt;
+				pdu_udh_t udh;
+				int idx = -1, tpdu_type, mr, st;
+				size_t msg_len = sizeof(msg);
+
+				pdu_udh_init(&udh);
+				const int res = at_parse_cmgl(str, rlen, &idx, &tpdu_type, sca, sizeof(sca), oa, sizeof(oa), &scts, &mr, &st, &dt, msg, &msg_len, &udh);
+				check(res == 0 && idx == entries && !strcmp(oa, OA) && !strcmp(msg, TEXT), "at_parse_cmgl", entries);
+				entries++;
+			} else if (!strcmp(str, "OK")) {
+				oks++;
+			}
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	const double usec = (stop.tv_sec - start.tv_sec) * 1e6 + (stop.tv_nsec - start.tv_nsec) / 1e3;
+
+	check(entries == SIM_MESSAGES, "entries", entries);
+	check(oks == 1, "final OK", oks);
+	/* every entry is consumed as soon as its PDU line is complete */
+	check(peak < 2 * (sizeof(PDU) + 32), "peak buffer usage", (int)peak);
+
+	fprintf(stderr, "%d entries from %zu bytes in %.0f usec, peak buffer usage %zu bytes\n", entries, len, usec, peak);
+	fprintf(stderr, "done %d tests: %d OK %d FAILS\n", ok + faults, ok, faults);
+
+	ast_free(result);
+
+	if (faults) {
+		return 1;
+	}
+	return 0;
+}
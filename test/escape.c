@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "escape.h"			/* escape_c() */
+
+#define ITEMS_OF(x) (sizeof(x) / sizeof((x)[0]))
+
+int ok = 0;
+int faults = 0;
+
+static volatile int debug_level = 0;
+static volatile size_t sink = 0;
+
+#define bench_debug(level, ...) do { if (debug_level >= (level)) { sink += strlen(__VA_ARGS__); } } while (0)
+
+/* previous implementation: zero-terminated copy on heap, strchr() lookup per character */
+static char escape_sequences[] = { 0x1A, 0x1B, '\a', '\b', '\f', '\n', '\r', '\t', '\v', '\0' };
+static char escape_sequences_map[] = { 'z', 'e', 'a', 'b', 'f', 'n', 'r', 't', 'v', '\0' };
+
+static const char * escape_old(char * dest, const char * buf, size_t len)
+{
+	char * s = malloc(len + 1);
+	char * p = dest;
+	size_t size = len * 2 + 1;
+	const char * c;
+	const char * i;
+
+	memcpy(s, buf, len);
+	s[len] = 0;
+	for(i = s; *i && --size; ++i, ++p) {
+		c = strchr(escape_sequences, *i);
+		if(c) {
+			if(!--size)
+				break;
+			*p++ = '\\';
+			*p = escape_sequences_map[c - escape_sequences];
+		} else {
+			*p = *i;
+		}
+	}
+	*p = 0;
+	free(s);
+	return dest;
+}
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#/* */
+void test_escape_c()
+{
+	static const struct test_case {
+		const char	* input;
+		size_t		len;
+		size_t		size;
+		const char	* result;
+	} cases[] = {
+		{ "AT\r", 3, 16, "AT\\r" },
+		{ "\r\nOK\r\n", 6, 16, "\\r\\nOK\\r\\n" },
+		{ "0011\x1a", 5, 16, "0011\\z" },
+		{ "A\0B", 3, 16, "A\\0B" },
+		{ "ABC\r", 4, 5, "ABC" },
+		{ "", 0, 4, "" },
+	};
+	unsigned idx = 0;
+	char buf[64];
+	const char * msg;
+
+	for(; idx < ITEMS_OF(cases); ++idx) {
+		escape_c(buf, cases[idx].size, cases[idx].input, cases[idx].len);
+		fprintf(stderr, "%s(#%u)...", "escape_c", idx);
+		if(strcmp(buf, cases[idx].result) == 0) {
+			msg = "OK";
+			ok++;
+		} else {
+			msg = "FAIL";
+			faults++;
+		}
+		fprintf(stderr, " = \"%s\"\t%s\n", buf, msg);
+	}
+	fprintf(stderr, "\n");
+}
+
+#/* */
+/* shipped escape_c() against previous implementation, both into caller's buffer */
+void bench_escape()
+{
+	static const char response[] = "\r\n+CMGL: 1,0,,24\r\n07919730071111F1040B919701119905F80000211062320020800341E110\r\n\r\nOK\r\n";
+	static const unsigned loops = 1000000;
+	char dest[sizeof(response) * 2 + 1];
+	unsigned i;
+	double start;
+
+	for(debug_level = 0; debug_level <= 5; debug_level += 5) {
+		start = now();
+		for(i = 0; i < loops; ++i)
+			bench_debug(5, escape_old(dest, response, sizeof(response) - 1));
+		fprintf(stderr, "debug %d, heap copy + strchr()   : %7.1f ns/call\n", debug_level, (now() - start) / loops);
+
+		start = now();
+		for(i = 0; i < loops; ++i)
+			bench_debug(5, (escape_c(dest, sizeof(dest), response, sizeof(response) - 1), dest));
+		fprintf(stderr, "debug %d, escape_c()             : %7.1f ns/call\n", debug_level, (now() - start) / loops);
+	}
+	fprintf(stderr, "\n");
+}
+
+#/* */
+int main()
+{
+	test_escape_c();
+	bench_escape();
+
+	fprintf(stderr, "done %d tests: %d OK %d FAILS\n", ok + faults, ok, faults);
+
+	if (faults) {
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,272 @@
+#include <arpa/inet.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hotplug.h"			/* hotplug_*() */
+
+#define ITEMS_OF(x) (sizeof(x) / sizeof((x)[0]))
+
+int ok = 0;
+int faults = 0;
+
+/* We call ast_log from hotplug.c, so we'll fake an implementation here. */
+void ast_log(int level, const char* fmt, ...)
+{
+    /* Silence compiler warnings */
+    (void)level;
+    (void)fmt;
+}
+
+/* layout of header of uevent sent by udev */
+struct udev_header {
+	char		prefix[8];
+	uint32_t	magic;
+	uint32_t	header_size;
+	uint32_t	properties_off;
+	uint32_t	properties_len;
+	uint32_t	filter[4];
+};
+
+#define UDEV_MAGIC 0xfeedcafe
+
+/* message and its length without terminating zero of literal */
+#define MSG(s) (s), (sizeof(s) - 1)
+
+static const char KERNEL_ADD[] = "add@/devices/pci0000:00/usb1/1-1/1-1:1.2/ttyUSB2/tty/ttyUSB2\0ACTION=add\0DEVPATH=/devices/pci0000:00/usb1/1-1/1-1:1.2/ttyUSB2/tty/ttyUSB2\0SUBSYSTEM=tty\0MAJOR=188\0MINOR=2\0DEVNAME=ttyUSB2\0SEQNUM=4242";
+static const char KERNEL_REMOVE[] = "remove@/devices/pci0000:00/usb1/1-1/1-1:1.2/ttyUSB2/tty/ttyUSB2\0ACTION=remove\0SUBSYSTEM=tty\0DEVNAME=ttyUSB2\0SEQNUM=4243";
+static const char KERNEL_USB[] = "add@/devices/pci0000:00/usb1/1-1\0ACTION=add\0SUBSYSTEM=usb\0DEVNAME=bus/usb/001/002\0DEVTYPE=usb_device";
+static const char UDEV_PROPS[] = "ACTION=add\0DEVPATH=/devices/pci0000:00/usb1/1-1/1-1:1.2/ttyUSB2/tty/ttyUSB2\0SUBSYSTEM=tty\0DEVNAME=/dev/ttyUSB2\0DEVLINKS=/dev/serial/by-id/usb-Quectel_EC25-if02-port0 /dev/quectel0\0SEQNUM=4242";
+
+/* build uevent in buffer of len + 1 bytes, as received from socket */
+static size_t make_kernel(char * buf, const char * msg, size_t len)
+{
+	memcpy(buf, msg, len);
+	buf[len] = '\0';
+	return len;
+}
+
+static size_t make_udev(char * buf, uint32_t magic, uint32_t off, uint32_t len)
+{
+	struct udev_header hdr;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.prefix, "libudev", 8);
+	hdr.magic = htonl(magic);
+	hdr.header_size = sizeof(hdr);
+	hdr.properties_off = off;
+	hdr.properties_len = len;
+
+	memcpy(buf, &hdr, sizeof(hdr));
+	memcpy(buf + sizeof(hdr), UDEV_PROPS, sizeof(UDEV_PROPS));
+	buf[sizeof(hdr) + sizeof(UDEV_PROPS)] = '\0';
+	return sizeof(hdr) + sizeof(UDEV_PROPS);
+}
+
+static const char * str_or_null(const char * str)
+{
+	return str ? str : "(null)";
+}
+
+static int str_eq(const char * a, const char * b)
+{
+	if(!a || !b) {
+		return a == b;
+	}
+	return strcmp(a, b) == 0;
+}
+
+#/* */
+void test_hotplug_parse()
+{
+	static const struct test_case {
+		const char	* name;
+		int		kind;		/* 0 - kernel, 1 - udev */
+		const char	* msg;
+		size_t		len;
+		uint32_t	magic;
+		uint32_t	off;
+		uint32_t	plen;
+		int		res;
+		const char	* action;
+		const char	* subsystem;
+		const char	* devname;
+		const char	* devlinks;
+	} cases[] = {
+		{ "kernel add", 0, KERNEL_ADD, sizeof(KERNEL_ADD), 0, 0, 0, 0, "add", "tty", "ttyUSB2", NULL },
+		{ "kernel remove", 0, KERNEL_REMOVE, sizeof(KERNEL_REMOVE), 0, 0, 0, 0, "remove", "tty", "ttyUSB2", NULL },
+		{ "kernel usb", 0, KERNEL_USB, sizeof(KERNEL_USB), 0, 0, 0, 0, "add", "usb", "bus/usb/001/002", NULL },
+		{ "kernel last property not terminated", 0, KERNEL_REMOVE, sizeof(KERNEL_REMOVE) - 1, 0, 0, 0, 0, "remove", "tty", "ttyUSB2", NULL },
+		{ "kernel truncated header", 0, KERNEL_ADD, 20, 0, 0, 0, -1, NULL, NULL, NULL, NULL },
+		{ "kernel without @", 0, MSG("ACTION=add\0SUBSYSTEM=tty\0DEVNAME=ttyUSB2"), 0, 0, 0, -1, NULL, NULL, NULL, NULL },
+		{ "kernel without action", 0, MSG("add@/devices/x\0SUBSYSTEM=tty\0DEVNAME=ttyUSB2"), 0, 0, 0, -1, NULL, NULL, NULL, NULL },
+		{ "kernel without subsystem", 0, MSG("add@/devices/x\0ACTION=add\0DEVNAME=ttyUSB2"), 0, 0, 0, -1, NULL, NULL, NULL, NULL },
+		{ "kernel truncated properties", 0, KERNEL_ADD, 90, 0, 0, 0, -1, NULL, NULL, NULL, NULL },
+		{ "kernel empty", 0, MSG(""), 0, 0, 0, -1, NULL, NULL, NULL, NULL },
+		{ "udev add", 1, NULL, 0, UDEV_MAGIC, sizeof(struct udev_header), sizeof(UDEV_PROPS), 0, "add", "tty", "/dev/ttyUSB2",
+			"/dev/serial/by-id/usb-Quectel_EC25-if02-port0 /dev/quectel0" },
+		{ "udev bad magic", 1, NULL, 0, 0xdeadbeef, sizeof(struct udev_header), sizeof(UDEV_PROPS), -1, NULL, NULL, NULL, NULL },
+		{ "udev properties inside header", 1, NULL, 0, UDEV_MAGIC, 8, sizeof(UDEV_PROPS), -1, NULL, NULL, NULL, NULL },
+		{ "udev properties beyond message", 1, NULL, 0, UDEV_MAGIC, 4096, sizeof(UDEV_PROPS), -1, NULL, NULL, NULL, NULL },
+		{ "udev properties too long", 1, NULL, 0, UDEV_MAGIC, sizeof(struct udev_header), sizeof(UDEV_PROPS) + 1, -1, NULL, NULL, NULL, NULL },
+		{ "udev properties length overflow", 1, NULL, 0, UDEV_MAGIC, sizeof(struct udev_header), 0xffffffff, -1, NULL, NULL, NULL, NULL },
+		{ "udev truncated header", 1, NULL, 20, UDEV_MAGIC, sizeof(struct udev_header), sizeof(UDEV_PROPS), -1, NULL, NULL, NULL, NULL },
+	};
+	unsigned idx = 0;
+	char buf[1024];
+	size_t len;
+	struct hotplug_event ev;
+	int res;
+	const char * msg;
+
+	for(; idx < ITEMS_OF(cases); ++idx) {
+		if(cases[idx].kind) {
+			len = make_udev(buf, cases[idx].magic, cases[idx].off, cases[idx].plen);
+			if(cases[idx].len) {
+				len = cases[idx].len;
+				buf[len] = '\0';
+			}
+		} else {
+			len = make_kernel(buf, cases[idx].msg, cases[idx].len);
+		}
+
+		fprintf(stderr, "%s(\"%s\")...", "hotplug_parse", cases[idx].name);
+		res = hotplug_parse(buf, len, &ev);
+		if(res == cases[idx].res && (res || (str_eq(ev.action, cases[idx].action) && str_eq(ev.subsystem, cases[idx].subsystem) &&
+			str_eq(ev.devname, cases[idx].devname) && str_eq(ev.devlinks, cases[idx].devlinks)))) {
+			msg = "OK";
+			ok++;
+		} else {
+			msg = "FAIL";
+			faults++;
+		}
+		if(res) {
+			fprintf(stderr, " = %d\t%s\n", res, msg);
+		} else {
+			fprintf(stderr, " = %d %s %s %s [%s]\t%s\n", res, str_or_null(ev.action), str_or_null(ev.subsystem), str_or_null(ev.devname),
+				str_or_null(ev.devlinks), msg);
+		}
+	}
+	fprintf(stderr, "\n");
+}
+
+#/* */
+void test_hotplug_match()
+{
+	static const struct test_case {
+		const char	* devname;
+		const char	* devlinks;
+		const char	* path;
+		const char	* resolved;
+		int		result;
+	} cases[] = {
+		{ "ttyUSB2", NULL, "/dev/ttyUSB2", "", 1 },
+		{ "/dev/ttyUSB2", NULL, "/dev/ttyUSB2", "", 1 },
+		{ "ttyUSB2", NULL, "/dev/ttyUSB3", "", 0 },
+		{ "ttyUSB2", NULL, "/dev/ttyUSB", "", 0 },
+		{ "ttyUSB2", NULL, "", "", 0 },
+		{ NULL, NULL, "/dev/ttyUSB2", "", 0 },
+		{ "/dev/ttyUSB2", "/dev/serial/by-id/usb-Quectel_EC25-if02-port0 /dev/quectel0", "/dev/quectel0", "", 1 },
+		{ "/dev/ttyUSB2", "/dev/serial/by-id/usb-Quectel_EC25-if02-port0 /dev/quectel0", "/dev/serial/by-id/usb-Quectel_EC25-if02-port0", "", 1 },
+		{ "/dev/ttyUSB2", "/dev/serial/by-id/usb-Quectel_EC25-if02-port0 /dev/quectel0", "/dev/quectel", "", 0 },
+		{ "/dev/ttyUSB2", "/dev/quectel0", "/dev/quectel00", "", 0 },
+		/* kernel remove event of symlinked port, symlink is gone, node cached on start */
+		{ "ttyUSB2", NULL, "/dev/quectel-missing", "/dev/ttyUSB2", 1 },
+		{ "ttyUSB3", NULL, "/dev/quectel-missing", "/dev/ttyUSB2", 0 },
+	};
+	unsigned idx = 0;
+	struct hotplug_event ev;
+	int res;
+	const char * msg;
+
+	for(; idx < ITEMS_OF(cases); ++idx) {
+		memset(&ev, 0, sizeof(ev));
+		ev.action = "remove";
+		ev.subsystem = "tty";
+		ev.devname = cases[idx].devname;
+		ev.devlinks = cases[idx].devlinks;
+
+		fprintf(stderr, "%s(\"%s\", \"%s\", \"%s\")...", "hotplug_match", str_or_null(cases[idx].devname), cases[idx].path, cases[idx].resolved);
+		res = hotplug_match(&ev, cases[idx].path, cases[idx].resolved);
+		if(res == cases[idx].result) {
+			msg = "OK";
+			ok++;
+		} else {
+			msg = "FAIL";
+			faults++;
+		}
+		fprintf(stderr, " = %d\t%s\n", res, msg);
+	}
+	fprintf(stderr, "\n");
+}
+
+/* symlink to existing node is resolved, after symlink disappears only cached node matches */
+#/* */
+void test_hotplug_symlink()
+{
+	char dir[] = "/tmp/hotplug-test-XXXXXX";
+	char link[sizeof(dir) + 8];
+	char node[256];
+	struct hotplug_event ev;
+	const char * msg;
+	int res[5];
+
+	if(!mkdtemp(dir)) {
+		fprintf(stderr, "mkdtemp() failed\n");
+		faults++;
+		return;
+	}
+	snprintf(link, sizeof(link), "%s/data", dir);
+
+	memset(&ev, 0, sizeof(ev));
+	ev.subsystem = "tty";
+	ev.devname = "null";
+
+	res[0] = symlink("/dev/null", link) == 0;
+
+	ev.action = "add";
+	res[1] = hotplug_match(&ev, link, "") == 1;
+
+	hotplug_resolve(link, node, sizeof(node));
+	res[2] = strcmp(node, "/dev/null") == 0;
+
+	unlink(link);
+	ev.action = "remove";
+	res[3] = hotplug_match(&ev, link, "") == 0 && hotplug_match(&ev, link, node) == 1;
+
+	hotplug_resolve(link, node, sizeof(node));
+	res[4] = node[0] == '\0';
+
+	rmdir(dir);
+
+	for(unsigned i = 0; i < ITEMS_OF(res); ++i) {
+		static const char * const names[] = {
+			"symlink created", "symlink resolved on add", "node cached", "removal matched by cached node", "missing path resolved to empty" };
+		if(res[i]) {
+			msg = "OK";
+			ok++;
+		} else {
+			msg = "FAIL";
+			faults++;
+		}
+		fprintf(stderr, "%s(\"%s\")...\t%s\n", "hotplug_symlink", names[i], msg);
+	}
+	fprintf(stderr, "\n");
+}
+
+#/* */
+int main()
+{
+	test_hotplug_parse();
+	test_hotplug_match();
+	test_hotplug_symlink();
+
+	fprintf(stderr, "done %d tests: %d OK %d FAILS\n", ok + faults, ok, faults);
+
+	if (faults) {
+		return 1;
+	}
+	return 0;
+}
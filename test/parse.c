@@ -165,6 +165,36 @@ void test_parse_cmti()
 	fprintf(stderr, "\n");
 }
 
+#/* */
+void test_parse_cms_error()
+{
+	static const struct test_case {
+		const char	* input;
+		int		result;
+	} cases[] = {
+		{ "+CMS ERROR: 42", 42 },
+		{ "+CMS ERROR:500", 500 },
+		{ "+CMS ERROR: Network timeout", -1 },
+	};
+	unsigned idx = 0;
+	int result;
+	const char * msg;
+
+	for(; idx < ITEMS_OF(cases); ++idx) {
+		fprintf(stderr, "%s(\"%s\")...", "at_parse_cms_error", cases[idx].input);
+		result = at_parse_cms_error(cases[idx].input);
+		if(result == cases[idx].result) {
+			msg = "OK";
+			ok++;
+		} else {
+			msg = "FAIL";
+			faults++;
+		}
+		fprintf(stderr, " = %d\t%s\n", result, msg);
+	}
+	fprintf(stderr, "\n");
+}
+
 int safe_strcmp(const char *a, const char *b)
 {
 	if (a == NULL && b == NULL) {
@@ -467,6 +497,7 @@ int main()
 	test_parse_cops();
 	test_parse_creg();
 	test_parse_cmti();
+	test_parse_cms_error();
 	test_parse_cmgr();
 	test_parse_cusd();
 	test_parse_cpin();
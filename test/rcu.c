@@ -0,0 +1,179 @@
+/* run also built with -fsanitize=address and -fsanitize=thread: gcc -pthread -I../src rcu.c ../src/rcu.c */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rcu.h"			/* rcu_*() */
+
+#define READERS 4
+#define NODES 8
+#define ROUNDS 2000
+
+#define NODE_ALIVE 0x600DF00Du
+#define NODE_POISON 0xDB
+
+int ok = 0;
+int faults = 0;
+
+struct node {
+	unsigned	magic;
+	unsigned	value;
+	struct node	* next;
+};
+
+static struct rcu rcu;
+static struct node * head;
+static int stop;
+static int poisoned;			/* nodes seen freed by readers, atomic */
+static int walks;			/* completed list walks, atomic */
+
+static void check(const char * name, int cond)
+{
+	fprintf(stderr, "%s...\t%s\n", name, cond ? "OK" : "FAIL");
+	if(cond) {
+		ok++;
+	} else {
+		faults++;
+	}
+}
+
+static struct node * node_alloc(unsigned value)
+{
+	struct node * node = malloc(sizeof(*node));
+
+	node->magic = NODE_ALIVE;
+	node->value = value;
+	node->next = NULL;
+	return node;
+}
+
+#/* */
+static void * reader_proc(void * arg)
+{
+	(void)arg;
+
+	while(!__atomic_load_n(&stop, __ATOMIC_ACQUIRE)) {
+		const unsigned token = rcu_read_lock(&rcu);
+		for(const struct node * node = __atomic_load_n(&head, __ATOMIC_ACQUIRE); node; node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) {
+			if(node->magic != NODE_ALIVE) {
+				__atomic_fetch_add(&poisoned, 1, __ATOMIC_RELAXED);
+				break;
+			}
+		}
+		rcu_read_unlock(&rcu, token);
+		__atomic_fetch_add(&walks, 1, __ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+#/* */
+/* writer unlinks node after head, waits for grace period, poisons and frees it, then links new node */
+void test_rcu_readers()
+{
+	pthread_t readers[READERS];
+	unsigned next = 0;
+
+	rcu_init(&rcu);
+	for(; next < NODES; ++next) {
+		struct node * node = node_alloc(next);
+		node->next = head;
+		head = node;
+	}
+
+	for(unsigned i = 0; i < READERS; ++i) {
+		pthread_create(&readers[i], NULL, reader_proc, NULL);
+	}
+
+	for(unsigned round = 0; round < ROUNDS; ++round, ++next) {
+		struct node * const prev = head;
+		struct node * const victim = prev->next;
+
+		__atomic_store_n(&prev->next, victim->next, __ATOMIC_RELEASE);
+		rcu_synchronize(&rcu);
+		memset(victim, NODE_POISON, sizeof(*victim));
+		free(victim);
+
+		struct node * const node = node_alloc(next);
+		node->next = head;
+		__atomic_store_n(&head, node, __ATOMIC_RELEASE);
+	}
+
+	__atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+	for(unsigned i = 0; i < READERS; ++i) {
+		pthread_join(readers[i], NULL);
+	}
+
+	fprintf(stderr, "%d walks, %d grace periods\n", __atomic_load_n(&walks, __ATOMIC_RELAXED), rcu.grace_periods);
+	check("no freed node seen by readers", __atomic_load_n(&poisoned, __ATOMIC_RELAXED) == 0);
+	check("grace period per removal", rcu.grace_periods == ROUNDS);
+	check("no readers left", rcu_readers(&rcu) == 0);
+	check("sections counted", rcu_sections(&rcu) == __atomic_load_n(&walks, __ATOMIC_RELAXED));
+
+	while(head) {
+		struct node * const node = head;
+		head = node->next;
+		free(node);
+	}
+	fprintf(stderr, "\n");
+}
+
+#/* */
+/* section left by holder thread, atomic */
+static int section_left;
+
+static void * holder_proc(void * arg)
+{
+	int * const entered = arg;
+	const unsigned token = rcu_read_lock(&rcu);
+
+	__atomic_store_n(entered, 1, __ATOMIC_RELEASE);
+	usleep(50000);
+	__atomic_store_n(&section_left, 1, __ATOMIC_RELEASE);
+	rcu_read_unlock(&rcu, token);
+	return NULL;
+}
+
+void test_rcu_synchronize()
+{
+	pthread_t holder;
+	int entered = 0;
+
+	rcu_init(&rcu);
+	pthread_create(&holder, NULL, holder_proc, &entered);
+	while(!__atomic_load_n(&entered, __ATOMIC_ACQUIRE)) {
+		usleep(1000);
+	}
+
+	rcu_synchronize(&rcu);
+	check("grace period waits for section entered before", __atomic_load_n(&section_left, __ATOMIC_ACQUIRE) == 1);
+	pthread_join(holder, NULL);
+
+	/* nested sections of one thread */
+	const unsigned outer = rcu_read_lock(&rcu);
+	const unsigned inner = rcu_read_lock(&rcu);
+	check("nested sections are counted", rcu_readers(&rcu) == 2);
+	rcu_read_unlock(&rcu, inner);
+	rcu_read_unlock(&rcu, outer);
+	check("nested sections are left", rcu_readers(&rcu) == 0);
+
+	rcu_synchronize(&rcu);
+	check("grace period without readers", rcu.grace_periods == 2);
+	fprintf(stderr, "\n");
+}
+
+#/* */
+int main()
+{
+	test_rcu_synchronize();
+	test_rcu_readers();
+
+	fprintf(stderr, "done %d tests: %d OK %d FAILS\n", ok + faults, ok, faults);
+
+	if (faults) {
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,920 @@
+/*
+   fake-modem: pseudo-terminal based AT modem emulator.
+
+   Opens one or more pseudo-terminals and answers AT commands according
+   to a script, so that the channel driver (monitor thread, AT queue and
+   response parser) can be exercised without real hardware.
+
+   Build:
+        cc -O2 -Wall -o fake-modem fake-modem.c
+
+   Usage:
+        fake-modem [options] <script>
+
+        -n <count>      number of fake modems to create (default 1)
+        -l <prefix>     create symlinks <prefix>0, <prefix>1, ... to pty slaves
+        -S              sequential mode: replay script as a captured dialog
+        -d <ms>         delay before first reply to a command (default 0)
+        -c <bytes>      split replies into chunks of given size (default 0 - no split)
+        -i <ms>         delay between chunks (default 1)
+        -e              answer ERROR instead of OK to unknown commands
+        -r <sec>        print statistics every <sec> seconds (default 0 - on exit only)
+        -v              print received commands and sent replies
+        -t              script is a binary AT trace dumped by 'quectel trace dump', implies -S
+        -T              with -t keep original timing of received data
+        -m <command>    report time, command lines and commands from first command
+                        until command matching given prefix is received
+        -M <count>      with -m also report rate of matching commands every <count> matches
+
+   Script format (one item per line):
+
+        # comment
+        > AT+CSQ        command expected from host, prefix match, '*' matches any command
+        < +CSQ: 20,99   reply line, sent as "\r\n+CSQ: 20,99\r\n"
+        << \r\n> \x20   raw reply, C-like escapes \r \n \t \\ \xHH are supported
+        @ 250           delay in milliseconds before next reply
+
+   In table mode (default) each '>' item starts a rule, replies following it
+   are sent whenever a matching command is received. Replies before the
+   first rule are sent once after pty creation. Command line with several
+   commands ("AT+CGMI;+CGMM") is answered command by command with single
+   final result, the rest of the line is skipped after an error.
+
+   In sequential mode (-S) the script is walked from top to bottom: replies
+   are sent as they appear, '>' items block until the host sends matching
+   command. Commands received out of script order are answered with default
+   reply and do not advance script position.
+
+   Binary trace (-t) is converted to sequential script: data written by the
+   driver becomes expected commands, data read by the driver becomes raw
+   replies, chunked exactly as they were received from real modem.
+
+   Statistics include number of commands, replies and turnaround latency -
+   time from last byte of reply written by fake modem to next command
+   received from host, i.e. latency of the whole host side AT pipeline.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <endian.h>
+
+#define MAX_MODEMS 256
+#define MAX_LINE 4096
+
+/* see src/at_trace.h */
+#define AT_TRACE_MAGIC "QATR"
+#define AT_TRACE_VERSION 1
+#define AT_TRACE_RX 0
+
+struct at_trace_file_header {
+    char magic[4];
+    uint32_t version;
+} __attribute__((packed));
+
+struct at_trace_record {
+    uint32_t sec;
+    uint32_t usec;
+    uint16_t length;
+    uint8_t dir;
+    uint8_t reserved;
+} __attribute__((packed));
+
+typedef enum {
+    STEP_EXPECT,
+    STEP_REPLY,
+    STEP_RAW,
+    STEP_DELAY,
+} step_type_t;
+
+struct step {
+    step_type_t type;
+    unsigned lineno;
+    unsigned delay; /*!< delay in ms for STEP_DELAY */
+    size_t len;
+    char* data;
+};
+
+struct script {
+    struct step* steps;
+    size_t count;
+};
+
+struct segment {
+    struct segment* next;
+    uint64_t due; /*!< monotonic time in us when segment may be written */
+    size_t len;
+    size_t off;
+    char data[0];
+};
+
+struct modem_stat {
+    unsigned long lines;
+    unsigned long commands;
+    unsigned long unmatched;
+    unsigned long replies;
+    unsigned long long rx_bytes;
+    unsigned long long tx_bytes;
+    unsigned long lat_count;
+    uint64_t lat_sum;
+    uint64_t lat_min;
+    uint64_t lat_max;
+};
+
+struct modem {
+    unsigned idx;
+    int master;
+    int slave;
+    char path[64];
+    char link[256];
+    size_t pos; /*!< script position in sequential mode */
+    char line[MAX_LINE];
+    size_t line_len;
+    struct segment* out_head;
+    struct segment* out_tail;
+    uint64_t out_due;    /*!< due time for next queued segment */
+    uint64_t last_reply; /*!< time when last reply was completely written */
+    uint64_t first_cmd;  /*!< time when first command was received */
+    unsigned long marks; /*!< number of mark commands received */
+    uint64_t first_mark; /*!< time when first mark command was received */
+    struct modem_stat stat;
+};
+
+static struct script script;
+static struct modem modems[MAX_MODEMS];
+static unsigned modems_count = 1;
+
+static int sequential      = 0;
+static unsigned reply_delay = 0;
+static size_t chunk_size    = 0;
+static unsigned chunk_delay = 1;
+static int default_error    = 0;
+static unsigned report_sec  = 0;
+static int verbose          = 0;
+static int trace_input      = 0;
+static int trace_timing     = 0;
+static const char* link_prefix;
+static const char* mark_cmd;
+static unsigned long mark_every = 0;
+
+static volatile sig_atomic_t stop_requested = 0;
+static volatile sig_atomic_t stat_requested = 0;
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+#/* decode C-like escapes in place, return new length */
+
+static size_t unescape(char* str)
+{
+    char* out = str;
+    char* in  = str;
+
+    while (*in) {
+        if (*in != '\\' || !in[1]) {
+            *out++ = *in++;
+            continue;
+        }
+
+        ++in;
+        switch (*in) {
+            case 'r':
+                *out++ = '\r';
+                ++in;
+                break;
+
+            case 'n':
+                *out++ = '\n';
+                ++in;
+                break;
+
+            case 't':
+                *out++ = '\t';
+                ++in;
+                break;
+
+            case 'x':
+                if (isxdigit((unsigned char)in[1]) && isxdigit((unsigned char)in[2])) {
+                    const char hex[3] = {in[1], in[2], '\0'};
+                    *out++            = (char)strtoul(hex, NULL, 16);
+                    in += 3;
+                    break;
+                }
+                /* fall through */
+
+            default:
+                *out++ = *in++;
+                break;
+        }
+    }
+
+    *out = '\0';
+    return (size_t)(out - str);
+}
+
+static int script_add(step_type_t type, unsigned lineno, unsigned delay, const char* data, size_t len)
+{
+    struct step* const steps = realloc(script.steps, (script.count + 1) * sizeof(struct step));
+    if (!steps) {
+        return -1;
+    }
+    script.steps = steps;
+
+    struct step* const step = &steps[script.count];
+    step->type              = type;
+    step->lineno            = lineno;
+    step->delay             = delay;
+    step->len               = len;
+    step->data              = NULL;
+
+    if (data) {
+        step->data = malloc(len + 1);
+        if (!step->data) {
+            return -1;
+        }
+        memcpy(step->data, data, len);
+        step->data[len] = '\0';
+    }
+
+    script.count++;
+    return 0;
+}
+
+static int script_load(const char* fname)
+{
+    char buf[MAX_LINE];
+    unsigned lineno = 0;
+
+    FILE* const f = fopen(fname, "r");
+    if (!f) {
+        fprintf(stderr, "Unable to open script %s: %s\n", fname, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(buf, sizeof(buf), f)) {
+        ++lineno;
+
+        size_t len = strlen(buf);
+        while (len && (buf[len - 1] == '\n' || buf[len - 1] == '\r')) {
+            buf[--len] = '\0';
+        }
+
+        if (!len || buf[0] == '#') {
+            continue;
+        }
+
+        int res;
+        if (!strncmp(buf, "<<", 2)) {
+            char* const data = buf + 2 + (buf[2] == ' ');
+            res              = script_add(STEP_RAW, lineno, 0, data, unescape(data));
+        } else if (buf[0] == '<') {
+            char framed[MAX_LINE + 4];
+            const char* const data = buf + 1 + (buf[1] == ' ');
+            const int flen         = snprintf(framed, sizeof(framed), "\r\n%s\r\n", data);
+            res                    = script_add(STEP_REPLY, lineno, 0, framed, (size_t)flen);
+        } else if (buf[0] == '>') {
+            const char* const data = buf + 1 + (buf[1] == ' ');
+            res                    = script_add(STEP_EXPECT, lineno, 0, data, strlen(data));
+        } else if (buf[0] == '@') {
+            res = script_add(STEP_DELAY, lineno, (unsigned)strtoul(buf + 1, NULL, 10), NULL, 0);
+        } else {
+            fprintf(stderr, "%s:%u: unknown item '%s'\n", fname, lineno, buf);
+            res = -1;
+        }
+
+        if (res) {
+            fclose(f);
+            return -1;
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+#/* convert binary AT trace to sequential script */
+
+static int script_load_trace(const char* fname)
+{
+    struct at_trace_file_header hdr;
+    struct at_trace_record rec;
+    char data[UINT16_MAX + 1];
+    uint64_t last_rx = 0;
+    unsigned recno   = 0;
+    int res          = 0;
+
+    FILE* const f = fopen(fname, "rb");
+    if (!f) {
+        fprintf(stderr, "Unable to open trace %s: %s\n", fname, strerror(errno));
+        return -1;
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 || memcmp(hdr.magic, AT_TRACE_MAGIC, sizeof(hdr.magic)) || le32toh(hdr.version) != AT_TRACE_VERSION) {
+        fprintf(stderr, "%s: not an AT trace file\n", fname);
+        fclose(f);
+        return -1;
+    }
+
+    while (!res && fread(&rec, sizeof(rec), 1, f) == 1) {
+        const size_t len = le16toh(rec.length);
+        const uint64_t ts = (uint64_t)le32toh(rec.sec) * 1000000u + le32toh(rec.usec);
+
+        ++recno;
+        if (fread(data, 1, len, f) != len) {
+            fprintf(stderr, "%s: record %u truncated\n", fname, recno);
+            break;
+        }
+
+        if (rec.dir == AT_TRACE_RX) {
+            if (trace_timing && last_rx && ts > last_rx) {
+                res = script_add(STEP_DELAY, recno, (unsigned)((ts - last_rx) / 1000u), NULL, 0);
+            }
+            last_rx = ts;
+            if (!res) {
+                res = script_add(STEP_RAW, recno, 0, data, len);
+            }
+            continue;
+        }
+
+        /* one expectation per command, terminated by CR or Ctrl-Z */
+        size_t start = 0;
+        for (size_t i = 0; !res && i < len; ++i) {
+            if (data[i] == '\r' || data[i] == '\x1a') {
+                if (i > start) {
+                    res = script_add(STEP_EXPECT, recno, 0, data + start, i - start);
+                }
+                start = i + 1;
+            }
+        }
+        last_rx = 0;
+    }
+
+    fclose(f);
+    return res;
+}
+
+#/* */
+
+static int expect_match(const struct step* step, const char* cmd)
+{
+    if (!strcmp(step->data, "*")) {
+        return 1;
+    }
+    return !strncasecmp(cmd, step->data, step->len);
+}
+
+static void modem_queue(struct modem* m, const char* data, size_t len)
+{
+    struct segment* const seg = malloc(sizeof(struct segment) + len);
+    if (!seg) {
+        return;
+    }
+
+    seg->next = NULL;
+    seg->due  = m->out_due;
+    seg->len  = len;
+    seg->off  = 0;
+    memcpy(seg->data, data, len);
+
+    if (m->out_tail) {
+        m->out_tail->next = seg;
+    } else {
+        m->out_head = seg;
+    }
+    m->out_tail = seg;
+    m->stat.replies++;
+
+    if (verbose) {
+        fprintf(stderr, "[%u] < %.*s\n", m->idx, (int)len, data);
+    }
+}
+
+#/* queue replies starting from script position, stop on next expectation */
+
+static size_t modem_play(struct modem* m, size_t pos)
+{
+    for (; pos < script.count; ++pos) {
+        const struct step* const step = &script.steps[pos];
+
+        switch (step->type) {
+            case STEP_EXPECT:
+                return pos;
+
+            case STEP_DELAY:
+                m->out_due += (uint64_t)step->delay * 1000u;
+                break;
+
+            case STEP_REPLY:
+            case STEP_RAW:
+                modem_queue(m, step->data, step->len);
+                break;
+        }
+    }
+    return pos;
+}
+
+static void modem_default_reply(struct modem* m)
+{
+    static const char ok[]    = "\r\nOK\r\n";
+    static const char error[] = "\r\nERROR\r\n";
+
+    if (default_error) {
+        modem_queue(m, error, sizeof(error) - 1);
+    } else {
+        modem_queue(m, ok, sizeof(ok) - 1);
+    }
+}
+
+#/* queue replies of table rule, final OK is sent after the last command of line only */
+
+static int modem_play_rule(struct modem* m, size_t pos, int last)
+{
+    static const char ok[] = "\r\nOK\r\n";
+
+    for (; pos < script.count && script.steps[pos].type != STEP_EXPECT; ++pos) {
+        const struct step* const step = &script.steps[pos];
+
+        if (step->type == STEP_DELAY) {
+            m->out_due += (uint64_t)step->delay * 1000u;
+            continue;
+        }
+
+        if (strstr(step->data, "ERROR")) {
+            modem_queue(m, step->data, step->len);
+            return -1;
+        }
+
+        if (!last && !strcmp(step->data, ok)) {
+            continue;
+        }
+        modem_queue(m, step->data, step->len);
+    }
+    return 0;
+}
+
+static void modem_mark(struct modem* m, const char* cmd, uint64_t now)
+{
+    if (!mark_cmd || strncasecmp(cmd, mark_cmd, strlen(mark_cmd))) {
+        return;
+    }
+
+    if (!m->marks++) {
+        m->first_mark = now;
+        printf("modem%u: %s after %.3f ms, lines=%lu cmds=%lu\n", m->idx, mark_cmd, (now - m->first_cmd) / 1000.0, m->stat.lines, m->stat.commands);
+    } else if (mark_every && !(m->marks % mark_every)) {
+        const double ms = (now - m->first_mark) / 1000.0;
+        printf("modem%u: %lu x %s in %.3f ms, %.2f per second\n", m->idx, m->marks, mark_cmd, ms, (m->marks - 1) * 1000.0 / ms);
+    } else {
+        return;
+    }
+    fflush(stdout);
+}
+
+#/* answer command line in table mode, one rule per command */
+
+static void modem_answer(struct modem* m, const char* line, uint64_t now)
+{
+    char cmd[MAX_LINE + 2];
+    const char* start = line;
+    int quoted        = 0;
+
+    for (const char* p = line;; ++p) {
+        if (*p == '"') {
+            quoted = !quoted;
+            continue;
+        }
+        if (*p && (*p != ';' || quoted)) {
+            continue;
+        }
+
+        /* following commands of line are sent without AT prefix */
+        const int last = !*p;
+        snprintf(cmd, sizeof(cmd), "%s%.*s", start == line ? "" : "AT", (int)(p - start), start);
+        m->stat.commands++;
+        modem_mark(m, cmd, now);
+
+        size_t pos = 0;
+        for (; pos < script.count; ++pos) {
+            if (script.steps[pos].type == STEP_EXPECT && expect_match(&script.steps[pos], cmd)) {
+                break;
+            }
+        }
+
+        if (pos < script.count) {
+            if (modem_play_rule(m, pos + 1, last)) {
+                return;
+            }
+        } else {
+            m->stat.unmatched++;
+            if (last || default_error) {
+                modem_default_reply(m);
+                return;
+            }
+        }
+
+        if (last) {
+            return;
+        }
+        start = p + 1;
+    }
+}
+
+static void modem_command(struct modem* m, const char* cmd)
+{
+    const uint64_t now = now_us();
+
+    if (!m->stat.lines) {
+        m->first_cmd = now;
+    }
+    m->stat.lines++;
+    if (m->last_reply && !m->out_head) {
+        const uint64_t lat = now - m->last_reply;
+        if (!m->stat.lat_count || lat < m->stat.lat_min) {
+            m->stat.lat_min = lat;
+        }
+        if (lat > m->stat.lat_max) {
+            m->stat.lat_max = lat;
+        }
+        m->stat.lat_sum += lat;
+        m->stat.lat_count++;
+        m->last_reply = 0;
+    }
+
+    if (verbose) {
+        fprintf(stderr, "[%u] > %s\n", m->idx, cmd);
+    }
+
+    if (m->out_due < now) {
+        m->out_due = now;
+    }
+    m->out_due += (uint64_t)reply_delay * 1000u;
+
+    if (!sequential) {
+        modem_answer(m, cmd, now);
+        return;
+    }
+
+    m->stat.commands++;
+    modem_mark(m, cmd, now);
+
+    if (m->pos < script.count && expect_match(&script.steps[m->pos], cmd)) {
+        m->pos = modem_play(m, m->pos + 1);
+        return;
+    }
+
+    m->stat.unmatched++;
+    modem_default_reply(m);
+}
+
+static void modem_input(struct modem* m, const char* buf, size_t len)
+{
+    m->stat.rx_bytes += len;
+
+    for (size_t i = 0; i < len; ++i) {
+        const char c = buf[i];
+
+        if (c == '\r' || c == '\x1a') {
+            if (m->line_len) {
+                m->line[m->line_len] = '\0';
+                modem_command(m, m->line);
+                m->line_len = 0;
+            }
+        } else if (c != '\n' && m->line_len < sizeof(m->line) - 1) {
+            m->line[m->line_len++] = c;
+        }
+    }
+}
+
+#/* write due segments, return 0 or -1 on fatal error */
+
+static int modem_output(struct modem* m, uint64_t now)
+{
+    while (m->out_head && m->out_head->due <= now) {
+        struct segment* const seg = m->out_head;
+
+        size_t len = seg->len - seg->off;
+        if (chunk_size && len > chunk_size) {
+            len = chunk_size;
+        }
+
+        const ssize_t written = write(m->master, seg->data + seg->off, len);
+        if (written < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                return 0;
+            }
+            return -1;
+        }
+
+        seg->off += (size_t)written;
+        m->stat.tx_bytes += (unsigned long long)written;
+
+        if (seg->off < seg->len) {
+            if (chunk_size) {
+                seg->due = now + (uint64_t)chunk_delay * 1000u;
+            }
+            return 0;
+        }
+
+        m->out_head = seg->next;
+        if (!m->out_head) {
+            m->out_tail   = NULL;
+            m->last_reply = now;
+        }
+        free(seg);
+    }
+    return 0;
+}
+
+#/* */
+
+static int modem_open(struct modem* m, unsigned idx)
+{
+    struct termios term;
+
+    memset(m, 0, sizeof(*m));
+    m->idx   = idx;
+    m->slave = -1;
+
+    m->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (m->master < 0 || grantpt(m->master) || unlockpt(m->master) || ptsname_r(m->master, m->path, sizeof(m->path))) {
+        fprintf(stderr, "Unable to create pseudo-terminal: %s\n", strerror(errno));
+        return -1;
+    }
+
+    /* keep slave open, otherwise master reports POLLHUP until host opens it */
+    m->slave = open(m->path, O_RDWR | O_NOCTTY);
+    if (m->slave < 0) {
+        fprintf(stderr, "Unable to open %s: %s\n", m->path, strerror(errno));
+        return -1;
+    }
+
+    if (!tcgetattr(m->slave, &term)) {
+        cfmakeraw(&term);
+        tcsetattr(m->slave, TCSANOW, &term);
+    }
+
+    if (link_prefix) {
+        snprintf(m->link, sizeof(m->link), "%s%u", link_prefix, idx);
+        unlink(m->link);
+        if (symlink(m->path, m->link)) {
+            fprintf(stderr, "Unable to create symlink %s: %s\n", m->link, strerror(errno));
+            m->link[0] = '\0';
+        }
+    }
+
+    printf("modem%u: %s%s%s\n", idx, m->path, m->link[0] ? " -> " : "", m->link);
+
+    m->out_due = now_us();
+    if (sequential) {
+        m->pos = modem_play(m, 0);
+    } else {
+        modem_play(m, 0);
+    }
+    return 0;
+}
+
+static void modem_close(struct modem* m)
+{
+    while (m->out_head) {
+        struct segment* const seg = m->out_head;
+        m->out_head               = seg->next;
+        free(seg);
+    }
+
+    if (m->link[0]) {
+        unlink(m->link);
+    }
+    if (m->slave >= 0) {
+        close(m->slave);
+    }
+    if (m->master >= 0) {
+        close(m->master);
+    }
+}
+
+#/* */
+
+static void print_stat_line(FILE* f, const char* name, const struct modem_stat* s, double elapsed)
+{
+    const double avg = s->lat_count ? (double)s->lat_sum / s->lat_count / 1000.0 : 0.0;
+
+    fprintf(f, "%-8s lines=%-8lu cmds=%-8lu unmatched=%-6lu replies=%-8lu rx=%-10llu tx=%-10llu rate=%9.1f/s lat(ms) min=%.3f avg=%.3f max=%.3f\n", name, s->lines, s->commands,
+            s->unmatched, s->replies, s->rx_bytes, s->tx_bytes, elapsed > 0 ? s->commands / elapsed : 0.0, s->lat_min / 1000.0, avg, s->lat_max / 1000.0);
+}
+
+static void print_stat(uint64_t started)
+{
+    const double elapsed = (now_us() - started) / 1000000.0;
+    struct modem_stat total;
+    char name[16];
+
+    memset(&total, 0, sizeof(total));
+    for (unsigned i = 0; i < modems_count; ++i) {
+        const struct modem_stat* const s = &modems[i].stat;
+
+        if (modems_count > 1) {
+            snprintf(name, sizeof(name), "modem%u", i);
+            print_stat_line(stdout, name, s, elapsed);
+        }
+
+        total.lines += s->lines;
+        total.commands += s->commands;
+        total.unmatched += s->unmatched;
+        total.replies += s->replies;
+        total.rx_bytes += s->rx_bytes;
+        total.tx_bytes += s->tx_bytes;
+        total.lat_sum += s->lat_sum;
+        if (s->lat_count && (!total.lat_count || s->lat_min < total.lat_min)) {
+            total.lat_min = s->lat_min;
+        }
+        if (s->lat_max > total.lat_max) {
+            total.lat_max = s->lat_max;
+        }
+        total.lat_count += s->lat_count;
+    }
+
+    print_stat_line(stdout, "total", &total, elapsed);
+    fflush(stdout);
+}
+
+static void on_signal(int sig)
+{
+    if (sig == SIGUSR1) {
+        stat_requested = 1;
+    } else {
+        stop_requested = 1;
+    }
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [-n count] [-l link-prefix] [-S] [-d ms] [-c bytes] [-i ms] [-e] [-r sec] [-v] [-t [-T]] [-m command [-M count]] <script>\n", prog);
+}
+
+int main(int argc, char* argv[])
+{
+    struct pollfd fds[MAX_MODEMS];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:Sd:c:i:er:vtTm:M:")) != -1) {
+        switch (opt) {
+            case 'n':
+                modems_count = (unsigned)strtoul(optarg, NULL, 10);
+                break;
+            case 'l':
+                link_prefix = optarg;
+                break;
+            case 'S':
+                sequential = 1;
+                break;
+            case 'd':
+                reply_delay = (unsigned)strtoul(optarg, NULL, 10);
+                break;
+            case 'c':
+                chunk_size = strtoul(optarg, NULL, 10);
+                break;
+            case 'i':
+                chunk_delay = (unsigned)strtoul(optarg, NULL, 10);
+                break;
+            case 'e':
+                default_error = 1;
+                break;
+            case 'r':
+                report_sec = (unsigned)strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            case 't':
+                trace_input = 1;
+                sequential  = 1;
+                break;
+            case 'T':
+                trace_timing = 1;
+                break;
+            case 'm':
+                mark_cmd = optarg;
+                break;
+            case 'M':
+                mark_every = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc || !modems_count || modems_count > MAX_MODEMS) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (trace_input ? script_load_trace(argv[optind]) : script_load(argv[optind])) {
+        return 2;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGUSR1, on_signal);
+
+    unsigned opened = 0;
+    for (; opened < modems_count; ++opened) {
+        if (modem_open(&modems[opened], opened)) {
+            modem_close(&modems[opened]);
+            break;
+        }
+    }
+    fflush(stdout);
+
+    if (opened < modems_count) {
+        for (unsigned i = 0; i < opened; ++i) {
+            modem_close(&modems[i]);
+        }
+        return 3;
+    }
+
+    const uint64_t started = now_us();
+    uint64_t next_report   = started + (uint64_t)report_sec * 1000000u;
+
+    while (!stop_requested) {
+        uint64_t now     = now_us();
+        uint64_t wake_at = report_sec ? next_report : now + 1000000u;
+
+        for (unsigned i = 0; i < modems_count; ++i) {
+            struct modem* const m = &modems[i];
+
+            fds[i].fd      = m->master;
+            fds[i].events  = POLLIN;
+            fds[i].revents = 0;
+            if (m->out_head) {
+                if (m->out_head->due <= now) {
+                    fds[i].events |= POLLOUT;
+                } else if (m->out_head->due < wake_at) {
+                    wake_at = m->out_head->due;
+                }
+            }
+        }
+
+        const int timeout = wake_at > now ? (int)((wake_at - now + 999u) / 1000u) : 0;
+        const int res     = poll(fds, modems_count, timeout);
+        if (res < 0 && errno != EINTR) {
+            fprintf(stderr, "poll() failed: %s\n", strerror(errno));
+            break;
+        }
+
+        now = now_us();
+        for (unsigned i = 0; res > 0 && i < modems_count; ++i) {
+            struct modem* const m = &modems[i];
+
+            if (fds[i].revents & POLLIN) {
+                char buf[MAX_LINE];
+                const ssize_t len = read(m->master, buf, sizeof(buf));
+                if (len > 0) {
+                    modem_input(m, buf, (size_t)len);
+                }
+            }
+
+            if ((fds[i].revents & POLLOUT) || m->out_head) {
+                if (modem_output(m, now)) {
+                    fprintf(stderr, "[%u] write failed: %s\n", m->idx, strerror(errno));
+                }
+            }
+        }
+
+        if (stat_requested || (report_sec && now >= next_report)) {
+            print_stat(started);
+            stat_requested = 0;
+            if (report_sec) {
+                next_report = now + (uint64_t)report_sec * 1000000u;
+            }
+        }
+    }
+
+    print_stat(started);
+
+    for (unsigned i = 0; i < modems_count; ++i) {
+        modem_close(&modems[i]);
+    }
+
+    for (size_t i = 0; i < script.count; ++i) {
+        free(script.steps[i].data);
+    }
+    free(script.steps);
+
+    return 0;
+}
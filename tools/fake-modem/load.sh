@@ -0,0 +1,35 @@
+#!/bin/sh
+#
+# Start N fake modems and print matching quectel.conf device sections.
+#
+# Usage: load.sh <count> [script] [fake-modem options...]
+#
+
+COUNT=${1:-1}
+DIR=$(dirname "$0")
+SCRIPT=${2:-$DIR/ec25.script}
+PREFIX=/tmp/fake-modem
+
+[ $# -gt 0 ] && shift
+[ $# -gt 0 ] && shift
+
+if [ ! -x "$DIR/fake-modem" ]; then
+    cc -O2 -Wall -o "$DIR/fake-modem" "$DIR/fake-modem.c" || exit 1
+fi
+
+i=0
+while [ $i -lt "$COUNT" ]; do
+    cat <<CONF
+[fake$i]
+data=$PREFIX$i
+audio=/dev/null
+context=quectel-incoming
+group=1
+
+CONF
+    i=$((i + 1))
+done >"$PREFIX.conf"
+
+echo "Device sections written to $PREFIX.conf"
+
+exec "$DIR/fake-modem" -n "$COUNT" -l "$PREFIX" -r 10 "$@" "$SCRIPT"
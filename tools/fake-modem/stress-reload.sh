@@ -0,0 +1,96 @@
+#!/bin/sh
+#
+# Dial, send messages and reload configuration concurrently on N fake modems,
+# half of devices is removed and added again by every other reload.
+# Fails if Asterisk crashes or some command does not complete in time.
+#
+# Usage: stress-reload.sh <count> [seconds]
+#
+# quectel.conf must include device sections written by load.sh:
+#   #include /tmp/fake-modem.conf
+#
+
+COUNT=${1:-8}
+DURATION=${2:-60}
+DIR=$(dirname "$0")
+CONF=/tmp/fake-modem.conf
+FAIL=/tmp/fake-modem.fail
+TIMEOUT=30
+
+rx() {
+    timeout "$TIMEOUT" asterisk -rx "$1" >/dev/null 2>&1
+    if [ $? -eq 124 ]; then
+        echo "hang: $1" >>"$FAIL"
+    fi
+}
+
+alive() {
+    if ! kill -0 "$PID" 2>/dev/null; then
+        echo "crash: asterisk exited" >>"$FAIL"
+        return 1
+    fi
+    [ ! -s "$FAIL" ] && [ "$(date +%s)" -lt "$END" ]
+}
+
+PID=$(pidof asterisk)
+if [ -z "$PID" ]; then
+    echo "Asterisk is not running"
+    exit 1
+fi
+
+rm -f "$FAIL"
+"$DIR/load.sh" "$COUNT" >/tmp/fake-modem.log 2>&1 &
+LOAD=$!
+sleep 2
+
+# every device section is 6 lines long
+cp "$CONF" "$CONF.full"
+head -n $((COUNT / 2 * 6)) "$CONF.full" >"$CONF.half"
+
+rx "module reload chan_quectel.so"
+sleep 5
+END=$(($(date +%s) + DURATION))
+
+(
+    while alive; do
+        rx "channel originate Quectel/g1/+79990000000 application Wait 1"
+    done
+) &
+DIAL=$!
+
+(
+    n=0
+    while alive; do
+        rx "quectel sms send fake$((n % COUNT)) +79990000000 stress $n"
+        n=$((n + 1))
+    done
+) &
+SMS=$!
+
+(
+    n=0
+    while alive; do
+        if [ $((n % 2)) -eq 0 ]; then
+            cp "$CONF.half" "$CONF"
+        else
+            cp "$CONF.full" "$CONF"
+        fi
+        rx "module reload chan_quectel.so"
+        n=$((n + 1))
+        sleep 1
+    done
+) &
+RELOAD=$!
+
+wait "$DIAL" "$SMS" "$RELOAD"
+
+cp "$CONF.full" "$CONF"
+rx "module reload chan_quectel.so"
+rx "quectel show devices"
+kill "$LOAD"
+
+if [ -s "$FAIL" ]; then
+    sort "$FAIL" | uniq -c
+    exit 1
+fi
+echo "No crashes or hangs in $DURATION seconds"